@@ -29,6 +29,10 @@
 
 #include "lib/hmac/hmac_sha2.h"
 #include "account.h"
+#include "arena.h"
+#include "fixed.h"
+#include "url.h"
+#include "format.h"
 #include "bittrex.h"
 #include "market.h"
 
@@ -43,6 +47,7 @@ struct api *new_api(char *apik, char *s){
 	a = malloc(sizeof(struct api));
 	a->key = apik;
 	a->secret = s;
+	hmac_sha512_init(&(a->signer), (unsigned char *)s, strlen(s));
 	return a;
 }
 
@@ -62,31 +67,28 @@ int api_is_valid(struct api *api) {
 struct balance *getbalance(struct bittrex_info *bi, struct currency *c, struct api *api) {
 	struct balance *b;
 	json_t *result, *tmp, *root;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
 
 	if (!c || !api || !api_is_valid(api)) {
 		fprintf(stderr, "getbalance: invalid currency or invalid API key\n");
 		return NULL;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
-	url = malloc(strlen(GETBALANCE) + strlen(api->key) +
-		     strlen("&currency=") + strlen(c->coin) +
-		     strlen("&nonce=") + strlen(nonce) + 1);
-	url[0]='\0';
-	url = strcat(url, GETBALANCE);
-	url = strcat(url, api->key);
-	url = strcat(url, "&currency=");
-	url = strcat(url, c->coin);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-	hmac = hmacstr(api->secret, url);
+	url_init(&u, GETBALANCE);
+	url_value(&u, api->key);
+	url_param(&u, "currency", c->coin);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETBALANCE);
 	if (!root) {
 		fprintf(stderr, "getbalance: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -100,11 +102,11 @@ struct balance *getbalance(struct bittrex_info *bi, struct currency *c, struct a
 	b->currency = c;
 
 	tmp = json_object_get(result, "Balance");
-	b->balance = json_real_value(tmp);
+	b->balance = json_fixed_get(tmp);
 	tmp = json_object_get(result, "Available");
-	b->available = json_real_value(tmp);
+	b->available = json_fixed_get(tmp);
 	tmp = json_object_get(result, "Pending");
-	b->pending = json_real_value(tmp);
+	b->pending = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "Requested");
 	b->requested = json_is_true(tmp);
@@ -113,8 +115,6 @@ struct balance *getbalance(struct bittrex_info *bi, struct currency *c, struct a
 	b->cryptoaddress = json_string_get(b->cryptoaddress, tmp);
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return b;
@@ -123,29 +123,29 @@ struct balance *getbalance(struct bittrex_info *bi, struct currency *c, struct a
 struct balance **getbalances(struct bittrex_info *bi, struct api *api) {
 	struct balance **balances, *b;
 	json_t *result, *tmp, *root, *raw;
+	struct arena *a;
 	int size = 0, i = 0;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
 
 	if (!api || !api_is_valid(api)) {
 		fprintf(stderr, "getbalances: no API key or invalid\n");
 		return NULL;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
-	url = malloc(strlen(GETBALANCES) + strlen(api->key) +
-		     strlen("&nonce=") + strlen(nonce) + 1);
-	url[0]='\0';
-	url = strcat(url, GETBALANCES);
-	url = strcat(url, api->key);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-	hmac = hmacstr(api->secret, url);
+	url_init(&u, GETBALANCES);
+	url_value(&u, api->key);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETBALANCES);
 	if (!root) {
 		fprintf(stderr, "getbalances: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -163,36 +163,35 @@ struct balance **getbalances(struct bittrex_info *bi, struct api *api) {
 		bi->currencies = getcurrencies(bi);
 	}
 	size = json_array_size(result);
-	balances = malloc((size+1)*sizeof(struct balance*));
+	a = new_arena(ARENA_BLOCKSIZE);
+	balances = arena_list(a, size);
 
 	for (i=0; i < size; i++) {
 		raw = json_array_get(result,i);
-		b = malloc(sizeof(struct balance));
+		b = arena_calloc(a, sizeof(struct balance));
 
 		tmp = json_object_get(raw, "Currency");
 		if (tmp && json_string_value(tmp))
 			b->currency = getcurrency(bi->currencies, (char*)json_string_value(tmp));
 
 		tmp = json_object_get(raw, "Balance");
-		b->balance = json_real_value(tmp);
+		b->balance = json_fixed_get(tmp);
 		tmp = json_object_get(raw, "Available");
-		b->available = json_real_value(tmp);
+		b->available = json_fixed_get(tmp);
 		tmp = json_object_get(raw, "Pending");
-		b->pending = json_real_value(tmp);
+		b->pending = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Requested");
 		b->requested = json_is_true(tmp);
 
 		tmp = json_object_get(raw, "CryptoAddress");
-		b->cryptoaddress = json_string_get(b->cryptoaddress, tmp);
+		b->cryptoaddress = json_string_arena(a, tmp);
 
 		balances[i] = b;
 	}
 	balances[i] = NULL;
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return balances;
@@ -201,42 +200,31 @@ struct balance **getbalances(struct bittrex_info *bi, struct api *api) {
 struct deposit **getdeposithistory(struct bittrex_info *bi, struct currency *c) {
 	struct deposit **deposit, *d;
 	json_t *result, *tmp, *root, *raw;
+	struct arena *a;
 	int size = 0, i = 0;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
 
 	if (!bi->api || !api_is_valid(bi->api)) {
 		fprintf(stderr, "getdeposithistory: no API key or invalid\n");
 		return NULL;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
-	if (!c) {
-		url = malloc(strlen(GETDEPOSITHISTORY) + strlen(bi->api->key) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-		url[0]='\0';
-		url = strcat(url, GETDEPOSITHISTORY);
-		url = strcat(url, bi->api->key);
-		url = strcat(url, "&nonce=");
-		url = strcat(url, nonce);
-	} else {
-		url = malloc(strlen(GETDEPOSITHISTORY) + strlen(bi->api->key) +
-			     strlen("&currency=") + strlen(c->coin) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-		url[0]='\0';
-		url = strcat(url, GETDEPOSITHISTORY);
-		url = strcat(url, bi->api->key);
-		url = strcat(url, "&currency=");
-		url = strcat(url, c->coin);
-		url = strcat(url, "&nonce=");
-		url = strcat(url, nonce);
-	}
-	hmac = hmacstr(bi->api->secret, url);
+	url_init(&u, GETDEPOSITHISTORY);
+	url_value(&u, bi->api->key);
+	if (c)
+		url_param(&u, "currency", c->coin);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETDEPOSITHISTORY);
 	if (!root) {
 		fprintf(stderr, "getdeposithistory: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -251,11 +239,12 @@ struct deposit **getdeposithistory(struct bittrex_info *bi, struct currency *c)
 	}
 
 	size = json_array_size(result);
-	deposit = malloc((size+1)*sizeof(struct deposit*));
+	a = new_arena(ARENA_BLOCKSIZE);
+	deposit = arena_list(a, size);
 
 	for (i=0; i < size; i++) {
 		raw = json_array_get(result,i);
-		d = malloc(sizeof(struct deposit));
+		d = arena_alloc(a, sizeof(struct deposit));
 
 		d->paymentuid = 0;
 		tmp = json_object_get(raw, "Id");
@@ -263,11 +252,11 @@ struct deposit **getdeposithistory(struct bittrex_info *bi, struct currency *c)
 
 		d->address = NULL;
 		tmp = json_object_get(raw, "CryptoAddress");
-		d->address = json_string_get(d->address, tmp);
+		d->address = json_string_arena(a, tmp);
 
 		d->timestamp = NULL;
 		tmp = json_object_get(raw, "LastUpdated");
-		d->timestamp = json_string_get(d->timestamp, tmp);
+		d->timestamp = json_string_arena(a, tmp);
 
 
 		d->currency = NULL;
@@ -281,14 +270,12 @@ struct deposit **getdeposithistory(struct bittrex_info *bi, struct currency *c)
 
 		d->txid = NULL;
 		tmp = json_object_get(raw, "TxId");
-		d->txid = json_string_get(d->txid, tmp);
+		d->txid = json_string_arena(a, tmp);
 
 		deposit[i] = d;
 	}
 	deposit[i] = NULL;
 
-	free(url);
-	free(nonce);
 	free(hmac);
 	json_decref(root);
 
@@ -297,7 +284,9 @@ struct deposit **getdeposithistory(struct bittrex_info *bi, struct currency *c)
 
 char *getdepositaddress(struct bittrex_info *bi, struct currency *c, struct api *api) {
 	json_t *result, *root, *tmp;
-	char *url, *nonce, *hmac, *res;
+	struct url u;
+	char *url, *hmac, *res;
+	char nonce[NONCE_SIZE];
 
 	if (!api_is_valid(api) || !c ) {
 		fprintf(stderr, "getdepositaddress: bad parameter %s\n",
@@ -305,24 +294,19 @@ char *getdepositaddress(struct bittrex_info *bi, struct currency *c, struct api
 		return NULL;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
-	url = malloc(strlen(GETDEPOSITADDRESS) + strlen(api->key) +
-		     strlen("&nonce=") + strlen(nonce) +
-		     strlen("&currency=") + strlen(c->coin) +1);
-	url[0]='\0';
-	url = strcat(url, GETDEPOSITADDRESS);
-	url = strcat(url, api->key);
-	url = strcat(url, "&currency=");
-	url = strcat(url, c->coin);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-	hmac = hmacstr(api->secret, url);
+	url_init(&u, GETDEPOSITADDRESS);
+	url_value(&u, api->key);
+	url_param(&u, "currency", c->coin);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETDEPOSITADDRESS);
 	if (!root) {
 		fprintf(stderr, "getdepositaddress: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -339,8 +323,6 @@ char *getdepositaddress(struct bittrex_info *bi, struct currency *c, struct api
 	res = strcpy(res, json_string_value(tmp));
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return res;
@@ -349,7 +331,9 @@ char *getdepositaddress(struct bittrex_info *bi, struct currency *c, struct api
 int cancel(struct bittrex_info *bi, char *uuid) {
 	struct user_order *o = NULL;
 	json_t *root;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
 
 	if (!bi->api || !api_is_valid(bi->api)) {
 		fprintf(stderr, "cancel: bad parameter API\n");
@@ -361,33 +345,25 @@ int cancel(struct bittrex_info *bi, char *uuid) {
 		fprintf(stderr, "Cancel order not possible, %s order not found\n", uuid);
 	}
 
-	nonce = getnonce();
-
-	url = malloc(strlen(CANCELORDER) + strlen(bi->api->key) +
-		     + strlen("&uuid=") + strlen(uuid) +
-		     strlen("&nonce=") + strlen(nonce) + 1);
-	url[0]='\0';
-	url = strcat(url, CANCELORDER);
-	url = strcat(url, bi->api->key);
-	url = strcat(url, "&uuid=");
-	url = strcat(url, uuid);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
+	getnonce(nonce);
 
-	hmac = hmacstr(bi->api->secret, url);
+	url_init(&u, CANCELORDER);
+	url_value(&u, bi->api->key);
+	url_param(&u, "uuid", uuid);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return -1;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, CANCELORDER);
 	if (!root) {
 		fprintf(stderr, "cancel: API call failed (%s)\n", url);
-		free(url);
 		return -1;
 	} else {
 		printf("Order: %s canceled\n", uuid);
 	}
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return 0;
@@ -395,7 +371,9 @@ int cancel(struct bittrex_info *bi, char *uuid) {
 
 int withdraw(struct bittrex_info *bi, struct currency *c, double quantity, char *destaddress, char *paymentid) {
 	json_t *result, *root, *tmp;
-	char *url, *nonce, *hmac, *s = NULL;
+	struct url u;
+	char *url, *hmac, *s = NULL;
+	char nonce[NONCE_SIZE];
 	char buf[42];
 
 	if (!api_is_valid(bi->api)) {
@@ -403,48 +381,26 @@ int withdraw(struct bittrex_info *bi, struct currency *c, double quantity, char
 		return -1;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
 	// convert quantity into string
 	sprintf(buf, "%.8f", quantity);
 
-	if (!paymentid) {
-		url = malloc(strlen(WITHDRAW) + strlen(bi->api->key) +
-			     strlen("&currency=") + strlen(c->coin) +
-			     strlen("&quantity=") + strlen(buf) +
-			     strlen("&address=") + strlen(destaddress) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-	} else {
-		url = malloc(strlen(WITHDRAW) + strlen(bi->api->key) +
-			     strlen("&currency=") + strlen(c->coin) +
-			     strlen("&quantity=") + strlen(buf) +
-			     strlen("&address=") + strlen(destaddress) +
-			     strlen("&paymentid=") + strlen(paymentid) +
-			     strlen("&nonce=") + strlen(nonce) +1);
-	}
-	url[0] = '\0';
-	url = strcat(url, WITHDRAW);
-	url = strcat(url, bi->api->key);
-	url = strcat(url, "&currency=");
-	url = strcat(url, c->coin);
-	url = strcat(url, "&quantity=");
-	url = strcat(url, buf);
-	url = strcat(url, "&address=");
-	url = strcat(url, destaddress);
-	if (paymentid) {
-		url = strcat(url, "&paymentid=");
-		url = strcat(url, paymentid);
-	}
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-
-	hmac = hmacstr(bi->api->secret, url);
+	url_init(&u, WITHDRAW);
+	url_value(&u, bi->api->key);
+	url_param(&u, "currency", c->coin);
+	url_param(&u, "quantity", buf);
+	url_param(&u, "address", destaddress);
+	if (paymentid)
+		url_param(&u, "paymentid", paymentid);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return -1;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, WITHDRAW);
 	if (!root) {
 		fprintf(stderr, "withdraw: API call failed (%s)\n", url);
-		free(nonce);
-		free(url);
 		return -1;
 	}
 	result = json_object_get(root, "result");
@@ -453,8 +409,6 @@ int withdraw(struct bittrex_info *bi, struct currency *c, double quantity, char
 
 	json_decref(root);
 	if (s) free(s);
-	free(nonce);
-	free(url);
 	free(hmac);
 
 	return 0;
@@ -463,45 +417,32 @@ int withdraw(struct bittrex_info *bi, struct currency *c, double quantity, char
 /*
  * buylimit and selllimit api call
  */
-static char *tradelimit(struct bittrex_info *bi, struct market *m, double quantity, double rate, char *type) {
+static char *tradelimit(struct bittrex_info *bi, struct market *m, fixed_t quantity, fixed_t rate, char *type) {
 	json_t *result, *root, *tmp;
-	char *url, *nonce, *hmac, *s = NULL;
-	char bufq[42], bufr[42];
+	struct url u;
+	char *url, *hmac, *s = NULL;
+	char nonce[NONCE_SIZE];
 
 	if (!api_is_valid(bi->api)) {
 		fprintf(stderr, "%s: bad parameter API\n", type);
 		return NULL;
 	}
 
-	nonce = getnonce();
-
-	sprintf(bufq, "%.8f", quantity);
-	sprintf(bufr, "%.8f", rate);
-
-	url = malloc(strlen(type) + strlen(bi->api->key) +
-		     strlen("&market=") + strlen(m->marketname) +
-		     strlen("&quantity=") + strlen(bufq) +
-		     strlen("&rate=") + strlen(bufr) +
-		     strlen("&nonce=") + strlen(nonce) + 1);
-	url[0] = '\0';
-	url = strcat(url, type);
-	url = strcat(url, bi->api->key);
-	url = strcat(url, "&market=");
-	url = strcat(url, m->marketname);
-	url = strcat(url, "&quantity=");
-	url = strcat(url, bufq);
-	url = strcat(url, "&rate=");
-	url = strcat(url, bufr);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-
-	hmac = hmacstr(bi->api->secret, url);
+	getnonce(nonce);
+
+	url_init(&u, type);
+	url_value(&u, bi->api->key);
+	url_param(&u, "market", m->marketname);
+	url_param_fixed(&u, "quantity", quantity);
+	url_param_fixed(&u, "rate", rate);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, type);
 	if (!root) {
 		fprintf(stderr, "%s: API call failed (%s)\n", url, type);
-		free(nonce);
-		free(url);
 		return NULL;
 	}
 	result = json_object_get(root, "result");
@@ -510,18 +451,16 @@ static char *tradelimit(struct bittrex_info *bi, struct market *m, double quanti
 
 	json_decref(root);
 
-	free(nonce);
-	free(url);
 	free(hmac);
 
 	return s;
 }
 
-char *buylimit(struct bittrex_info *bi, struct market *m, double quantity, double rate) {
+char *buylimit(struct bittrex_info *bi, struct market *m, fixed_t quantity, fixed_t rate) {
 	return tradelimit(bi, m, quantity, rate, BUYLIMIT);
 }
 
-char *selllimit(struct bittrex_info *bi, struct market *m, double quantity, double rate) {
+char *selllimit(struct bittrex_info *bi, struct market *m, fixed_t quantity, fixed_t rate) {
 	return tradelimit(bi, m, quantity, rate, SELLLIMIT);
 }
 
@@ -548,34 +487,34 @@ static void json_order_get(struct bittrex_info *bi, struct user_order *o, json_t
 	o->ordertype = json_string_get(o->ordertype, tmp);
 
 	tmp = json_object_get(result, "Quantity");
-	o->quantity = json_real_get(tmp);
+	o->quantity = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "QuantityRemaining");
-	o->quantityremaining = json_real_get(tmp);
+	o->quantityremaining = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "Limit");
-	o->limit = json_real_get(tmp);
+	o->limit = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "Reserved");
-	o->reserved = json_real_get(tmp);
+	o->reserved = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "ReservedRemaining");
-	o->reservedremaining = json_real_get(tmp);
+	o->reservedremaining = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "CommissionReserved");
-	o->commissionreserved = json_real_get(tmp);
+	o->commissionreserved = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "CommissionReservedRemaining");
-	o->commissionRR = json_real_get(tmp);
+	o->commissionRR = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "CommissionPaid");
-	o->commission = json_real_get(tmp);
+	o->commission = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "Price");
-	o->price = json_real_get(tmp);
+	o->price = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "PricePerUnit");
-	o->priceperunit = json_real_get(tmp);
+	o->priceperunit = json_fixed_get(tmp);
 
 	tmp = json_object_get(result, "Opened");
 	o->timestamp = json_string_get(o->timestamp, tmp);
@@ -602,7 +541,10 @@ static void json_order_get(struct bittrex_info *bi, struct user_order *o, json_t
 struct user_order **getorderhistory(struct bittrex_info *bi, struct market *market) {
 	struct user_order **orders, *o;
 	json_t *result, *root, *tmp, *raw;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
+	struct arena *a;
 	int i = 0, size = 0;
 
 	if (!api_is_valid(bi->api)) {
@@ -610,34 +552,20 @@ struct user_order **getorderhistory(struct bittrex_info *bi, struct market *mark
 		return NULL;
 	}
 
-	nonce = getnonce();
-
-	if (market) {
-		url = malloc(strlen(GETORDERHISTORY) + strlen(bi->api->key) +
-			     strlen(market->marketname) + strlen("&market=") +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-		url[0]='\0';
-		url = strcat(url, GETORDERHISTORY);
-		url = strcat(url, bi->api->key);
-		url = strcat(url, "&market=");
-		url = strcat(url, market->marketname);
-		url = strcat(url, "&nonce=");
-		url = strcat(url, nonce);
-	} else {
-		url = malloc(strlen(GETORDERHISTORY) + strlen(bi->api->key) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-		url[0]='\0';
-		url = strcat(url, GETORDERHISTORY);
-		url = strcat(url, bi->api->key);
-		url = strcat(url, "&nonce=");
-		url = strcat(url, nonce);
-	}
-	hmac = hmacstr(bi->api->secret, url);
+	getnonce(nonce);
+
+	url_init(&u, GETORDERHISTORY);
+	url_value(&u, bi->api->key);
+	if (market)
+		url_param(&u, "market", market->marketname);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETORDERHISTORY);
 	if (!root) {
 		fprintf(stderr, "getorderhistory: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -648,53 +576,55 @@ struct user_order **getorderhistory(struct bittrex_info *bi, struct market *mark
 	}
 	size = json_array_size(result);
 
-	orders = malloc((size+1)*sizeof(struct user_order*));
+	/* whole reply in one region, see free_user_orders() */
+	a = new_arena(ARENA_BLOCKSIZE);
+	orders = arena_list(a, size);
 
 	for (i=0; i < size; i++) {
-		o = new_user_order();
+		o = arena_calloc(a, sizeof(struct user_order));
 		raw = json_array_get(result,i);
 
 		tmp = json_object_get(raw, "OrderUuid");
-		o->orderuuid = json_string_get(o->orderuuid, tmp);
+		o->orderuuid = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Exchange");
 		o->market = getmarket(bi->markets, (char*)json_string_value(tmp));
 
 		tmp = json_object_get(raw, "TimeStamp");
-		o->timestamp = json_string_get(o->timestamp, tmp);
+		o->timestamp = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "OrderType");
-		o->ordertype = json_string_get(o->ordertype, tmp);
+		o->ordertype = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Closed");
-		o->dateclosed = json_string_get(o->dateclosed, tmp);
+		o->dateclosed = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Limit");
-		o->limit= json_real_value(tmp);
+		o->limit= json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Quantity");
-		o->quantity= json_real_value(tmp);
+		o->quantity= json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "QuantityRemaining");
-		o->quantityremaining = json_real_value(tmp);
+		o->quantityremaining = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Commission");
-		o->commission = json_real_value(tmp);
+		o->commission = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Price");
-		o->price = json_real_value(tmp);
+		o->price = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "PricePerUnit");
-		o->priceperunit = json_real_value(tmp);
+		o->priceperunit = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "IsConditional");
 		o->isconditional = json_is_true(tmp);
 
 		tmp = json_object_get(raw, "Condition");
-		o->condition = json_string_get(o->condition, tmp);
+		o->condition = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "ConditionTarget");
-		o->conditiontarget = json_string_get(o->conditiontarget, tmp);
+		o->conditiontarget = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "ImmediateOrCancel");
 		o->immediateorcancel = json_is_true(tmp);
@@ -704,8 +634,6 @@ struct user_order **getorderhistory(struct bittrex_info *bi, struct market *mark
 	orders[i] = NULL;
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return orders;
@@ -714,7 +642,10 @@ struct user_order **getorderhistory(struct bittrex_info *bi, struct market *mark
 struct user_order **getopenorders(struct bittrex_info *bi, struct market *market) {
 	struct user_order **orders, *o;
 	json_t *result, *root, *tmp, *raw;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
+	struct arena *a;
 	int i = 0, size = 0;
 
 	if (!api_is_valid(bi->api)) {
@@ -722,31 +653,20 @@ struct user_order **getopenorders(struct bittrex_info *bi, struct market *market
 		return NULL;
 	}
 
-	nonce = getnonce();
+	getnonce(nonce);
 
+	url_init(&u, GETOPENORDERS);
+	url_value(&u, bi->api->key);
 	if (market)
-		url = malloc(strlen(GETOPENORDERS) + strlen(bi->api->key) +
-			     strlen(market->marketname) + strlen("&market=") +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-	else
-		url = malloc(strlen(GETOPENORDERS) + strlen(bi->api->key) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-	url[0]='\0';
-	url = strcat(url, GETOPENORDERS);
-	url = strcat(url, bi->api->key);
-	if (market) {
-		url = strcat(url, "&market=");
-		url = strcat(url, market->marketname);
-	}
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-
-	hmac = hmacstr(bi->api->secret, url);
+		url_param(&u, "market", market->marketname);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETOPENORDERS);
 	if (!root) {
 		fprintf(stderr, "getopenorders: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -757,53 +677,55 @@ struct user_order **getopenorders(struct bittrex_info *bi, struct market *market
 	}
 	size = json_array_size(result);
 
-	orders = malloc((size+1)*sizeof(struct user_order*));
+	/* whole reply in one region, see free_user_orders() */
+	a = new_arena(ARENA_BLOCKSIZE);
+	orders = arena_list(a, size);
 
 	for (i=0; i < size; i++) {
-		o = new_user_order();
+		o = arena_calloc(a, sizeof(struct user_order));
 		raw = json_array_get(result,i);
 
 		tmp = json_object_get(raw, "OrderUuid");
-		o->orderuuid = json_string_get(o->orderuuid, tmp);
+		o->orderuuid = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Exchange");
 		o->market = getmarket(bi->markets, (char*)json_string_value(tmp));
 
 		tmp = json_object_get(raw, "Opened");
-		o->timestamp = json_string_get(o->timestamp, tmp);
+		o->timestamp = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "OrderType");
-		o->ordertype = json_string_get(o->ordertype, tmp);
+		o->ordertype = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Closed");
-		o->dateclosed = json_string_get(o->dateclosed, tmp);
+		o->dateclosed = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "Limit");
-		o->limit= json_real_value(tmp);
+		o->limit= json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Quantity");
-		o->quantity= json_real_value(tmp);
+		o->quantity= json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "QuantityRemaining");
-		o->quantityremaining = json_real_value(tmp);
+		o->quantityremaining = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "CommissionPaid");
-		o->commission = json_real_value(tmp);
+		o->commission = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "Price");
-		o->price = json_real_value(tmp);
+		o->price = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "PricePerUnit");
-		o->priceperunit = json_real_value(tmp);
+		o->priceperunit = json_fixed_get(tmp);
 
 		tmp = json_object_get(raw, "IsConditional");
 		o->isconditional = json_is_true(tmp);
 
 		tmp = json_object_get(raw, "Condition");
-		o->condition = json_string_get(o->condition, tmp);
+		o->condition = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "ConditionTarget");
-		o->conditiontarget = json_string_get(o->conditiontarget, tmp);
+		o->conditiontarget = json_string_arena(a, tmp);
 
 		tmp = json_object_get(raw, "ImmediateOrCancel");
 		o->immediateorcancel = json_is_true(tmp);
@@ -815,8 +737,6 @@ struct user_order **getopenorders(struct bittrex_info *bi, struct market *market
 	orders[i] = NULL;
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return orders;
@@ -854,7 +774,9 @@ struct user_order *new_user_order() {
 struct user_order *getorder(struct bittrex_info *bi, char *uuid){
 	struct user_order *o;
 	json_t *result, *root;
-	char *url, *nonce, *hmac;
+	struct url u, uh;
+	char *url, *hmac, *hedge = NULL, *hedgehmac = NULL;
+	char nonce[NONCE_SIZE], hedgenonce[NONCE_SIZE];
 
 	if (!api_is_valid(bi->api) || !uuid ) {
 		fprintf(stderr, "getorder: bad parameter %s\n",
@@ -862,24 +784,31 @@ struct user_order *getorder(struct bittrex_info *bi, char *uuid){
 		return NULL;
 	}
 
-	nonce = getnonce();
-
-	url = malloc(strlen(GETORDER) + strlen(bi->api->key) +
-		     strlen("&nonce=") + strlen(nonce) +
-		     strlen("&uuid=") + strlen(uuid) +1);
-	url[0]='\0';
-	url = strcat(url, GETORDER);
-	url = strcat(url, bi->api->key);
-	url = strcat(url, "&uuid=");
-	url = strcat(url, uuid);
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
-	hmac = hmacstr(bi->api->secret, url);
-
-	root = api_call_sec(bi, url, hmac, GETORDER);
+	getnonce(nonce);
+
+	url_init(&u, GETORDER);
+	url_value(&u, bi->api->key);
+	url_param(&u, "uuid", uuid);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return NULL;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
+
+	/* duplicate request for --hedge, signed with its own nonce */
+	if (bi->hedge.enabled) {
+		getnonce(hedgenonce);
+		url_init(&uh, GETORDER);
+		url_value(&uh, bi->api->key);
+		url_param(&uh, "uuid", uuid);
+		url_param(&uh, "nonce", hedgenonce);
+		if ((hedge = url_str(&uh)))
+			hedgehmac = hmacstr_ctx(&(bi->api->signer), hedge);
+	}
+
+	root = api_call_hedged(bi, url, hmac, hedge, hedgehmac, GETORDER);
+	free(hedgehmac);
 	if (!root) {
 		fprintf(stderr, "getorder: API call failed (%s)\n", url);
-		free(url);
 		return NULL;
 	}
 
@@ -893,8 +822,6 @@ struct user_order *getorder(struct bittrex_info *bi, char *uuid){
 	json_order_get(bi, o, result);
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 
 	return o;
@@ -902,7 +829,9 @@ struct user_order *getorder(struct bittrex_info *bi, char *uuid){
 
 void getwithdrawalhistory(struct bittrex_info *bi, struct currency *c) {
 	json_t *result, *root, *raw, *tmp;
-	char *url, *nonce, *hmac;
+	struct url u;
+	char *url, *hmac;
+	char nonce[NONCE_SIZE];
 	int i = 0, size = 0;
 
 	if (!api_is_valid(bi->api)) {
@@ -910,32 +839,20 @@ void getwithdrawalhistory(struct bittrex_info *bi, struct currency *c) {
 		return;
 	}
 
-	nonce = getnonce();
-
-	if (c) {
-		url = malloc(strlen(GETWITHDRAWALHISTORY) + strlen(bi->api->key) +
-			     strlen("&nonce=") + strlen(nonce) +
-			     strlen("&currency=") + strlen(c->coin) + 1);
-	} else {
-		url = malloc(strlen(GETWITHDRAWALHISTORY) + strlen(bi->api->key) +
-			     strlen("&nonce=") + strlen(nonce) + 1);
-	}
-	url[0]='\0';
-	url = strcat(url, GETWITHDRAWALHISTORY);
-	url = strcat(url, bi->api->key);
-	if (c) {
-		url = strcat(url, "&currency=");
-		url = strcat(url, c->coin);
-	}
-	url = strcat(url, "&nonce=");
-	url = strcat(url, nonce);
+	getnonce(nonce);
 
-	hmac = hmacstr(bi->api->secret, url);
+	url_init(&u, GETWITHDRAWALHISTORY);
+	url_value(&u, bi->api->key);
+	if (c)
+		url_param(&u, "currency", c->coin);
+	url_param(&u, "nonce", nonce);
+	if (!(url = url_str(&u)))
+		return;
+	hmac = hmacstr_ctx(&(bi->api->signer), url);
 
 	root = api_call_sec(bi, url, hmac, GETWITHDRAWALHISTORY);
 	if (!root) {
 		fprintf(stderr, "getwithdrawalhistory: API call failed (%s)\n", url);
-		free(url);
 		return;
 	}
 
@@ -989,8 +906,6 @@ void getwithdrawalhistory(struct bittrex_info *bi, struct currency *c) {
 	}
 
 	json_decref(root);
-	free(url);
-	free(nonce);
 	free(hmac);
 }
 
@@ -998,13 +913,8 @@ void getwithdrawalhistory(struct bittrex_info *bi, struct currency *c) {
  * FREE functions below
  */
 void free_balances(struct balance **b) {
-	struct balance **tmp = b;
-
-	while (tmp && *tmp) {
-		free_balance(*tmp);
-		tmp++;
-	}
-	free(b);
+	/* allocated in one arena by getbalances() */
+	free_arena_list(b);
 }
 
 void free_balance(struct balance *b) {
@@ -1030,13 +940,8 @@ void free_api(struct api *a) {
 }
 
 void free_deposits(struct deposit **deposits) {
-	struct deposit **tmp = deposits;
-
-	while (tmp && *tmp) {
-		free_deposit(*tmp);
-		tmp++;
-	}
-	free(deposits);
+	/* allocated in one arena by getdeposithistory() */
+	free_arena_list(deposits);
 }
 
 void free_deposit(struct deposit *deposit) {
@@ -1051,13 +956,8 @@ void free_deposit(struct deposit *deposit) {
 }
 
 void free_user_orders(struct user_order **orders) {
-	struct user_order **tmp = orders;
-
-	while (tmp && *tmp) {
-		free_user_order(*tmp);
-		tmp++;
-	}
-	free(orders);
+	/* allocated in one arena by getorderhistory() or getopenorders() */
+	free_arena_list(orders);
 }
 
 void free_user_order(struct user_order *o) {
@@ -1082,21 +982,54 @@ void free_user_order(struct user_order *o) {
 /*
  * Print functions below
  */
+static void order_record(struct fmt *out, struct user_order *o) {
+	fmt_begin(out);
+	fmt_str(out, "OrderUuid", o->orderuuid);
+	fmt_str(out, "Exchange", o->market ? o->market->marketname : NULL);
+	fmt_str(out, "OrderType", o->ordertype);
+	fmt_fixed(out, "Quantity", o->quantity);
+	fmt_fixed(out, "QuantityRemaining", o->quantityremaining);
+	fmt_fixed(out, "Limit", o->limit);
+	fmt_fixed(out, "Reserved", o->reserved);
+	fmt_fixed(out, "ReserveRemaining", o->reservedremaining);
+	fmt_fixed(out, "CommissionReserved", o->commissionreserved);
+	fmt_fixed(out, "CommissionReserveRemaining", o->commissionRR);
+	fmt_fixed(out, "CommissionPaid", o->commission);
+	fmt_fixed(out, "Price", o->price);
+	fmt_fixed(out, "PricePerUnit", o->priceperunit);
+	fmt_str(out, "Opened", o->timestamp);
+	fmt_bool(out, "IsOpen", o->isopen);
+	fmt_bool(out, "CancelInitiated", o->cancelinitiaded);
+	fmt_bool(out, "ImmediateOrCancel", o->immediateorcancel);
+	fmt_bool(out, "IsConditional", o->isconditional);
+	fmt_str(out, "Condition", o->condition);
+	fmt_str(out, "ConditionTarget", o->conditiontarget);
+	fmt_end(out);
+}
+
 void printorder(struct user_order *o) {
+	struct fmt out;
+
+	if (o && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		order_record(&out, o);
+		fmt_flush(&out);
+		return;
+	}
 	if (o) {
 		printf("UUID:\t\t\t\t%s\n", o->orderuuid);
 		printf("Exchange:\t\t\t%s\n", o->market->marketname);
 		printf("OrderType:\t\t\t%s\n", o->ordertype);
-		printf("Quantity:\t\t\t%.8f\n", o->quantity);
-		printf("QuantityRemaining:\t\t%.8f\n", o->quantityremaining);
-		printf("Limit:\t\t\t\t%.8f\n", o->limit);
-		printf("Reserved:\t\t\t%.8f\n", o->reserved);
-		printf("ReservedRemaining:\t\t%.8f\n", o->reservedremaining);
-		printf("CommissionReserved:\t\t%.8f\n", o->commissionreserved);
-		printf("CommissionReservedRemaining:\t%.8f\n", o->commissionRR);
-		printf("CommissionPaid:\t\t\t%.8f\n", o->commission);
-		printf("Price:\t\t\t\t%.8f\n", o->price);
-		printf("PricePerUnit:\t\t\t%.8f\n", o->priceperunit);
+		printf("Quantity:\t\t\t%.8f\n", fixed_to_double(o->quantity));
+		printf("QuantityRemaining:\t\t%.8f\n", fixed_to_double(o->quantityremaining));
+		printf("Limit:\t\t\t\t%.8f\n", fixed_to_double(o->limit));
+		printf("Reserved:\t\t\t%.8f\n", fixed_to_double(o->reserved));
+		printf("ReservedRemaining:\t\t%.8f\n", fixed_to_double(o->reservedremaining));
+		printf("CommissionReserved:\t\t%.8f\n", fixed_to_double(o->commissionreserved));
+		printf("CommissionReservedRemaining:\t%.8f\n", fixed_to_double(o->commissionRR));
+		printf("CommissionPaid:\t\t\t%.8f\n", fixed_to_double(o->commission));
+		printf("Price:\t\t\t\t%.8f\n", fixed_to_double(o->price));
+		printf("PricePerUnit:\t\t\t%.8f\n", fixed_to_double(o->priceperunit));
 		printf("Opened:\t\t\t\t%s\n", o->timestamp);
 		printf("IsOpen:\t\t\t\t%s\n", o->isopen ? "true" : "false");
 		printf("CancelInitiated:\t\t%s\n", o->cancelinitiaded ? "true" : "false");
@@ -1110,7 +1043,15 @@ void printorder(struct user_order *o) {
 
 void printorders(struct user_order **o) {
 	struct user_order **tmp = o;
+	struct fmt out;
 
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++)
+			order_record(&out, *tmp);
+		fmt_flush(&out);
+		return;
+	}
 	while (tmp && *tmp) {
 		printorder(*tmp);
 		printf("\n");
@@ -1118,21 +1059,48 @@ void printorders(struct user_order **o) {
 	}
 }
 
+static void balance_record(struct fmt *out, struct balance *b) {
+	fmt_begin(out);
+	fmt_str(out, "Currency", b->currency ? b->currency->coin : NULL);
+	fmt_fixed(out, "Balance", b->balance);
+	fmt_fixed(out, "Available", b->available);
+	fmt_fixed(out, "Pending", b->pending);
+	fmt_bool(out, "Requested", b->requested);
+	fmt_end(out);
+}
+
 void printbalance(struct balance *b) {
+	struct fmt out;
+
+	if (b && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		balance_record(&out, b);
+		fmt_flush(&out);
+		return;
+	}
 	if (b) {
 		if (b->currency)
 			printf("Currency: %s\n", b->currency->coin);
 		else
 			printf("missing currency name\n");
-		printf("Balance: %.8f\n", b->balance);
-		printf("Available: %.8f\n", b->available);
-		printf("Pending: %.8f\n", b->pending);
+		printf("Balance: %.8f\n", fixed_to_double(b->balance));
+		printf("Available: %.8f\n", fixed_to_double(b->available));
+		printf("Pending: %.8f\n", fixed_to_double(b->pending));
 		printf("Requested: %d\n\n", b->requested);
 	}
 }
 
 void printbalances(struct balance **b) {
 	struct balance **tmp;
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (tmp = b; tmp && *tmp; tmp++)
+			balance_record(&out, *tmp);
+		fmt_flush(&out);
+		return;
+	}
 
 	if(b && *b) {
 		tmp = b;
@@ -1143,8 +1111,39 @@ void printbalances(struct balance **b) {
 	}
 }
 
+void printdepositaddress(struct currency *c, char *address) {
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		fmt_begin(&out);
+		fmt_str(&out, "Currency", c->coin);
+		fmt_str(&out, "Address", address);
+		fmt_end(&out);
+		fmt_flush(&out);
+		return;
+	}
+	printf("Currency %s deposit address: %s\n", c->coin, address);
+}
 void printdeposithistory(struct deposit **dep) {
 	struct deposit **tmp = dep;
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++) {
+			fmt_begin(&out);
+			fmt_int(&out, "PaymentUid", (*tmp)->paymentuid);
+			fmt_str(&out, "Currency", (*tmp)->currency ? (*tmp)->currency->coin : NULL);
+			fmt_real(&out, "Amount", (*tmp)->amount);
+			fmt_str(&out, "Address", (*tmp)->address);
+			fmt_str(&out, "Opened", (*tmp)->timestamp);
+			fmt_str(&out, "TxId", (*tmp)->txid);
+			fmt_end(&out);
+		}
+		fmt_flush(&out);
+		return;
+	}
 
 	while (tmp && *tmp) {
 		printf("PaymentUid:\t%d\n", (*tmp)->paymentuid);
@@ -26,19 +26,23 @@
 #define ACCOUNT_H
 
 #include <time.h>
+#include "lib/hmac/hmac_sha2.h"
 #include "bittrex.h"
+#include "fixed.h"
 #include "market.h"
 
 struct api {
 	char *key;
 	char *secret;
+	/* HMAC key schedule of secret, computed once in new_api */
+	hmac_sha512_ctx signer;
 };
 
 struct balance {
 	struct currency *currency;
-	double balance;
-	double available;
-	double pending;
+	fixed_t balance;
+	fixed_t available;
+	fixed_t pending;
 	char *cryptoaddress;
 	int requested;
 };
@@ -47,16 +51,16 @@ struct user_order {
 	char *orderuuid;
 	struct market *market;
 
-	double quantity;
-	double quantityremaining;
-	double limit;
-	double commission;
-	double price;
-	double priceperunit;
-	double reserved;
-	double reservedremaining;
-	double commissionreserved;
-	double commissionRR;
+	fixed_t quantity;
+	fixed_t quantityremaining;
+	fixed_t limit;
+	fixed_t commission;
+	fixed_t price;
+	fixed_t priceperunit;
+	fixed_t reserved;
+	fixed_t reservedremaining;
+	fixed_t commissionreserved;
+	fixed_t commissionRR;
 	int isopen;
 	int isconditional;
 	int immediateorcancel;
@@ -89,8 +93,8 @@ struct user_order **getopenorders(struct bittrex_info *bi, struct market *m);
 char *getdepositaddress(struct bittrex_info *bi, struct currency *c, struct api *apikey);
 int withdraw(struct bittrex_info *bi, struct currency *c, double quantity, char *destaddress, char *paymentid);
 int cancel(struct bittrex_info *bi, char *uuid);
-char *buylimit(struct bittrex_info *bi, struct market *m, double quantity, double rate);
-char *selllimit(struct bittrex_info *bi, struct market *m, double quantity, double rate);
+char *buylimit(struct bittrex_info *bi, struct market *m, fixed_t quantity, fixed_t rate);
+char *selllimit(struct bittrex_info *bi, struct market *m, fixed_t quantity, fixed_t rate);
 void getwithdrawalhistory(struct bittrex_info *bi, struct currency *c);
 
 void free_user_order(struct user_order *o);
@@ -104,6 +108,7 @@ void free_balances(struct balance **b);
 void printbalance(struct balance *b);
 void printbalances(struct balance **b);
 void printdeposithistory(struct deposit **dep);
+void printdepositaddress(struct currency *c, char *address);
 void printorder(struct user_order *o);
 void printorders(struct user_order **o);
 
@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+
+int64_t interval_seconds(char *interval) {
+	if (!interval)
+		return 0;
+	if (strcmp(interval, "oneMin") == 0)
+		return 60;
+	if (strcmp(interval, "fiveMin") == 0)
+		return 300;
+	if (strcmp(interval, "thirtyMin") == 0)
+		return 1800;
+	if (strcmp(interval, "Hour") == 0)
+		return 3600;
+	if (strcmp(interval, "Day") == 0)
+		return 86400;
+	return 0;
+}
+
+static char *archive_path(char *dir, char *marketname, char *interval) {
+	char *path;
+
+	path = malloc(strlen(dir) + strlen(marketname) + strlen(interval) + 3);
+	if (path)
+		sprintf(path, "%s/%s.%s", dir, marketname, interval);
+	return path;
+}
+
+static int compare_candles(const void *a, const void *b) {
+	const struct archive_candle *ca = a, *cb = b;
+
+	if (ca->timestamp < cb->timestamp)
+		return -1;
+	return ca->timestamp > cb->timestamp;
+}
+
+int archive_ticks(char *dir, struct market *m, char *interval, struct tick **ticks) {
+	struct archive_header h;
+	struct archive_candle *c, last;
+	struct stat st;
+	char *path;
+	off_t end;
+	int fd, i, nb, first, added = 0;
+
+	if (!dir || !m || !ticks || !interval_seconds(interval))
+		return -1;
+
+	for (nb = 0; ticks[nb]; nb++);
+	if (nb < 2)
+		return 0;
+	c = malloc(nb * sizeof(struct archive_candle));
+	if (!c)
+		return -1;
+	for (i = 0; i < nb; i++) {
+		c[i].timestamp = ticks[i]->timestamp / 1000;
+		c[i].open = ticks[i]->open;
+		c[i].high = ticks[i]->high;
+		c[i].low = ticks[i]->low;
+		c[i].close = ticks[i]->close;
+		c[i].volume = ticks[i]->volume;
+		c[i].btcval = ticks[i]->btcval;
+	}
+	qsort(c, nb, sizeof(struct archive_candle), compare_candles);
+	/* newest candle is still open */
+	nb--;
+
+	path = archive_path(dir, m->marketname, interval);
+	if (!path || (fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		fprintf(stderr, "archive: could not open %s\n", path ? path : dir);
+		free(path);
+		free(c);
+		return -1;
+	}
+	free(path);
+	/* several threads (or processes) may archive the same market */
+	flock(fd, LOCK_EX);
+
+	if (fstat(fd, &st) < 0)
+		goto error;
+	if ((size_t)st.st_size < sizeof(h)) {
+		memset(&h, 0, sizeof(h));
+		h.magic = ARCHIVE_MAGIC;
+		h.version = ARCHIVE_VERSION;
+		h.interval = interval_seconds(interval);
+		strncpy(h.marketname, m->marketname, sizeof(h.marketname) - 1);
+		if (pwrite(fd, &h, sizeof(h), 0) != sizeof(h))
+			goto error;
+		end = sizeof(h);
+		last.timestamp = 0;
+	} else {
+		if (pread(fd, &h, sizeof(h), 0) != sizeof(h) ||
+		    h.magic != ARCHIVE_MAGIC || h.version != ARCHIVE_VERSION)
+			goto error;
+		end = st.st_size - (st.st_size - sizeof(h)) % sizeof(last);
+		last.timestamp = 0;
+		if (end > (off_t)sizeof(h) &&
+		    pread(fd, &last, sizeof(last), end - sizeof(last)) != sizeof(last))
+			goto error;
+	}
+
+	for (first = 0; first < nb && c[first].timestamp <= last.timestamp; first++);
+	if (first < nb) {
+		added = nb - first;
+		if (pwrite(fd, &c[first], added * sizeof(struct archive_candle), end) !=
+		    (ssize_t)(added * sizeof(struct archive_candle)))
+			goto error;
+		end += added * sizeof(struct archive_candle);
+	}
+	/* drop torn record if any */
+	if (end != st.st_size && ftruncate(fd, end) < 0)
+		goto error;
+
+	flock(fd, LOCK_UN);
+	close(fd);
+	free(c);
+	return added;
+
+error:
+	fprintf(stderr, "archive: could not append to %s archive (%s)\n",
+		m->marketname, interval);
+	flock(fd, LOCK_UN);
+	close(fd);
+	free(c);
+	return -1;
+}
+
+struct archive *archive_open(char *dir, char *marketname, char *interval) {
+	struct archive *a;
+	struct stat st;
+	char *path;
+	int fd;
+
+	if (!dir || !marketname || !interval)
+		return NULL;
+	path = archive_path(dir, marketname, interval);
+	if (!path)
+		return NULL;
+	fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct archive_header)) {
+		close(fd);
+		return NULL;
+	}
+
+	a = malloc(sizeof(struct archive));
+	a->size = st.st_size;
+	a->map = mmap(NULL, a->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (a->map == MAP_FAILED) {
+		free(a);
+		return NULL;
+	}
+	a->header = (struct archive_header *)a->map;
+	if (a->header->magic != ARCHIVE_MAGIC || a->header->version != ARCHIVE_VERSION) {
+		fprintf(stderr, "archive: %s %s is invalid\n", marketname, interval);
+		archive_close(a);
+		return NULL;
+	}
+	a->candles = (struct archive_candle *)(a->header + 1);
+	a->nbcandles = (a->size - sizeof(struct archive_header)) / sizeof(struct archive_candle);
+	/* sequential scans are the common case (backtests, exports) */
+	madvise(a->map, a->size, MADV_SEQUENTIAL);
+	return a;
+}
+
+size_t archive_find(struct archive *a, int64_t ts) {
+	size_t lo = 0, hi = a->nbcandles, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (a->candles[mid].timestamp < ts)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+void archive_close(struct archive *a) {
+	if (a) {
+		munmap(a->map, a->size);
+		free(a);
+	}
+}
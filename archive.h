@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bittrex.h"
+#include "market.h"
+
+#define ARCHIVE_MAGIC	0x4c444e43 /* "CNDL" */
+#define ARCHIVE_VERSION	1
+
+/*
+ * One file per market and interval: <dir>/<market>.<interval>
+ * header followed by fixed size candles sorted by timestamp.
+ * Only closed candles are appended, the number of candles is
+ * given by the file size (a torn record is dropped on next append).
+ */
+struct archive_header {
+	uint32_t magic;
+	uint32_t version;
+	int64_t interval;	/* seconds */
+	char marketname[32];
+};
+
+struct archive_candle {
+	int64_t timestamp;	/* UTC epoch seconds, candle open time */
+	double open;
+	double high;
+	double low;
+	double close;
+	double volume;
+	double btcval;
+};
+
+/*
+ * Read only mapping of an archive
+ */
+struct archive {
+	void *map;
+	size_t size;
+	struct archive_header *header;
+	struct archive_candle *candles;
+	size_t nbcandles;
+};
+
+/*
+ * interval name (oneMin, fiveMin, thirtyMin, Hour, Day) to seconds, 0 if unknown
+ */
+int64_t interval_seconds(char *interval);
+
+/*
+ * Append closed candles of ticks (any order) newer than the last archived one.
+ * Used by getticks() when bi->archivedir is set.
+ * return number of candles appended, -1 on error.
+ */
+int archive_ticks(char *dir, struct market *m, char *interval, struct tick **ticks);
+
+/*
+ * Map archive of market and interval, NULL if none
+ */
+struct archive *archive_open(char *dir, char *marketname, char *interval);
+
+/*
+ * index of first candle with timestamp >= ts (nbcandles if none)
+ */
+size_t archive_find(struct archive *a, int64_t ts);
+
+void archive_close(struct archive *a);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN	16
+#define ALIGN_UP(x)	(((x) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+static struct arena_block *new_block(size_t size) {
+	struct arena_block *b;
+
+	if (!(b = malloc(ALIGN_UP(sizeof(struct arena_block)) + size)))
+		return NULL;
+	b->next = NULL;
+	b->size = size;
+	b->used = 0;
+	return b;
+}
+
+struct arena *new_arena(size_t blocksize) {
+	struct arena_block *b;
+	struct arena *a;
+
+	if (blocksize < ALIGN_UP(sizeof(struct arena)))
+		blocksize = ARENA_BLOCKSIZE;
+	if (!(b = new_block(blocksize)))
+		return NULL;
+	a = (struct arena *)((char *)b + ALIGN_UP(sizeof(struct arena_block)));
+	b->used = ALIGN_UP(sizeof(struct arena));
+	a->head = b;
+	a->blocksize = blocksize;
+	return a;
+}
+
+void *arena_alloc(struct arena *a, size_t size) {
+	struct arena_block *b = a->head;
+	void *p;
+
+	size = ALIGN_UP(size);
+	if (size > a->blocksize / 2) {
+		/* large objects get their own block, current one is kept */
+		if (!(b = new_block(size)))
+			return NULL;
+		b->next = a->head->next;
+		a->head->next = b;
+	} else if (b->size - b->used < size) {
+		if (!(b = new_block(a->blocksize)))
+			return NULL;
+		b->next = a->head;
+		a->head = b;
+	}
+	p = (char *)b + ALIGN_UP(sizeof(struct arena_block)) + b->used;
+	b->used += size;
+	return p;
+}
+
+void *arena_calloc(struct arena *a, size_t size) {
+	void *p;
+
+	if ((p = arena_alloc(a, size)))
+		memset(p, 0, size);
+	return p;
+}
+
+char *arena_strdup(struct arena *a, const char *s) {
+	size_t len;
+	char *d;
+
+	if (!s)
+		return NULL;
+	len = strlen(s) + 1;
+	if ((d = arena_alloc(a, len)))
+		memcpy(d, s, len);
+	return d;
+}
+
+char *json_string_arena(struct arena *a, json_t *tmp) {
+	if (tmp && json_string_value(tmp))
+		return arena_strdup(a, json_string_value(tmp));
+	return NULL;
+}
+
+void *arena_list(struct arena *a, size_t n) {
+	void **list;
+
+	if (!(list = arena_alloc(a, (n + 2) * sizeof(void *))))
+		return NULL;
+	list[0] = a;
+	list[n + 1] = NULL;
+	return list + 1;
+}
+
+void free_arena_list(void *list) {
+	if (list)
+		free_arena(((struct arena **)list)[-1]);
+}
+
+void free_arena(struct arena *a) {
+	struct arena_block *b, *next;
+
+	if (!a)
+		return;
+	/* a is in one of the blocks, do not use it in the loop */
+	for (b = a->head; b; b = next) {
+		next = b->next;
+		free(b);
+	}
+}
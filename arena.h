@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "lib/jansson/src/jansson.h"
+
+#define ARENA_BLOCKSIZE	8192
+
+/*
+ * Region allocator: objects parsed from one API reply are allocated
+ * in the same arena and released together by free_arena().
+ */
+struct arena_block {
+	struct arena_block *next;
+	size_t size;
+	size_t used;
+};
+
+struct arena {
+	struct arena_block *head;
+	size_t blocksize;
+};
+
+/*
+ * The arena itself lives in its first block
+ */
+struct arena *new_arena(size_t blocksize);
+void *arena_alloc(struct arena *a, size_t size);
+void *arena_calloc(struct arena *a, size_t size);
+char *arena_strdup(struct arena *a, const char *s);
+
+/*
+ * same as json_string_get() but allocated in arena
+ */
+char *json_string_arena(struct arena *a, json_t *tmp);
+
+/*
+ * NULL terminated array of n pointers allocated in a, a is kept just
+ * before the array so that free_arena_list(list) releases everything.
+ */
+void *arena_list(struct arena *a, size_t n);
+void free_arena_list(void *list);
+
+void free_arena(struct arena *a);
+
+#endif
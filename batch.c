@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "batch.h"
+
+/*
+ * Commands never ending or waiting for an answer on stdin
+ */
+static const char *batch_refused[] = {
+	"-b", "--bot", "--collect", "--withdraw", "--daemon", "--batch", "--socket",
+	NULL
+};
+
+struct batch_job {
+	char *line;
+	int lineno;
+	pid_t pid;
+	FILE *out;	/* stdout of the command */
+	int status;
+	int done;
+};
+
+/*
+ * Split line in place, double or single quotes group words.
+ * return the number of arguments (argv[0] is the program), -1 if invalid.
+ */
+static int split_line(char *line, char **argv) {
+	char *r = line, *w = line, quote;
+	int argc = 1;
+
+	argv[0] = "bittrex";
+	while (1) {
+		while (*r == ' ' || *r == '\t')
+			r++;
+		if (!*r || *r == '#')
+			break;
+		if (argc == BATCH_MAXARGS)
+			return -1;
+		argv[argc++] = w;
+		while (*r && *r != ' ' && *r != '\t') {
+			if (*r != '"' && *r != '\'') {
+				*w++ = *r++;
+				continue;
+			}
+			quote = *r++;
+			while (*r && *r != quote)
+				*w++ = *r++;
+			if (!*r)
+				return -1;
+			r++;
+		}
+		/* r may point to the separator still needed, w is behind it */
+		if (*r)
+			r++;
+		*w++ = '\0';
+	}
+	argv[argc] = NULL;
+	return argc;
+}
+
+static int refused(int argc, char **argv) {
+	int i, j;
+
+	for (i = 1; i < argc; i++) {
+		for (j = 0; batch_refused[j]; j++) {
+			if (strncmp(argv[i], batch_refused[j], strlen(batch_refused[j])) == 0 &&
+			    (argv[i][strlen(batch_refused[j])] == '\0' ||
+			     argv[i][strlen(batch_refused[j])] == '='))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Fork the command of job, its stdout is a temporary file
+ */
+static void batch_start(struct bittrex_info *bi, struct batch_job *job, daemon_cmd cmd) {
+	char *argv[BATCH_MAXARGS + 1];
+	int argc, fd;
+
+	if ((argc = split_line(job->line, argv)) < 0 || refused(argc, argv)) {
+		fprintf(stderr, "line %d: invalid or unsupported command in batch\n",
+			job->lineno);
+		job->status = EINVAL;
+		job->done = 1;
+		return;
+	}
+	if (!(job->out = tmpfile())) {
+		perror("batch: tmpfile");
+		job->status = EIO;
+		job->done = 1;
+		return;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	if ((job->pid = fork()) == 0) {
+		dup2(fileno(job->out), 1);
+		if ((fd = open("/dev/null", O_RDONLY)) >= 0) {
+			dup2(fd, 0);
+			close(fd);
+		}
+		optind = 0;
+		exit(cmd(bi, argc, argv));
+	}
+	if (job->pid < 0) {
+		perror("batch: fork");
+		fclose(job->out);
+		job->out = NULL;
+		job->status = EAGAIN;
+		job->done = 1;
+	}
+}
+
+static void batch_print(struct batch_job *job) {
+	char buf[4096];
+	size_t n;
+
+	if (job->out) {
+		rewind(job->out);
+		while ((n = fread(buf, 1, sizeof(buf), job->out)) > 0)
+			fwrite(buf, 1, n, stdout);
+		fclose(job->out);
+		job->out = NULL;
+	}
+	fflush(stdout);
+	if (job->status)
+		fprintf(stderr, "line %d: exit status %d\n", job->lineno, job->status);
+}
+
+int batch_run(struct bittrex_info *bi, FILE *in, int jobs, daemon_cmd cmd) {
+	struct batch_job *job = NULL;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	pid_t pid;
+	int nbjobs = 0, lineno = 0, next = 0, printed = 0, running = 0;
+	int i, status, rc = 0;
+
+	while ((len = getline(&line, &size, in)) >= 0) {
+		lineno++;
+		if (len > 0 && line[len-1] == '\n')
+			line[len-1] = '\0';
+		if (line[strspn(line, " \t")] == '\0' || line[strspn(line, " \t")] == '#')
+			continue;
+		job = realloc(job, (nbjobs + 1) * sizeof(struct batch_job));
+		memset(&job[nbjobs], 0, sizeof(struct batch_job));
+		job[nbjobs].line = strdup(line);
+		job[nbjobs].lineno = lineno;
+		nbjobs++;
+	}
+	free(line);
+	if (!nbjobs)
+		return 0;
+	if (jobs < 1)
+		jobs = 1;
+	if (daemon_prepare(bi) != 0) {
+		free(job);
+		return ENOMEM;
+	}
+
+	while (printed < nbjobs) {
+		while (running < jobs && next < nbjobs) {
+			batch_start(bi, &job[next], cmd);
+			if (!job[next].done)
+				running++;
+			next++;
+		}
+		if (running) {
+			if ((pid = wait(&status)) < 0) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			for (i = 0; i < next && job[i].pid != pid; i++);
+			if (i < next) {
+				job[i].status = daemon_exit_code(status);
+				job[i].done = 1;
+				running--;
+			}
+		}
+		/* outputs in input order, as soon as they are complete */
+		while (printed < nbjobs && job[printed].done) {
+			batch_print(&job[printed]);
+			if (job[printed].status && !rc)
+				rc = job[printed].status;
+			printed++;
+		}
+	}
+
+	for (i = 0; i < nbjobs; i++)
+		free(job[i].line);
+	free(job);
+	return rc;
+}
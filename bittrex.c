@@ -27,25 +27,99 @@
 #include <time.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include "lib/jansson/src/jansson.h"
 #include "bittrex.h"
 #include "market.h"
 #include "account.h"
+#include "snapshot.h"
+#include "intern.h"
 
 /*
- * return simple nonce for api with key calls
+ * Last nonce given, shared by all threads (only updated by CAS),
+ * and by daemon children once nonce_share() was called.
  */
-char *getnonce() {
-	char *nonce;
-	struct timeval tv;
+static uint64_t localnonce;
+static uint64_t *lastnonce = &localnonce;
 
-	gettimeofday(&tv, NULL);
-	nonce = malloc(11);
-	nonce[0] = '\0';
-	sprintf(nonce, "%d", (int)tv.tv_sec);
-	return nonce;
+/*
+ * DNS cache and TLS sessions shared by all transfers (and inherited by
+ * daemon children): new connections skip the lookup and full handshake.
+ */
+static CURLSH *share;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *curl, curl_lock_data data, curl_lock_access access,
+		       void *userp) {
+	(void)curl;
+	(void)access;
+	(void)userp;
+	pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *curl, curl_lock_data data, void *userp) {
+	(void)curl;
+	(void)userp;
+	pthread_mutex_unlock(&share_locks[data]);
+}
+
+static void share_init(void) {
+	int i;
+
+	if (!(share = curl_share_init()))
+		return;
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+		pthread_mutex_init(&share_locks[i], NULL);
+	curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+	curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+void request_share(CURL *curl) {
+	if (share)
+		curl_easy_setopt(curl, CURLOPT_SHARE, share);
+}
+
+int nonce_share(void) {
+	uint64_t *p;
+
+	p = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "Could not map shared nonce\n");
+		return -1;
+	}
+	*p = *lastnonce;
+	lastnonce = p;
+	return 0;
+}
 
+char *getnonce(char *buf) {
+	struct timespec ts;
+	uint64_t now, last, next;
+	char tmp[NONCE_SIZE];
+	int i = 0, len = 0;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	/* never twice the same, even within one microsecond or if clock goes back */
+	last = __atomic_load_n(lastnonce, __ATOMIC_RELAXED);
+	do {
+		next = now > last ? now : last + 1;
+	} while (!__atomic_compare_exchange_n(lastnonce, &last, next, 0,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	do {
+		tmp[i++] = '0' + next % 10;
+		next /= 10;
+	} while (next);
+	while (i > 0)
+		buf[len++] = tmp[--i];
+	buf[len] = '\0';
+	return buf;
 }
 
 /*
@@ -70,10 +144,18 @@ struct bittrex_info *bittrex_info() {
 
 	bi->trades_active = 0;
 	bi->terminate = 0;
+	bi->snapshotpath = NULL;
+	bi->snapshot = NULL;
+	bi->archivedir = NULL;
+	bi->strategies = NULL;
+	retry_init(&(bi->retry));
+	hedge_init(&(bi->hedge));
+	cache_init(&(bi->cache));
 	pthread_mutex_init(&(bi->bi_lock), NULL);
 
 	// this call is not thread safe, must be called only once
 	curl_global_init(CURL_GLOBAL_ALL);
+	share_init();
 
 	return bi;
 }
@@ -101,9 +183,17 @@ void free_bi(struct bittrex_info *bi) {
 		free_markets(bi->markets);
 		free_currencies(bi->currencies);
 		free_api(bi->api);
+		free_snapshot(bi->snapshot);
+		cache_free(&(bi->cache));
 		if (bi->lastcall)
 			free(bi->lastcall);
 		free(bi);
+		/* names of markets and currencies */
+		free_interned();
+	}
+	if (share) {
+		curl_share_cleanup(share);
+		share = NULL;
 	}
 	curl_global_cleanup();
 }
@@ -117,6 +207,64 @@ char *json_string_get(char *dest, json_t *tmp) {
 	return NULL;
 }
 
+/*
+ * fixed format, no sscanf/mktime: digits are at known offsets
+ */
+static int digits(const char *s, int n) {
+	int v = 0;
+
+	while (n--) {
+		if (*s < '0' || *s > '9')
+			return -1;
+		v = v * 10 + (*s++ - '0');
+	}
+	return v;
+}
+
+int64_t timestamp_ms(const char *iso) {
+	int y, mo, d, h, mi, s, ms = 0, n;
+	int64_t days;
+
+	if (!iso || strlen(iso) < 19 || iso[4] != '-' || iso[7] != '-' ||
+	    iso[10] != 'T' || iso[13] != ':' || iso[16] != ':')
+		return 0;
+	y = digits(iso, 4);
+	mo = digits(iso + 5, 2);
+	d = digits(iso + 8, 2);
+	h = digits(iso + 11, 2);
+	mi = digits(iso + 14, 2);
+	s = digits(iso + 17, 2);
+	if (y < 1970 || mo < 1 || mo > 12 || d < 1 || d > 31 ||
+	    h < 0 || h > 23 || mi < 0 || mi > 59 || s < 0 || s > 60)
+		return 0;
+	/* optional fraction, milliseconds only */
+	if (iso[19] == '.')
+		for (n = 0, iso += 20; n < 3; n++) {
+			ms *= 10;
+			if (*iso >= '0' && *iso <= '9')
+				ms += *iso++ - '0';
+		}
+
+	/* days from civil (proleptic gregorian), march based year */
+	y -= mo <= 2;
+	days = (int64_t)365 * y + y / 4 - y / 100 + y / 400 +
+		(153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1 - 719468;
+	return ((days * 24 + h) * 60 + mi) * 60000 + (int64_t)s * 1000 + ms;
+}
+
+char *timestamp_str(int64_t ms, char *buf, size_t size) {
+	time_t t = ms / 1000;
+	struct tm ctm;
+
+	gmtime_r(&t, &ctm);
+	strftime(buf, size, "%Y-%m-%dT%H:%M:%S", &ctm);
+	return buf;
+}
+
+int64_t json_timestamp_get(json_t *tmp) {
+	return timestamp_ms(json_string_value(tmp));
+}
+
 double json_real_get(json_t *tmp) {
 	if (tmp && json_real_value(tmp)) {
 		return json_real_value(tmp);
@@ -161,6 +309,7 @@ char *request(const char *url)
     };
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
+    request_share(curl);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &write_result);
 
@@ -215,6 +364,7 @@ char *apikey_request(const char *url, char *hmac)
     };
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
+    request_share(curl);
     struct curl_slist *headers=NULL;
     char *tmpbuf = malloc(strlen("apisign:")+strlen(hmac)+1);
     tmpbuf[0] =  '\0';
@@ -260,32 +410,57 @@ error:
 
 
 /*
- * Call to bittrex API
- * Check success field
- * return null on error or ptr on json_t result
- *
- * Limit API call to 1/s (per call type)
- *
- * Sometimes API replies with success true but
- * result array or string is empty.
- * We replay the call until it returns normal output.
- * program could be blocked here in infinite recursion
- * if API keeps replying crap.
- *
+ * Limit API call to 1/s per type of call.
+ * lastcall is shared by all threads and replaced on each call.
  */
-json_t *api_call(struct bittrex_info *bi, char *call, char *rootcall) {
-	json_t *root, *result, *tmp;
-	json_error_t error;
-	char *reply;
-
+static int throttle(struct bittrex_info *bi, char *rootcall) {
+	int wait;
 
+	pthread_mutex_lock(&(bi->bi_lock));
 	if (!bi->lastcall_t)
 		bi->lastcall_t = time(NULL);
+	wait = strcmp(rootcall, bi->lastcall) == 0 &&
+		difftime(time(NULL), bi->lastcall_t) <= 1;
+	pthread_mutex_unlock(&(bi->bi_lock));
+	return wait;
+}
+
+/* *retry values of api_attempt() */
+#define ATTEMPT_FAILED	1	/* network error or invalid JSON */
+#define ATTEMPT_EMPTY	2	/* success true but empty result, API is up */
 
-	if (strcmp(rootcall, bi->lastcall) == 0 && difftime(time(NULL), bi->lastcall_t) <= 1)
+/*
+ * One call to bittrex API, check success field.
+ * *retry is set if the failure is worth replaying (network, invalid
+ * JSON, or success true with an empty result, which API sometimes does).
+ */
+static json_t *api_attempt(struct bittrex_info *bi, char *call, char *hmac,
+			   char *hedge, char *hedgehmac, char *rootcall, int *retry) {
+	json_t *root, *result, *tmp;
+	json_error_t error;
+	struct timespec start, end;
+	char *reply;
+	int cached = 0;
+
+	*retry = 0;
+	/* fresh reply of the same public call, see cache.h */
+	if (!hmac && (reply = cache_get(bi, call, rootcall))) {
+		cached = 1;
+		goto parse;
+	}
+	/* public calls only, each signed call has its own nonce (getnonce) */
+	if (!hmac && throttle(bi, rootcall))
 		sleep(1);
 
-	reply = request(call);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (hedge)
+		reply = hedged_request(bi, call, hmac, hedge, hedgehmac, rootcall);
+	else
+		reply = hmac ? apikey_request(call, hmac) : request(call);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (reply)
+		hedge_latency(bi, rootcall, (end.tv_sec - start.tv_sec) * 1000 +
+			      (end.tv_nsec - start.tv_nsec) / 1000000);
 
 	pthread_mutex_lock(&(bi->bi_lock));
 	bi->lastcall_t = time(NULL);
@@ -294,16 +469,19 @@ json_t *api_call(struct bittrex_info *bi, char *call, char *rootcall) {
 	strcpy(bi->lastcall, rootcall);
 	pthread_mutex_unlock(&(bi->bi_lock));
 
-	if(!reply)
+	if(!reply) {
+		*retry = ATTEMPT_FAILED;
 		return NULL;
+	}
 
+parse:
 	root = json_loads(reply, 0, &error);
-	free(reply);
 
 	if(!root)
 	{
 		fprintf(stderr, "error: on line %d: %s\n", error.line, error.text);
-		return NULL;
+		*retry = ATTEMPT_FAILED;
+		goto error;
 	}
 
 	result = json_object_get(root,"success");
@@ -312,76 +490,90 @@ json_t *api_call(struct bittrex_info *bi, char *call, char *rootcall) {
 		tmp = json_object_get(root, "message");
 		if (tmp && json_string_value(tmp))
 			printf("API replied: %s\n", json_string_value(tmp));
-		json_decref(root);
-		return NULL;
+		goto error;
+	}
+	if (hmac) {
+		free(reply);
+		return root;
 	}
 
 	result = json_object_get(root,"result");
 	if ((json_typeof(result) == JSON_ARRAY) &&  (json_array_size(result) == 0)) {
-		fprintf(stderr, "Error proccessing request: %s, result field(array) empty. ", call);
-		fprintf(stderr, "Retrying\n");
-		json_decref(root);
-		return api_call(bi, call, rootcall);
+		fprintf(stderr, "Error proccessing request: %s, result field(array) empty.\n", call);
+		*retry = ATTEMPT_EMPTY;
+		goto error;
 	}
 	if ((json_typeof(result) == JSON_STRING) && (strlen(json_string_value(result)) == 0)) {
-		fprintf(stderr, "Error proccessing request: %s, result field(string) empty. ", call);
-		fprintf(stderr, "Retrying\n");
-		json_decref(root);
-		return api_call(bi, call, rootcall);
+		fprintf(stderr, "Error proccessing request: %s, result field(string) empty.\n", call);
+		*retry = ATTEMPT_EMPTY;
+		goto error;
 	}
 
+	/* only valid replies are cached */
+	if (!cached)
+		cache_put(bi, call, rootcall, reply);
+	free(reply);
 	return root;
+
+error:
+	if (root)
+		json_decref(root);
+	free(reply);
+	return NULL;
 }
 
 /*
- * Call to bittrex API with API key
- * Check success field
+ * Call to bittrex API, signed if hmac, hedged if hedge
  * return null on error or ptr on json_t result
  *
- * Unlike api_call() we do not replay call on failures.
+ * Limit public API call to 1/s (per call type), replies of some public
+ * calls are reused while fresh (see cache.h)
+ *
+ * Failed attempts worth replaying are retried with exponential backoff
+ * (see retry.h) until RETRY_MAX_ATTEMPTS or the endpoint retry budget
+ * is reached. An endpoint failing call after call is paused
+ * (circuit breaker) and its calls return NULL at once.
+ *
+ * Signed calls are not replayed: the nonce and hmac are bound to this
+ * URL and orders must not be sent twice.
  */
-json_t *api_call_sec(struct bittrex_info *bi, char *call, char *hmac, char *rootcall) {
-	json_t *root, *result, *tmp;
-	json_error_t error;
-	char *reply;
-
-	if (!bi->lastcall_t)
-		bi->lastcall_t = time(NULL);
-
-	if (strcmp(rootcall, bi->lastcall) == 0 && difftime(time(NULL), bi->lastcall_t) <= 1)
-		sleep(1);
-
-	reply = apikey_request(call, hmac);
-
-	pthread_mutex_lock(&(bi->bi_lock));
-	bi->lastcall_t = time(NULL);
-	free(bi->lastcall);
-	bi->lastcall = malloc(strlen(rootcall) + 1);
-	strcpy(bi->lastcall, rootcall);
-	pthread_mutex_unlock(&(bi->bi_lock));
+static json_t *api_calls(struct bittrex_info *bi, char *call, char *hmac,
+			 char *hedge, char *hedgehmac, char *rootcall) {
+	json_t *root;
+	long delay;
+	int attempt, retry;
 
-
-	if(!reply)
+	if (retry_allow(bi, rootcall))
 		return NULL;
 
-	root = json_loads(reply, 0, &error);
-	free(reply);
-
-	if(!root)
-	{
-		fprintf(stderr, "error: on line %d: %s\n", error.line, error.text);
-		return NULL;
+	for (attempt = 0; ; attempt++) {
+		root = api_attempt(bi, call, hmac, hedge, hedgehmac, rootcall, &retry);
+		if (root || !retry || hmac)
+			break;
+		if ((delay = retry_backoff(bi, rootcall, attempt)) < 0)
+			break;
+		fprintf(stderr, "Retrying in %ldms\n", delay);
+		usleep(delay * 1000);
 	}
+	/*
+	 * API errors (success false) and empty results do not mean API is
+	 * down, they must not open the circuit.
+	 */
+	retry_done(bi, rootcall, root || retry != ATTEMPT_FAILED);
+	return root;
+}
 
-	result = json_object_get(root,"success");
-	if (json_typeof(result) != JSON_TRUE) {
-		fprintf(stderr, "Error proccessing request: %s\n", call);
-		tmp = json_object_get(root, "message");
-		if (tmp && json_string_value(tmp))
-			printf("API replied: %s\n", json_string_value(tmp));
-		json_decref(root);
-		return NULL;
-	}
+json_t *api_call(struct bittrex_info *bi, char *call, char *rootcall) {
+	return api_calls(bi, call, NULL, NULL, NULL, rootcall);
+}
 
-	return root;
+json_t *api_call_sec(struct bittrex_info *bi, char *call, char *hmac, char *rootcall) {
+	return api_calls(bi, call, hmac, NULL, NULL, rootcall);
+}
+
+json_t *api_call_hedged(struct bittrex_info *bi, char *call, char *hmac,
+			char *hedge, char *hedgehmac, char *rootcall) {
+	if (!bi->hedge.enabled)
+		hedge = hedgehmac = NULL;
+	return api_calls(bi, call, hmac, hedge, hedgehmac, rootcall);
 }
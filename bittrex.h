@@ -25,9 +25,14 @@
 #ifndef BITTREX_H
 #define BITTREX_H
 
+#include <stdint.h>
 #include <mysql/mysql.h>
+#include <curl/curl.h>
 
 #include "lib/jansson/src/jansson.h"
+#include "retry.h"
+#include "hedge.h"
+#include "cache.h"
 
 // do not use (won't work anyway), this is for history
 #define API_URL_V1 "https://bittrex.com/api/v1/"
@@ -113,6 +118,19 @@ struct bittrex_info {
 	int trades_active;
 	/* used to stop all thread */
 	int terminate;
+	/* warm state file for bot mode (NULL if not used) */
+	char *snapshotpath;
+	struct snapshot *snapshot;
+	/* candle archive directory (NULL if not used) */
+	char *archivedir;
+	/* retry budgets and circuit breakers per API call */
+	struct retry_policy retry;
+	/* latencies and hedged requests per API call */
+	struct hedge_policy hedge;
+	/* replies of public API calls (markets, currencies...) */
+	struct response_cache cache;
+	/* bot strategies "name[:params]", NULL terminated (NULL: default) */
+	char **strategies;
 };
 
 struct bittrex_info *bittrex_info();
@@ -128,13 +146,56 @@ int conn_init(struct bittrex_info *bi);
 double json_real_get(json_t *tmp);
 char *json_string_get(char *dest, json_t *tmp);
 
+/*
+ * API timestamp "2018-01-01T00:00:00[.123]" (UTC) to epoch milliseconds,
+ * 0 if malformed.
+ */
+int64_t timestamp_ms(const char *iso);
+
+/*
+ * epoch milliseconds to "2018-01-01T00:00:00" in buf (20 bytes at least)
+ */
+char *timestamp_str(int64_t ms, char *buf, size_t size);
+
+/*
+ * json custom getter for timestamps
+ */
+int64_t json_timestamp_get(json_t *tmp);
+
 /*
  * fixme : do a single api call function
  */
 char *request(const char *url);
+char *apikey_request(const char *url, char *hmac);
+size_t write_response(void *ptr, size_t size, size_t nmemb, void *stream);
+
+/*
+ * Share DNS cache and TLS sessions with other transfers (set on each handle)
+ */
+void request_share(CURL *curl);
 json_t *api_call(struct bittrex_info *bi, char *call, char *rootcall);
 json_t *api_call_sec(struct bittrex_info *bi, char *call, char *hmac, char *rootcall);
-char *getnonce();
+
+/*
+ * Read calls gating bot decisions: with --hedge, hedge (same request,
+ * own nonce and hmac if signed) is also sent when call is slower than
+ * its p95 latency, see hedge.h. Same as api_call/api_call_sec otherwise.
+ */
+json_t *api_call_hedged(struct bittrex_info *bi, char *call, char *hmac,
+			char *hedge, char *hedgehmac, char *rootcall);
+
+/*
+ * Nonce for api with key calls: epoch microseconds, strictly increasing
+ * across threads. Written in buf (NONCE_SIZE bytes at least), returns buf.
+ */
+#define NONCE_SIZE	21
+char *getnonce(char *buf);
+
+/*
+ * Keep the last nonce in shared memory, so that processes forked
+ * afterwards (daemon children) never send the same nonce.
+ */
+int nonce_share(void);
 
 /*
  * free everything in bittrex_info
@@ -34,18 +34,31 @@
 #include "market.h"
 #include "bittrex.h"
 #include "account.h"
+#include "fixed.h"
 #include "trade.h"
+#include "screener.h"
+#include "strategy.h"
+#include "tracker.h"
+#include "wallet.h"
 
 // for now BTC, add ETH & USDT
-double quantity(struct bittrex_bot *bbot) {
+fixed_t quantity(struct bittrex_bot *bbot) {
 	struct balance *b;
 	struct currency *c;
+	fixed_t available;
 
-	c = getcurrency(bbot->bi->currencies, "BTC");
+	/* cached, minus what other bot threads reserved */
+	if (bbot->wallet)
+		return wallet_available(bbot->wallet, WALLET_BASE);
+
+	c = getcurrency(bbot->bi->currencies, WALLET_BASE);
 	if (c) {
 		b = getbalance(bbot->bi, c, bbot->bi->api);
-		if (b)
-			return b->available;
+		if (b) {
+			available = b->available;
+			free_balance(b);
+			return available;
+		}
 	}
 	return 0;
 }
@@ -57,7 +70,7 @@ int rankofmarket(struct bittrex_info *bi, struct market *m) {
 	getmarketsummaries(bi);
 	for (i=0; i < bi->nbmarkets; i++) {
 		if (strncmp("BTC-", bi->markets[i]->marketname, 4) == 0) {
-			if (strcmp(m->marketname, bi->markets[i]->marketname) == 0)
+			if (m->market_id == bi->markets[i]->market_id)
 				return j;
 			j++;
 		}
@@ -80,27 +93,52 @@ void *inputstop(void *a) {
 	return NULL;
 }
 
+/*
+ * Write a snapshot every SNAPSHOT_INTERVAL until bot terminates
+ */
+void *snapshotwriter(void *a) {
+	struct bittrex_bot **bbot = (struct bittrex_bot **)a;
+	struct bittrex_info *bi = bbot[0]->bi;
+	time_t last = time(NULL);
+	int terminate = 0;
+
+	while (!terminate) {
+		sleep(1);
+		pthread_mutex_lock(&(bi->bi_lock));
+		terminate = bi->terminate;
+		pthread_mutex_unlock(&(bi->bi_lock));
+		if (!terminate && difftime(time(NULL), last) >= SNAPSHOT_INTERVAL) {
+			snapshot_write(bi, bbot, 0);
+			last = time(NULL);
+		}
+	}
+	return NULL;
+}
+
 int bot(struct bittrex_info *bi) {
 	struct bittrex_bot **bbot;
 	struct market **worthm;
+	struct screened_market **screened;
+	struct screener_filter filter;
+	struct order_tracker tracker;
+	struct wallet wallet;
 	pthread_t ind[MAX_ACTIVE_MARKETS];
-	pthread_t stop[1];
+	pthread_t stop[1], snap;
 	int i, nbm = 0;
 
 	worthm = malloc((MAX_ACTIVE_MARKETS+1) * sizeof(struct market*));
 	printf("Selecting %d markets, top volume / 24h . BTC only\n",
 	       MAX_ACTIVE_MARKETS);
-	for (i=0; i < bi->nbmarkets && nbm < MAX_ACTIVE_MARKETS; i++) {
-		if (strncmp("BTC-", bi->markets[i]->marketname, 4) == 0) {
-			if (!pumped(bi, bi->markets[i])) {
-				worthm[nbm] = bi->markets[i];
-				worthm[nbm]->bot_rank = nbm;
-				nbm++;
-			} else {
-				printf("Market: %s pumped recently, ignoring\n", bi->markets[i]->marketname);
-			}
-		}
+
+	/* candles of candidate markets are fetched and screened in parallel */
+	screener_defaults(&filter);
+	screened = screener(bi, &filter, MAX_ACTIVE_MARKETS);
+	for (i=0; screened && screened[i]; i++) {
+		worthm[nbm] = screened[i]->m;
+		worthm[nbm]->bot_rank = nbm;
+		nbm++;
 	}
+	free_screened(screened);
 	worthm[nbm] = NULL;
 	if (worthm[0] == NULL) {
 		worthm[1] = NULL;
@@ -111,30 +149,49 @@ int bot(struct bittrex_info *bi) {
 
 	printf("Selected Markets: ");
 	for (i=0; i < MAX_ACTIVE_MARKETS && worthm[i]; i++) {
-		bbot[i] = malloc(sizeof(struct bittrex_bot));
+		bbot[i] = calloc(1, sizeof(struct bittrex_bot));
 		bbot[i]->bi = bi;
 		bbot[i]->market = worthm[i];
 		bbot[i]->active_markets = nbm;
+		bbot[i]->tracker = &tracker;
+		bbot[i]->wallet = &wallet;
 		printf("%s ", worthm[i]->marketname);
 	}
 	printf("\n");
 
 	/* last bbot is not for trading, used only to terminate */
-	bbot[i] = malloc(sizeof(struct bittrex_bot));
+	bbot[i] = calloc(1, sizeof(struct bittrex_bot));
 	bbot[i]->bi = bi;
 	bbot[i]->active_markets = nbm;
-
-	printf("BTC available for bot: %.8f\n", quantity(bbot[0]));
+	bbot[i]->tracker = &tracker;
+	bbot[i]->wallet = &wallet;
+
+	/* balances fetched once, then accounted locally */
+	wallet_start(bi, &wallet);
+	printf("BTC available for bot: %.8f\n", fixed_to_double(quantity(bbot[0])));
+	/* one status check for all bot orders */
+	tracker_start(bi, &tracker);
 	for (i=0; i < nbm; i++) {
 		pthread_create(&(ind[i]), NULL, runbot, bbot[i]);
 	}
 	pthread_create(&(stop[0]), NULL, inputstop, bbot[i]);
+	if (bi->snapshotpath)
+		pthread_create(&snap, NULL, snapshotwriter, bbot);
 	pthread_join(stop[0], NULL);
 
 	printf("Threads are stopping within next 60s...\n");
 	for (i=0; i < nbm; i++) {
 		pthread_join(ind[i], 0);
 	}
+	tracker_stop(&tracker);
+	wallet_stop(&wallet);
+	if (bi->snapshotpath) {
+		pthread_join(snap, NULL);
+		/* all threads stopped, next start can trust this one */
+		snapshot_write(bi, bbot, 1);
+	}
+	if (bi->hedge.enabled)
+		printhedgestats(bi);
 	printf("Terminated\n");
 	return 0;
 }
@@ -150,16 +207,16 @@ int bot(struct bittrex_info *bi) {
  *
  */
 static int insert_order(MYSQL *connector, char *UUID, char *type, char *mname,
-			double qty, double rate, double btcorgain) {
+			fixed_t qty, fixed_t rate, fixed_t btcorgain) {
 	char *query = NULL;
-	char qtystr[32], ratestr[32], btcstr[32];
+	char qtystr[FIXED_STRLEN], ratestr[FIXED_STRLEN], btcstr[FIXED_STRLEN];
 	int query_status;
 	char *ib = "INSERT INTO Orders (UUID,Market,Quantity,Rate,BotType,BotState,Btc)";
 	char *is = "INSERT INTO Orders (UUID,Market,Quantity,Rate,BotType,BotState,Gain)";
 
-	sprintf(qtystr, "%.8f", qty);
-	sprintf(ratestr, "%.8f", rate);
-	sprintf(btcstr, "%.8f", btcorgain);
+	fixed_fmt(qty, qtystr);
+	fixed_fmt(rate, ratestr);
+	fixed_fmt(btcorgain, btcstr);
 
 
 	if (!(query = malloc(1024)))
@@ -192,12 +249,12 @@ static int insert_order(MYSQL *connector, char *UUID, char *type, char *mname,
 	return query_status;
 }
 
-static int processed_sell_order(MYSQL *connector, char *UUID, double btc) {
+static int processed_sell_order(MYSQL *connector, char *UUID, fixed_t btc) {
 	char *query = NULL;
-	char btcstr[18];
+	char btcstr[FIXED_STRLEN];
 	int query_status;
 
-	sprintf(btcstr, "%.8f", btc);
+	fixed_fmt(btc, btcstr);
 
 	if (!(query = malloc(1024)))
 		return -ENOMEM;
@@ -271,7 +328,7 @@ static struct trade *unprocessed_order(MYSQL *connector, struct market *m,
 				       char *type) {
 	char *query, *buffer, *uuid;
 	int query_status;
-	double qty, rate, btcpaid;
+	fixed_t qty = 0, rate = 0, btcpaid = 0;
 	MYSQL_RES *result;
 	unsigned long *len;
 	struct trade *t = NULL;
@@ -309,15 +366,15 @@ static struct trade *unprocessed_order(MYSQL *connector, struct market *m,
 
 		buffer[0] = '\0';
 		strncat(buffer, row[3], len[3] + 1);
-		sscanf(buffer, "%lf", &qty);
+		fixed_parse(buffer, &qty);
 
 		buffer[0] = '\0';
 		strncat(buffer, row[4], len[4] + 1);
-		sscanf(buffer, "%lf", &rate);
+		fixed_parse(buffer, &rate);
 
 		buffer[0] = '\0';
 		strncat(buffer, row[7], len[7] + 1);
-		sscanf(buffer, "%lf", &btcpaid);
+		fixed_parse(buffer, &btcpaid);
 
 		if (strcmp(type, "buy") == 0)
 			t = new_trade(m, LIMIT, qty, rate, IMMEDIATE_OR_CANCEL,
@@ -328,7 +385,7 @@ static struct trade *unprocessed_order(MYSQL *connector, struct market *m,
 
 		t->realqty = qty;
 		t->btcpaid = btcpaid;
-		t->fee = ((0.25/100) * t->realqty * rate)/(1-(0.25/100*rate));
+		t->fee = fixed_muldiv(fixed_mul(t->realqty, rate), FIXED_FEE_BPS, 10000);
 		free(buffer);
 	}
 	if (result)
@@ -339,35 +396,97 @@ static struct trade *unprocessed_order(MYSQL *connector, struct market *m,
 
 
 /*
- * Hardcoded RSI 14 strategy for specified market
- * One thread / market
- *
- * Buy when Wilder RSI14,minute < 30 and RSI 14,hour < 60
- * Sell when Wilder RSI is greater than 70 and margin > 0.25% (fees)
- * or sell whatever RSI is and if gain >= 1%
- *
+ * Pending orders of the bot thread are taken from the last snapshot
+ * if it was written after a clean stop, from the database otherwise.
  */
-void *runbot(void *b) {
-	struct bittrex_bot *bbot = (struct bittrex_bot *)b;
+static struct trade *resume_order(struct bittrex_bot *bbot, struct market *m, int type) {
+	struct trade *t;
+
+	if (bbot->bi->snapshot && bbot->bi->snapshot->clean)
+		return snapshot_trade_get(bbot->bi, m, type);
+
+	pthread_mutex_lock(&(bbot->bi->bi_lock));
+	t = unprocessed_order(bbot->bi->connector, m, type == BUY ? "buy" : "sell");
+	pthread_mutex_unlock(&(bbot->bi->bi_lock));
+	return t;
+}
+
+/*
+ * Copy pending orders of the bot thread for the snapshot writer
+ */
+static void publish_state(struct bittrex_bot *bbot, struct trade *buy, char *buyuuid,
+			  struct trade *sell, char *selluuid) {
+	pthread_mutex_lock(&(bbot->bi->bi_lock));
+	if (buy)
+		snapshot_trade_set(&(bbot->state[0]), bbot->market, BUY, buyuuid,
+				   buy->realqty, buy->rate, buy->btcpaid,
+				   buy->completed);
+	else
+		snapshot_trade_set(&(bbot->state[0]), bbot->market, BUY, NULL, 0, 0, 0, 0);
+	if (sell)
+		snapshot_trade_set(&(bbot->state[1]), bbot->market, SELL, selluuid,
+				   sell->quantity, sell->rate, sell->btcpaid,
+				   sell->completed);
+	else
+		snapshot_trade_set(&(bbot->state[1]), bbot->market, SELL, NULL, 0, 0, 0, 0);
+	pthread_mutex_unlock(&(bbot->bi->bi_lock));
+}
+
+/*
+ * Position of the strategy from the bot orders
+ */
+static void live_position(struct strategy_position *pos, struct trade *buy,
+			  struct trade *sell, time_t buytime) {
+	memset(pos, 0, sizeof(struct strategy_position));
+	if (sell) {
+		pos->state = POSITION_SELLING;
+	} else if (buy && buy->completed) {
+		pos->state = POSITION_HOLDING;
+		pos->realqty = buy->realqty;
+		pos->btcpaid = buy->btcpaid;
+	} else if (buy) {
+		pos->state = POSITION_BUYING;
+		pos->since = buytime;
+	}
+}
+
+static void feed_update(struct strategy_feed *feed, struct market *m,
+			struct tick **minute, int nbminute,
+			struct tick **hour, int nbhour, struct ticker *t) {
+	feed->m = m;
+	feed->minute = minute;
+	feed->nbminute = minute ? nbminute : 0;
+	feed->hour = hour;
+	feed->nbhour = hour ? nbhour : 0;
+	feed->last = t ? fixed_from_double(t->last) : 0;
+	feed->now = time(NULL);
+}
+
+/*
+ * Trading loop of one market, decisions are taken by the strategies of set
+ */
+static void *trade_market(struct bittrex_bot *bbot, struct strategy_set *set) {
 	struct market *m = bbot->market;
 	struct trade *buy=NULL, *sell=NULL;
-	struct user_order *order = NULL, *sellorder = NULL;
+	struct user_order *order = NULL;
 	struct tick **hour_ticks = NULL, **minute_ticks = NULL;
 	struct ticker *last = NULL, *tmptick = NULL;
+	struct tracked_order to;
+	struct wallet_reservation res;
+	struct strategy_feed feed;
+	struct strategy_position pos;
 	char *buyuuid = NULL, *selluuid = NULL;
-	time_t begining, buytime;
-	double btcqty = 0, qty = 0;
-	int nbhourt = 0;
-	double previousloss = 0;
+	time_t begining, buytime = 0;
+	fixed_t btcqty = 0, qty = 0, rate;
+	int nbhourt = 0, signal, state;
 	int market_rank = m->bot_rank;
 
 	/*
 	 * bot resuming
 	 */
-	pthread_mutex_lock(&(bbot->bi->bi_lock));
-	buy = unprocessed_order(bbot->bi->connector, m, "buy");
-	sell = unprocessed_order(bbot->bi->connector, m, "sell");
-	pthread_mutex_unlock(&(bbot->bi->bi_lock));
+	buy = resume_order(bbot, m, BUY);
+	sell = resume_order(bbot, m, SELL);
+	publish_state(bbot, buy, buy ? buy->uuid : NULL, sell, sell ? sell->uuid : NULL);
 	if (buy && sell) {
 		fprintf(stderr,
 				"Found buy and sell unprocessed for same market. Database corruption ?.");
@@ -375,14 +494,15 @@ void *runbot(void *b) {
 	}
 	if (buy) {
 		if ((order = getorder(bbot->bi, buy->uuid))) {
-			buyuuid = malloc(strlen(buy->uuid));
+			buyuuid = malloc(strlen(buy->uuid) + 1);
 			buyuuid = strcpy(buyuuid, buy->uuid);
 			if (order->isopen) {
 				buy->completed = 0;
-			} else {
-				free_user_order(order);
-				order = NULL;
+				tracker_add(bbot->tracker, buyuuid);
 			}
+			wallet_hold(bbot->wallet, &res, buy->completed ? 0 : buy->btcpaid);
+			free_user_order(order);
+			order = NULL;
 			printf("Found buy order to be resumed:");
 			printf("market: %s, uuid: %s\n", m->marketname, buyuuid);
 
@@ -392,17 +512,18 @@ void *runbot(void *b) {
 		}
 	}
 	if (sell) {
-		if ((sellorder = getorder(bbot->bi, sell->uuid))) {
-			selluuid = malloc(strlen(sell->uuid));
+		if ((order = getorder(bbot->bi, sell->uuid))) {
+			selluuid = malloc(strlen(sell->uuid) + 1);
 			selluuid = strcpy(selluuid, sell->uuid);
-			if (sellorder->isopen) {
+			if (order->isopen) {
 				sell->completed = 0;
-			} else {
-				free_user_order(order);
-				order = NULL;
+				tracker_add(bbot->tracker, selluuid);
 			}
+			wallet_hold(bbot->wallet, &res, 0);
+			free_user_order(order);
+			order = NULL;
 			printf("Found sell order to be resumed:");
-			printf("market: %s, uuid: %s\n", m->marketname, buyuuid);
+			printf("market: %s, uuid: %s\n", m->marketname, selluuid);
 		} else {
 			fprintf(stderr, "first getorder failed, can't resume");
 			return NULL;
@@ -422,23 +543,29 @@ void *runbot(void *b) {
 	    pthread_mutex_lock(&(bbot->bi->bi_lock));
 	    if (bbot->bi->terminate) {
 		if (buy && buy->completed && buyuuid) {
-		    selluuid =  selllimit(bbot->bi, m, buy->realqty,
-					  (buy->btcpaid / buy->realqty)*(1+1/100));
+		    /* break even rate, no gain expected */
+		    rate = fixed_div(buy->btcpaid, buy->realqty);
+		    selluuid =  selllimit(bbot->bi, m, buy->realqty, rate);
 		    insert_order(bbot->bi->connector, selluuid,
 				 "sell", m->marketname,
-				 buy->realqty, buy->btcpaid / buy->realqty,
-				 (buy->btcpaid / buy->realqty)*(1/100));
+				 buy->realqty, rate, 0);
+		    if (selluuid && !sell) {
+			sell = new_trade(m, LIMIT, buy->realqty, rate,
+					 IMMEDIATE_OR_CANCEL, NONE, 0, SELL, selluuid);
+			free_trade(buy);
+			buy = NULL;
+		    }
 		}
 		pthread_mutex_unlock(&(bbot->bi->bi_lock));
+		publish_state(bbot, buy, buyuuid, sell, selluuid);
 		return NULL;
 	    }
 	    pthread_mutex_unlock(&(bbot->bi->bi_lock));
 
 	    /*
 	     * This loop polls ~5/s api for tick
-	     * We sell in these condition:
-	     * - RSI > 70 and gain > 0
-	     * - RSI not > 70 but gain > 1%
+	     * We sell when the strategy says so (rsi: RSI > 70 and gain > 0,
+	     * or gain > 1%)
 	     */
 	    if (minute_ticks)
 		free_ticks(minute_ticks);
@@ -452,15 +579,19 @@ void *runbot(void *b) {
 		    tmptick = NULL;
 		}
 		tmptick = getticker(bbot->bi, m);
-		if (tmptick && buy && buy->completed) {
-		    double sellminusfee = (tmptick->last * buy->realqty)*(1 - 0.25/100);
-		    double estimatedgain = sellminusfee - buy->btcpaid;
-		    if ((estimatedgain > 0 && minute_ticks[m->lastnbticks-1]->rsi_ema >= 70) ||
-			(estimatedgain >= buy->btcpaid / 100)) {
+		if (tmptick) {
+		    fixed_t estimatedgain;
+
+		    feed_update(&feed, m, minute_ticks, m->lastnbticks,
+				hour_ticks, nbhourt, tmptick);
+		    live_position(&pos, buy, sell, buytime);
+		    rate = feed.last;
+		    estimatedgain = strategy_gain(&pos, rate);
+		    if (strategy_ticker(set, &feed, &pos) == SIGNAL_SELL && buy && buy->completed) {
 			if (!sell) {
-			    sell = new_trade(m, LIMIT, 1, tmptick->last, IMMEDIATE_OR_CANCEL,
+			    sell = new_trade(m, LIMIT, FIXED_ONE, rate, IMMEDIATE_OR_CANCEL,
 					     NONE, 0, SELL, NULL);
-			    if (!(selluuid = selllimit(bbot->bi, m, buy->realqty, tmptick->last))) {
+			    if (!(selluuid = selllimit(bbot->bi, m, buy->realqty, rate))) {
 				printf("sellorder failed, uuid null\n");
 				free_trade(sell);
 				sell = NULL;
@@ -468,32 +599,19 @@ void *runbot(void *b) {
 				printf("SELL %s at %.8f, quantity: %.8f, Gain (if sold): %.8f\n",
 				       m->marketname,
 				       tmptick->last,
-				       buy->realqty,
-				       estimatedgain);
-				while (!sellorder) {
-				    fprintf(stderr,
-					    "getorder: '%s' failed, retrying.\n",
-					    selluuid);
-				    sellorder = getorder(bbot->bi, selluuid);
-				}
+				       fixed_to_double(buy->realqty),
+				       fixed_to_double(estimatedgain));
+				tracker_add(bbot->tracker, selluuid);
 				pthread_mutex_lock(&(bbot->bi->bi_lock));
 				insert_order(bbot->bi->connector, selluuid,
 					     "sell", m->marketname,
-					     buy->realqty, tmptick->last,
+					     buy->realqty, rate,
 					     estimatedgain);
 				processed_buy_order(bbot->bi->connector, buyuuid);
 				pthread_mutex_unlock(&(bbot->bi->bi_lock));
 				free_trade(buy); buy = NULL;
 			    }
 			}
-		    } else {
-			if (previousloss != estimatedgain &&
-			    minute_ticks[m->lastnbticks-1]->rsi_ema >= 70) {
-			    printf("Warning, RSI(tmp) of %s over 70 but no opportunity found (loss: %.8f)\n",
-				   m->marketname,
-				   estimatedgain);
-			    previousloss = estimatedgain;
-			}
 		    }
 		}
 		free_ticks(minute_ticks);
@@ -524,8 +642,9 @@ void *runbot(void *b) {
 	    m->rsi = minute_ticks[m->lastnbticks-1]->rsi_ema;
 	    pthread_mutex_unlock(&(m->indicators_lock));
 
-	    while (!tmptick)
-		tmptick = getticker(bbot->bi, m);
+	    /* breaker open or API down: do not spin on the endpoint */
+	    while (!(tmptick = getticker(bbot->bi, m)))
+		retry_pause(bbot->bi, GETTICKER);
 
 	    fprintf(stderr,
 		    "Market: %s\tRSI(14,mn): %.8f\tRSI(14,h): %.8f\tlast: %.8f\n",
@@ -534,40 +653,36 @@ void *runbot(void *b) {
 		    hour_ticks[nbhourt-1]->rsi_ema,
 		    tmptick->last);
 
+	    feed_update(&feed, m, minute_ticks, m->lastnbticks,
+			hour_ticks, nbhourt, tmptick);
 	    free(tmptick);
 	    tmptick = NULL;
 
-	    /* refresh buy order state */
+	    /* buy order state, from the tracker */
 	    if (buy && !buy->completed) {
-		free_user_order(order);
-		order = getorder(bbot->bi, buyuuid);
-		if (order) {
-		    if (!order->isopen) {
-			buy->fee = order->commission;
-			buy->realqty = order->quantity;
-			free_user_order(order);
-			buy->completed = 1;
-		    } else if (difftime(time(NULL), buytime) >= 60) {
-			/*
-			 * one minute occured buy order not filled
-			 * we let it if RSI is falling otherwise we cancel it
-			 */
-
-			if (minute_ticks[m->lastnbticks-1]->rsi_ema > 35 &&
-			    minute_ticks[m->lastnbticks-1]->rsi_ema > (minute_ticks[m->lastnbticks-2]->rsi_ema + 5)) {
-			    printf("Order not filled after %.2f seconds, RSI raising, canceling.\n",
-				   difftime(time(NULL), buytime));
-			    cancel(bbot->bi, buyuuid);
-			    pthread_mutex_lock(&(bbot->bi->bi_lock));
-			    cancel_order(bbot->bi->connector, buyuuid);
-			    pthread_mutex_unlock(&(bbot->bi->bi_lock));
-			    free_user_order(order);
-			    free(buyuuid);
-			    buyuuid = NULL;
-			    free_trade(buy);
-			    buy = NULL;
-			}
-		    }
+		switch (tracker_wait(bbot->tracker, buyuuid, 0, &to)) {
+		case ORDER_FILLED:
+		    buy->fee = to.commission;
+		    buy->realqty = to.quantity;
+		    buy->completed = 1;
+		    wallet_filled(bbot->wallet, &res, to.price + to.commission);
+		    live_position(&pos, buy, sell, buytime);
+		    strategy_fill(set, SIGNAL_BUY, &pos);
+		    break;
+		case ORDER_CANCELLED:
+		    printf("Buy order %s cancelled, nothing filled.\n", buyuuid);
+		    pthread_mutex_lock(&(bbot->bi->bi_lock));
+		    cancel_order(bbot->bi->connector, buyuuid);
+		    bbot->bi->trades_active--;
+		    pthread_mutex_unlock(&(bbot->bi->bi_lock));
+		    wallet_release(bbot->wallet, &res);
+		    live_position(&pos, buy, sell, buytime);
+		    strategy_fill(set, SIGNAL_CANCEL, &pos);
+		    free(buyuuid);
+		    buyuuid = NULL;
+		    free_trade(buy);
+		    buy = NULL;
+		    break;
 		}
 	    }
 
@@ -577,134 +692,164 @@ void *runbot(void *b) {
 	     * Check if the state of the market changed (in volume)
 	     * in case of change, exit and open a new thread on another market.
 	     */
-	    if (sell && !sell->completed) {
-		free_user_order(sellorder);
-		sellorder = getorder(bbot->bi, selluuid);
-		if (sellorder && !sellorder->isopen) {
-		    pthread_mutex_lock(&(bbot->bi->bi_lock));
-		    bbot->bi->trades_active--;
-		    pthread_mutex_unlock(&(bbot->bi->bi_lock));
-		    processed_sell_order(bbot->bi->connector, selluuid, sellorder->price);
-		    free_user_order(sellorder);
-		    sellorder = NULL;
-		    free_trade(sell);
-		    sell = NULL;
-		    free(selluuid);
-		    selluuid = NULL;
-		    if (buyuuid)
-			free(buyuuid);
-		    buyuuid = NULL;
-		    if (rankofmarket(bbot->bi, m) < market_rank) {
-			printf("Market(%s) lost rank, exiting\n", m->marketname);
-			return NULL;
-		    } else {
-			printf("Market(%s) rank increased! Good, continuing.\n",
-			       m->marketname);
-		    }
+	    if (sell && !sell->completed &&
+		tracker_wait(bbot->tracker, selluuid, 0, &to) != ORDER_OPEN) {
+		pthread_mutex_lock(&(bbot->bi->bi_lock));
+		bbot->bi->trades_active--;
+		pthread_mutex_unlock(&(bbot->bi->bi_lock));
+		processed_sell_order(bbot->bi->connector, selluuid, to.price);
+		wallet_sold(bbot->wallet);
+		live_position(&pos, buy, sell, buytime);
+		strategy_fill(set, SIGNAL_SELL, &pos);
+		free_trade(sell);
+		sell = NULL;
+		free(selluuid);
+		selluuid = NULL;
+		if (buyuuid)
+		    free(buyuuid);
+		buyuuid = NULL;
+		if (rankofmarket(bbot->bi, m) < market_rank) {
+		    printf("Market(%s) lost rank, exiting\n", m->marketname);
+		    publish_state(bbot, buy, buyuuid, sell, selluuid);
+		    return NULL;
+		} else {
+		    printf("Market(%s) rank increased! Good, continuing.\n",
+		           m->marketname);
 		}
 	    }
 
 	    /*
-	     * If rsi < 30 and we did not buy yet, we buy
-	     *
-	     * rsi != 0 in case of init failure (need to confirm it is fixed)
-	     * but should be removed
+	     * One candle per minute for the strategies:
+	     * cancel a buy order not filled or buy if we have no order.
 	     */
-	    if (m->rsi < 30 && m->rsi != 0 && !buy && !sell &&
-		hour_ticks[nbhourt-1]->rsi_ema <= 60) {
+	    live_position(&pos, buy, sell, buytime);
+	    signal = strategy_candle(set, &feed, &pos);
+
+	    if (signal == SIGNAL_CANCEL && buy && !buy->completed) {
+		printf("Order not filled after %.2f seconds, canceling.\n",
+		       difftime(time(NULL), buytime));
+		cancel(bbot->bi, buyuuid);
+		tracker_forget(bbot->tracker, buyuuid);
+		pthread_mutex_lock(&(bbot->bi->bi_lock));
+		cancel_order(bbot->bi->connector, buyuuid);
+		bbot->bi->trades_active--;
+		pthread_mutex_unlock(&(bbot->bi->bi_lock));
+		wallet_release(bbot->wallet, &res);
+		strategy_fill(set, SIGNAL_CANCEL, &pos);
+		free(buyuuid);
+		buyuuid = NULL;
+		free_trade(buy);
+		buy = NULL;
+	    }
+
+	    if (signal == SIGNAL_BUY && !buy && !sell) {
 		last = getticker(bbot->bi, m);
-		if (last) {
-		    /* btc available divided by the number of active bot markets */
-		    btcqty = quantity(bbot) / (bbot->active_markets - bbot->bi->trades_active);
+		/* btc available divided by the free bot slots, reserved at once */
+		if (last && wallet_reserve(bbot->wallet, bbot->active_markets, &res) > 0) {
 		    /* we use 99% of qty available */
-		    btcqty *= 0.99;
+		    btcqty = fixed_muldiv(res.amount, 99, 100);
 		    /* qty of coin to be baught */
-		    qty = btcqty / last->last;
+		    rate = fixed_from_double(last->last);
+		    qty = fixed_div(btcqty, rate);
 		    /* order information */
 		    printf("BUY %s at %.8f, quantity: %.8f (BTC: %.8f), fees: %.8f\n",
 			   m->marketname,
 			   last->last,
-			   qty, btcqty,
-			   (0.25/100) * qty * last->last);
+			   fixed_to_double(qty), fixed_to_double(btcqty),
+			   fixed_to_double(fixed_muldiv(fixed_mul(qty, rate),
+							FIXED_FEE_BPS, 10000)));
 		    /*
 		     * This instanciate a trade struct but it does not buy for real (API V2 not implemented)
 		     * but we can use trade struct fields
 		     */
-		    buy = new_trade(m, LIMIT, qty, last->last, IMMEDIATE_OR_CANCEL,
+		    buy = new_trade(m, LIMIT, qty, rate, IMMEDIATE_OR_CANCEL,
 				    NONE, 0, BUY, NULL);
-		    buy->btcpaid = btcqty * 1.0025;
+		    buy->btcpaid = fixed_muldiv(btcqty, 10000 + FIXED_FEE_BPS, 10000);
 		    buy->realqty = qty;
-		    if (!(buyuuid = buylimit(bbot->bi, m, qty, last->last))) {
+		    if (!(buyuuid = buylimit(bbot->bi, m, qty, rate))) {
 			printf("buyorder failed, uuid null\n");
+			wallet_release(bbot->wallet, &res);
 			free_trade(buy);
 			buy = NULL;
 		    } else {
 			buytime = time(NULL);
+			wallet_placed(bbot->wallet, &res, buy->btcpaid);
 			pthread_mutex_lock(&(bbot->bi->bi_lock));
 			bbot->bi->trades_active++;
 			pthread_mutex_unlock(&(bbot->bi->bi_lock));
-			/* we let some time to bittrex */
-			sleep(3);
-			order = getorder(bbot->bi, buyuuid);
+			/* we let some time to bittrex, the order may fill at once */
+			tracker_add(bbot->tracker, buyuuid);
+			state = tracker_wait(bbot->tracker, buyuuid, TRACKER_INTERVAL, &to);
 			pthread_mutex_lock(&(bbot->bi->bi_lock));
 			insert_order(bbot->bi->connector, buyuuid, "buy",
-				     m->marketname, buy->realqty, last->last,
+				     m->marketname, buy->realqty, rate,
 				     buy->btcpaid);
 			pthread_mutex_unlock(&(bbot->bi->bi_lock));
-			/* order already complete */
-			if (order && !order->isopen) {
-			    buy->fee = order->commission;
-			    buy->realqty = order->quantity;
-			    free_user_order(order);
+			/* order already complete (cancelled ones are seen next minute) */
+			if (state == ORDER_FILLED) {
+			    buy->fee = to.commission;
+			    buy->realqty = to.quantity;
 			    buy->completed = 1;
+			    wallet_filled(bbot->wallet, &res, to.price + to.commission);
+			    live_position(&pos, buy, sell, buytime);
+			    strategy_fill(set, SIGNAL_BUY, &pos);
 			}
 		    }
-		    free(last);
-		    last = NULL;
 		}
+		free(last);
+		last = NULL;
 	    }
 	    /*
 	     * This sell is unlikely (we sell mostly in first loop when RSI is refreshed ~1/s)
 	     */
 	    if (buy && buy->completed) {
 		if ((last = getticker(bbot->bi, m))) {
-		    double sellminusfee = (last->last * buy->realqty) * ( 1 - 0.25/100);
-		    double estimatedgain = sellminusfee - buy->btcpaid;
-		    if ((estimatedgain > 0 && m->rsi >= 70) ||
-			(estimatedgain >= buy->btcpaid / 100)) {
-			if (!sell) {
-			    sell = new_trade(m, LIMIT, 1, last->last,
-					     IMMEDIATE_OR_CANCEL, NONE,
-					     0, SELL, NULL);
-			    if (!(selluuid = selllimit(bbot->bi, m, buy->realqty, last->last))) {
-				printf("sellorder failed, uuid null\n");
-				free_trade(sell);
-				sell = NULL;
-			    } else {
-				printf("SELL %s at %.8f, quantity: %.8f, Gain (if sold): %.8f\n",
-				       m->marketname,
-				       last->last,
-				       buy->realqty,
-				       estimatedgain);
-				while (!sellorder) {
-				    fprintf(stderr, "getorder: '%s' failed, retrying.\n",
-					    selluuid);
-				    sellorder = getorder(bbot->bi, selluuid);
-				}
-				pthread_mutex_lock(&(bbot->bi->bi_lock));
-				processed_buy_order(bbot->bi->connector, buyuuid);
-				pthread_mutex_unlock(&(bbot->bi->bi_lock));
-				free_trade(buy); buy = NULL;
-			    }
+		    fixed_t estimatedgain;
+
+		    feed_update(&feed, m, minute_ticks, m->lastnbticks,
+				hour_ticks, nbhourt, last);
+		    live_position(&pos, buy, sell, buytime);
+		    rate = feed.last;
+		    estimatedgain = strategy_gain(&pos, rate);
+		    if (strategy_ticker(set, &feed, &pos) == SIGNAL_SELL && !sell) {
+			sell = new_trade(m, LIMIT, FIXED_ONE, rate,
+					 IMMEDIATE_OR_CANCEL, NONE,
+					 0, SELL, NULL);
+			if (!(selluuid = selllimit(bbot->bi, m, buy->realqty, rate))) {
+			    printf("sellorder failed, uuid null\n");
+			    free_trade(sell);
+			    sell = NULL;
+			} else {
+			    printf("SELL %s at %.8f, quantity: %.8f, Gain (if sold): %.8f\n",
+				   m->marketname,
+				   last->last,
+				   fixed_to_double(buy->realqty),
+				   fixed_to_double(estimatedgain));
+			    tracker_add(bbot->tracker, selluuid);
+			    pthread_mutex_lock(&(bbot->bi->bi_lock));
+			    processed_buy_order(bbot->bi->connector, buyuuid);
+			    pthread_mutex_unlock(&(bbot->bi->bi_lock));
+			    free_trade(buy); buy = NULL;
 			}
-		    } else if (m->rsi >= 70) {
-			printf("Warning, RSI of %s over 70 but no opportunity found (loss: %.8f)\n",
-			       m->marketname,
-			       estimatedgain);
 		    }
+		    free(last);
+		    last = NULL;
 		}
 	    }
+	    publish_state(bbot, buy, buyuuid, sell, selluuid);
 	}
 	return NULL;
 }
 
+
+void *runbot(void *b) {
+	struct bittrex_bot *bbot = (struct bittrex_bot *)b;
+	struct strategy_set set;
+
+	if (strategy_set_init(&set, bbot->bi->strategies) < 0)
+		return NULL;
+	trade_market(bbot, &set);
+	strategy_report(&set, bbot->market->marketname);
+	strategy_set_free(&set);
+	return NULL;
+}
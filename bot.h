@@ -26,16 +26,26 @@
 #define BOT_H
 
 #include "bittrex.h"
+#include "fixed.h"
 #include "market.h"
+#include "snapshot.h"
+#include "tracker.h"
+#include "wallet.h"
 
 struct bittrex_bot {
 	struct bittrex_info *bi;
 	struct market *market;
 	int active_markets;
+	/* pending buy and sell orders, copied in snapshots (under bi_lock) */
+	struct snapshot_trade state[2];
+	/* status of the bot orders, shared by all bot threads */
+	struct order_tracker *tracker;
+	/* cached balances and buy reservations, shared too */
+	struct wallet *wallet;
 };
 
 int bot(struct bittrex_info *bi);
-double quantity(struct bittrex_bot *bbot);
+fixed_t quantity(struct bittrex_bot *bbot);
 void *runbot(void *b);
 
 #endif
@@ -0,0 +1,289 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "bittrex.h"
+
+/*
+ * Markets and currencies hardly change, summaries are refreshed often.
+ * Tickers, candles, order books and history are never cached.
+ */
+static const struct {
+	const char *rootcall;
+	int ttl;
+} cache_ttls[] = {
+	{GETMARKETS,		3600},
+	{GETCURRENCIES,		3600},
+	{GETMARKETSUMMARIES,	30},
+	{GETMARKETSUMMARY,	30},
+	{NULL,			0}
+};
+
+void cache_init(struct response_cache *rc) {
+	rc->nbentries = 0;
+	rc->dir = NULL;
+}
+
+static int mkdir_p(char *path) {
+	char *p;
+
+	for (p = path + 1; *p; p++) {
+		if (*p != '/')
+			continue;
+		*p = '\0';
+		if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+			*p = '/';
+			return -1;
+		}
+		*p = '/';
+	}
+	if (mkdir(path, 0700) != 0 && errno != EEXIST)
+		return -1;
+	return 0;
+}
+
+int cache_disk(struct response_cache *rc, const char *dir) {
+	const char *base, *sub = "/" CACHE_DIRNAME;
+	char *path;
+
+	if (!dir) {
+		if ((base = getenv("XDG_CACHE_HOME")) && *base) {
+			dir = base;
+		} else if ((base = getenv("HOME")) && *base) {
+			dir = base;
+			sub = "/.cache/" CACHE_DIRNAME;
+		} else {
+			fprintf(stderr, "cache: no HOME, disk cache disabled\n");
+			return -1;
+		}
+	} else {
+		sub = "";
+	}
+
+	path = malloc(strlen(dir) + strlen(sub) + 1);
+	strcpy(path, dir);
+	strcat(path, sub);
+	if (mkdir_p(path) != 0) {
+		fprintf(stderr, "cache: could not create %s, disk cache disabled\n", path);
+		free(path);
+		return -1;
+	}
+	free(rc->dir);
+	rc->dir = path;
+	return 0;
+}
+
+int cache_ttl(const char *rootcall) {
+	int i;
+
+	for (i = 0; cache_ttls[i].rootcall; i++) {
+		if (strcmp(cache_ttls[i].rootcall, rootcall) == 0)
+			return cache_ttls[i].ttl;
+	}
+	return 0;
+}
+
+/*
+ * File of url in the disk cache (FNV-1a of url), to be freed.
+ */
+static char *cache_path(struct response_cache *rc, const char *url) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	char *path;
+
+	while (*url) {
+		h ^= (unsigned char)*url++;
+		h *= 0x100000001b3ULL;
+	}
+	path = malloc(strlen(rc->dir) + 1 + 16 + 1);
+	sprintf(path, "%s/%016llx", rc->dir, (unsigned long long)h);
+	return path;
+}
+
+/*
+ * Files are the url on the first line, then the reply.
+ * The url guards against hash collisions, mtime gives the age.
+ */
+static char *disk_get(struct response_cache *rc, const char *url, int ttl,
+		      time_t *expires) {
+	struct stat st;
+	char *path, *data = NULL;
+	size_t len = strlen(url);
+	FILE *f;
+
+	path = cache_path(rc, url);
+	if (stat(path, &st) != 0 || st.st_mtime + ttl <= time(NULL) ||
+	    st.st_size <= (off_t)len + 1 || st.st_size >= BUFFER_SIZE ||
+	    !(f = fopen(path, "r"))) {
+		free(path);
+		return NULL;
+	}
+	free(path);
+
+	data = malloc(st.st_size + 1);
+	if (fread(data, 1, st.st_size, f) != (size_t)st.st_size ||
+	    strncmp(data, url, len) != 0 || data[len] != '\n') {
+		free(data);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	data[st.st_size] = '\0';
+	memmove(data, data + len + 1, st.st_size - len);
+	*expires = st.st_mtime + ttl;
+	return data;
+}
+
+static void disk_put(struct response_cache *rc, const char *url, const char *reply) {
+	char *path, *tmppath;
+	FILE *f;
+
+	path = cache_path(rc, url);
+	tmppath = malloc(strlen(path) + 32);
+	sprintf(tmppath, "%s.%ld.tmp", path, (long)getpid());
+	if (!(f = fopen(tmppath, "w"))) {
+		fprintf(stderr, "cache: could not open %s\n", tmppath);
+		free(tmppath);
+		free(path);
+		return;
+	}
+	fprintf(f, "%s\n", url);
+	fputs(reply, f);
+	/* readers only ever see complete files */
+	if (fclose(f) != 0 || rename(tmppath, path) != 0) {
+		fprintf(stderr, "cache: could not write %s\n", path);
+		unlink(tmppath);
+	}
+	free(tmppath);
+	free(path);
+}
+
+/*
+ * Entry for url, or the one to replace (free or soonest expired), bi_lock held
+ */
+static struct cache_entry *entry(struct response_cache *rc, const char *url, int add) {
+	struct cache_entry *e, *old = NULL;
+	int i;
+
+	for (i = 0; i < rc->nbentries; i++) {
+		e = &(rc->entries[i]);
+		if (strcmp(e->url, url) == 0)
+			return e;
+		if (!old || e->expires < old->expires)
+			old = e;
+	}
+	if (!add)
+		return NULL;
+	if (rc->nbentries < CACHE_ENTRIES) {
+		e = &(rc->entries[rc->nbentries++]);
+		e->url = NULL;
+		e->reply = NULL;
+		e->expires = 0;
+		return e;
+	}
+	return old;
+}
+
+static void entry_set(struct cache_entry *e, const char *url, char *reply,
+		      time_t expires) {
+	if (!e->url || strcmp(e->url, url) != 0) {
+		free(e->url);
+		e->url = malloc(strlen(url) + 1);
+		strcpy(e->url, url);
+	}
+	free(e->reply);
+	e->reply = reply;
+	e->expires = expires;
+}
+
+char *cache_get(struct bittrex_info *bi, const char *url, const char *rootcall) {
+	struct response_cache *rc = &(bi->cache);
+	struct cache_entry *e;
+	char *reply = NULL, *copy;
+	time_t expires;
+	int ttl;
+
+	if (!(ttl = cache_ttl(rootcall)))
+		return NULL;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = entry(rc, url, 0);
+	if (e && e->reply && e->expires > time(NULL)) {
+		reply = malloc(strlen(e->reply) + 1);
+		strcpy(reply, e->reply);
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+	if (reply || !rc->dir)
+		return reply;
+
+	/* disk hit is kept in memory for next calls */
+	if (!(reply = disk_get(rc, url, ttl, &expires)))
+		return NULL;
+	copy = malloc(strlen(reply) + 1);
+	strcpy(copy, reply);
+	pthread_mutex_lock(&(bi->bi_lock));
+	entry_set(entry(rc, url, 1), url, copy, expires);
+	pthread_mutex_unlock(&(bi->bi_lock));
+	return reply;
+}
+
+void cache_put(struct bittrex_info *bi, const char *url, const char *rootcall,
+	       const char *reply) {
+	struct response_cache *rc = &(bi->cache);
+	char *copy;
+	int ttl;
+
+	if (!(ttl = cache_ttl(rootcall)))
+		return;
+
+	copy = malloc(strlen(reply) + 1);
+	strcpy(copy, reply);
+	pthread_mutex_lock(&(bi->bi_lock));
+	entry_set(entry(rc, url, 1), url, copy, time(NULL) + ttl);
+	pthread_mutex_unlock(&(bi->bi_lock));
+
+	if (rc->dir)
+		disk_put(rc, url, reply);
+}
+
+void cache_free(struct response_cache *rc) {
+	int i;
+
+	for (i = 0; i < rc->nbentries; i++) {
+		free(rc->entries[i].url);
+		free(rc->entries[i].reply);
+	}
+	rc->nbentries = 0;
+	free(rc->dir);
+	rc->dir = NULL;
+}
@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <time.h>
+
+#define CACHE_ENTRIES	64	/* replies kept in memory */
+#define CACHE_DIRNAME	"c-bittrex"	/* under $XDG_CACHE_HOME or ~/.cache */
+
+struct bittrex_info;
+
+struct cache_entry {
+	char *url;
+	char *reply;
+	time_t expires;
+};
+
+/*
+ * Replies of public API calls by URL, in bittrex_info, protected by bi_lock.
+ * With a disk directory (--cache) replies are also kept in files,
+ * so that successive CLI runs share them.
+ */
+struct response_cache {
+	struct cache_entry entries[CACHE_ENTRIES];
+	int nbentries;
+	char *dir;
+};
+
+void cache_init(struct response_cache *rc);
+
+/*
+ * Enable the disk layer in dir, default directory if NULL.
+ * return 0 on success, -1 if the directory can not be created.
+ */
+int cache_disk(struct response_cache *rc, const char *dir);
+
+/*
+ * Seconds a reply of rootcall stays valid, 0 if not cached
+ */
+int cache_ttl(const char *rootcall);
+
+/*
+ * Copy of the cached reply to url (to be freed), NULL if none or expired
+ */
+char *cache_get(struct bittrex_info *bi, const char *url, const char *rootcall);
+
+/*
+ * Store a valid reply to url (copied)
+ */
+void cache_put(struct bittrex_info *bi, const char *url, const char *rootcall,
+	       const char *reply);
+
+void cache_free(struct response_cache *rc);
+
+#endif
@@ -0,0 +1,423 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "daemon.h"
+#include "market.h"
+
+struct daemon_child {
+	pid_t pid;
+	int client;	/* socket the exit status is sent to */
+};
+
+static volatile sig_atomic_t stop;
+/* self pipe, wakes poll() up on signals */
+static int sigpipe[2];
+
+static void on_signal(int sig) {
+	int e = errno;
+
+	if (sig != SIGCHLD)
+		stop = 1;
+	/* if the pipe is full poll() wakes up anyway */
+	(void)!write(sigpipe[1], "", 1);
+	errno = e;
+}
+
+static int daemon_signals(void) {
+	struct sigaction sa;
+
+	if (pipe(sigpipe) != 0)
+		return -1;
+	fcntl(sigpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(sigpipe[1], F_SETFL, O_NONBLOCK);
+	fcntl(sigpipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(sigpipe[1], F_SETFD, FD_CLOEXEC);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	/* clients may leave before their status is sent */
+	signal(SIGPIPE, SIG_IGN);
+	return 0;
+}
+
+static int daemon_listen(const char *path) {
+	struct sockaddr_un addr;
+	mode_t mask;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "daemon: socket path too long: %s\n", path);
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0) {
+		perror("daemon: socket");
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	unlink(path);
+	/* owner only: requests may use the API key */
+	mask = umask(077);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(fd, 64) != 0) {
+		umask(mask);
+		fprintf(stderr, "daemon: could not listen on %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	umask(mask);
+	return fd;
+}
+
+/*
+ * Read one request in buf, client descriptors in fds.
+ * return its size, -1 if invalid.
+ */
+static int recv_request(int fd, char *buf, size_t size, int *fds) {
+	union {
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+		struct cmsghdr align;
+	} u;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	ssize_t n;
+	int i, nbfds = 0, received[3];
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = buf;
+	iov.iov_len = size - 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = u.buf;
+	msg.msg_controllen = sizeof(u.buf);
+
+	if ((n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC)) <= 0)
+		return -1;
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+		nbfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		if (nbfds > 3)
+			nbfds = 3;
+		memcpy(received, CMSG_DATA(cmsg), nbfds * sizeof(int));
+	}
+	if (nbfds != 3 || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+		for (i = 0; i < nbfds; i++)
+			close(received[i]);
+		return -1;
+	}
+	memcpy(fds, received, sizeof(received));
+	buf[n] = '\0';
+	return n;
+}
+
+/*
+ * NUL separated strings of buf in argv (NULL terminated),
+ * return their number, -1 if too many.
+ */
+static int split_args(char *buf, int len, char **argv) {
+	char *p = buf;
+	int argc = 0;
+
+	while (p < buf + len) {
+		if (argc == DAEMON_MAXARGS + 1)
+			return -1;
+		argv[argc++] = p;
+		p += strlen(p) + 1;
+	}
+	argv[argc] = NULL;
+	return argc;
+}
+
+/*
+ * Forked child: reads the request (so a slow client only delays
+ * itself), client descriptors as stdin, stdout and stderr, client
+ * working directory, then the command line as usual.
+ */
+static void serve_child(struct bittrex_info *bi, int client, daemon_cmd cmd) {
+	struct timeval recvtimeo = { DAEMON_RECVTIMEO, 0 };
+	char buf[DAEMON_MSGSIZE], *argv[DAEMON_MAXARGS + 2];
+	int i, len, argc, fds[3];
+
+	signal(SIGCHLD, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGPIPE, SIG_DFL);
+	close(sigpipe[0]);
+	close(sigpipe[1]);
+
+	/* a client connected but silent does not keep a child forever */
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &recvtimeo, sizeof(recvtimeo));
+	if ((len = recv_request(client, buf, sizeof(buf), fds)) < 0) {
+		fprintf(stderr, "daemon: invalid request\n");
+		exit(EINVAL);
+	}
+	close(client);
+	if ((argc = split_args(buf, len, argv)) < 2) {
+		fprintf(stderr, "daemon: invalid request\n");
+		exit(EINVAL);
+	}
+	for (i = 0; i < 3; i++) {
+		dup2(fds[i], i);
+		if (fds[i] > 2)
+			close(fds[i]);
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--daemon", strlen("--daemon")) == 0) {
+			fprintf(stderr, "--daemon can not be sent to a daemon\n");
+			exit(EINVAL);
+		}
+	}
+	if (chdir(argv[0]) != 0) {
+		fprintf(stderr, "daemon: could not change directory to %s\n", argv[0]);
+		exit(ENOENT);
+	}
+	/* full getopt reinit, options were already parsed by the daemon */
+	optind = 0;
+	exit(cmd(bi, argc - 1, argv + 1));
+}
+
+static void send_status(int client, int rc) {
+	send(client, &rc, sizeof(rc), MSG_NOSIGNAL);
+	close(client);
+}
+
+int daemon_exit_code(int status) {
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	return 128 + WTERMSIG(status);
+}
+
+/*
+ * Markets and currencies reloaded, previous ones kept if the API fails
+ */
+static void daemon_refresh(struct bittrex_info *bi) {
+	struct market **markets = bi->markets;
+	struct currency **currencies = bi->currencies;
+	int nbmarkets = bi->nbmarkets;
+
+	bi->markets = NULL;
+	getmarkets(bi);
+	if (bi->markets) {
+		free_markets(markets);
+	} else {
+		bi->markets = markets;
+		bi->nbmarkets = nbmarkets;
+	}
+	if ((bi->currencies = getcurrencies(bi)))
+		free_currencies(currencies);
+	else
+		bi->currencies = currencies;
+}
+
+int daemon_prepare(struct bittrex_info *bi) {
+	if (!bi->markets)
+		getmarkets(bi);
+	if (!bi->currencies)
+		bi->currencies = getcurrencies(bi);
+	/* children send signed calls concurrently */
+	return nonce_share();
+}
+
+int daemon_serve(struct bittrex_info *bi, const char *path, daemon_cmd cmd) {
+	struct daemon_child children[DAEMON_CHILDREN];
+	struct pollfd pfd[2];
+	char drain[64];
+	time_t loaded;
+	pid_t pid;
+	long timeout;
+	int listenfd, client, nbchildren = 0, i, status;
+
+	if (daemon_prepare(bi) != 0 || daemon_signals() != 0)
+		return ENOMEM;
+	loaded = time(NULL);
+	if ((listenfd = daemon_listen(path)) < 0)
+		return EADDRINUSE;
+	printf("Listening on %s\n", path);
+	fflush(stdout);
+
+	while (!stop) {
+		timeout = (loaded + DAEMON_REFRESH - time(NULL)) * 1000;
+		pfd[0].fd = sigpipe[0];
+		pfd[0].events = POLLIN;
+		pfd[1].fd = listenfd;
+		/* busy: requests wait in the listen backlog */
+		pfd[1].events = nbchildren < DAEMON_CHILDREN ? POLLIN : 0;
+		pfd[1].revents = 0;
+		if (poll(pfd, 2, timeout > 0 ? timeout : 0) < 0 && errno != EINTR) {
+			perror("daemon: poll");
+			break;
+		}
+		while (read(sigpipe[0], drain, sizeof(drain)) > 0);
+
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			for (i = 0; i < nbchildren && children[i].pid != pid; i++);
+			if (i == nbchildren)
+				continue;
+			send_status(children[i].client, daemon_exit_code(status));
+			children[i] = children[--nbchildren];
+		}
+
+		if (time(NULL) - loaded >= DAEMON_REFRESH) {
+			daemon_refresh(bi);
+			loaded = time(NULL);
+		}
+
+		if (stop || !(pfd[1].revents & POLLIN))
+			continue;
+		if ((client = accept(listenfd, NULL, NULL)) < 0)
+			continue;
+		fcntl(client, F_SETFD, FD_CLOEXEC);
+
+		/*
+		 * Fork at once, the request is read by the child: this loop
+		 * never waits for a client.
+		 */
+		fflush(stdout);
+		fflush(stderr);
+		if ((pid = fork()) == 0) {
+			close(listenfd);
+			for (i = 0; i < nbchildren; i++)
+				close(children[i].client);
+			serve_child(bi, client, cmd);
+		}
+		if (pid < 0) {
+			perror("daemon: fork");
+			send_status(client, EAGAIN);
+			continue;
+		}
+		children[nbchildren].pid = pid;
+		children[nbchildren].client = client;
+		nbchildren++;
+	}
+
+	/* running requests complete */
+	close(listenfd);
+	unlink(path);
+	for (i = 0; i < nbchildren; i++) {
+		while (waitpid(children[i].pid, &status, 0) < 0 && errno == EINTR);
+		send_status(children[i].client, daemon_exit_code(status));
+	}
+	printf("Daemon stopped\n");
+	return 0;
+}
+
+int daemon_client(const char *path, int argc, char **argv) {
+	union {
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+		struct cmsghdr align;
+	} u;
+	struct sockaddr_un addr;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	char buf[DAEMON_MSGSIZE];
+	size_t len, n;
+	ssize_t r;
+	int fd, i, rc, nbargs = 0, fds[3] = {0, 1, 2};
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "daemon: socket path too long: %s\n", path);
+		return EINVAL;
+	}
+	if (!getcwd(buf, sizeof(buf))) {
+		perror("getcwd");
+		return ENOENT;
+	}
+	len = strlen(buf) + 1;
+	for (i = 0; i < argc; i++) {
+		if (strncmp(argv[i], "--socket=", strlen("--socket=")) == 0)
+			continue;
+		n = strlen(argv[i]) + 1;
+		if (len + n > sizeof(buf) || ++nbargs > DAEMON_MAXARGS) {
+			fprintf(stderr, "daemon: too many arguments\n");
+			return E2BIG;
+		}
+		memcpy(buf + len, argv[i], n);
+		len += n;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if ((fd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0 ||
+	    connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		fprintf(stderr, "daemon: could not connect to %s: %s\n", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return ECONNREFUSED;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&u, 0, sizeof(u));
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = u.buf;
+	msg.msg_controllen = sizeof(u.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(fd, &msg, 0) < 0) {
+		perror("daemon: sendmsg");
+		close(fd);
+		return EIO;
+	}
+	/* output goes straight to our descriptors, then the status */
+	while ((r = recv(fd, &rc, sizeof(rc), 0)) < 0 && errno == EINTR);
+	close(fd);
+	if (r != sizeof(rc)) {
+		fprintf(stderr, "daemon: no status from %s\n", path);
+		return EIO;
+	}
+	return rc;
+}
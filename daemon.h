@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "bittrex.h"
+
+#define DAEMON_CHILDREN	16	/* requests served at once */
+#define DAEMON_REFRESH	3600	/* seconds between markets and currencies reloads */
+#define DAEMON_MSGSIZE	16384	/* request: working directory and arguments */
+#define DAEMON_MAXARGS	64
+#define DAEMON_RECVTIMEO 2	/* seconds a client has to send its request */
+
+/*
+ * Runs one command line (same as main), returns the exit status
+ */
+typedef int (*daemon_cmd)(struct bittrex_info *bi, int argc, char **argv);
+
+/*
+ * Load what commands need before forking children (markets, currencies)
+ * and share the nonce between them. return 0 on success.
+ */
+int daemon_prepare(struct bittrex_info *bi);
+
+/*
+ * Exit status of a child (waitpid) as a shell would report it
+ */
+int daemon_exit_code(int status);
+
+/*
+ * Keep bi warm (markets, currencies, API key, caches, TLS sessions) and
+ * serve requests on the Unix socket path until SIGTERM or SIGINT.
+ *
+ * A request is the client working directory and arguments with its
+ * stdin, stdout and stderr (SCM_RIGHTS). Each one runs cmd in a forked
+ * child writing straight to the client, the reply is its exit status.
+ */
+int daemon_serve(struct bittrex_info *bi, const char *path, daemon_cmd cmd);
+
+/*
+ * Forward argv (without --socket=) to the daemon listening on path,
+ * returns the exit status of the command.
+ */
+int daemon_client(const char *path, int argc, char **argv);
+
+#endif
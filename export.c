@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "export.h"
+#include "archive.h"
+#include "indicators.h"
+
+static const char *export_columns[EXPORT_NBCOLS] = {
+	"timestamp", "open", "high", "low", "close", "volume", "btcval",
+	"rsi", "ema", "macd", "macdsignal", "macdhisto"
+};
+
+/*
+ * one market, columnar
+ */
+struct export_series {
+	size_t n;
+	int64_t *timestamp;
+	double *col[EXPORT_NBCOLS - 1];
+};
+
+struct export_job {
+	struct bittrex_info *bi;
+	struct market **markets;
+	char *interval;
+	char *outdir;
+	int format;
+	int nbmarkets;
+	int next;
+	int done;
+	pthread_mutex_t lock;
+};
+
+static void free_series(struct export_series *s) {
+	int i;
+
+	if (s) {
+		free(s->timestamp);
+		for (i = 0; i < EXPORT_NBCOLS - 1; i++)
+			free(s->col[i]);
+		free(s);
+	}
+}
+
+static struct export_series *new_series(size_t n) {
+	struct export_series *s;
+	int i;
+
+	if (!(s = calloc(1, sizeof(struct export_series))))
+		return NULL;
+	s->n = n;
+	s->timestamp = malloc(n * sizeof(int64_t));
+	for (i = 0; i < EXPORT_NBCOLS - 1; i++)
+		s->col[i] = malloc(n * sizeof(double));
+	for (i = 0; i < EXPORT_NBCOLS - 1; i++)
+		if (!s->col[i])
+			break;
+	if (!s->timestamp || i < EXPORT_NBCOLS - 1) {
+		free_series(s);
+		return NULL;
+	}
+	return s;
+}
+
+static struct export_series *series_from_archive(struct archive *a) {
+	struct export_series *s;
+	size_t i;
+
+	if (!(s = new_series(a->nbcandles)))
+		return NULL;
+	for (i = 0; i < a->nbcandles; i++) {
+		s->timestamp[i] = a->candles[i].timestamp;
+		s->col[0][i] = a->candles[i].open;
+		s->col[1][i] = a->candles[i].high;
+		s->col[2][i] = a->candles[i].low;
+		s->col[3][i] = a->candles[i].close;
+		s->col[4][i] = a->candles[i].volume;
+		s->col[5][i] = a->candles[i].btcval;
+	}
+	return s;
+}
+
+static struct export_series *series_from_ticks(struct tick **ticks) {
+	struct export_series *s;
+	size_t n, i;
+
+	for (n = 0; ticks[n]; n++);
+	if (!(s = new_series(n)))
+		return NULL;
+	for (i = 0; i < n; i++) {
+		s->timestamp[i] = ticks[i]->timestamp / 1000;
+		s->col[0][i] = ticks[i]->open;
+		s->col[1][i] = ticks[i]->high;
+		s->col[2][i] = ticks[i]->low;
+		s->col[3][i] = ticks[i]->close;
+		s->col[4][i] = ticks[i]->volume;
+		s->col[5][i] = ticks[i]->btcval;
+	}
+	return s;
+}
+
+static struct export_series *load_series(struct export_job *job, struct market *m) {
+	struct export_series *s = NULL;
+	struct archive *a;
+	struct tick **ticks;
+
+	if ((a = archive_open(job->bi->archivedir, m->marketname, job->interval))) {
+		if (a->nbcandles > 0)
+			s = series_from_archive(a);
+		archive_close(a);
+		return s;
+	}
+	/* no archive, only for a single market (API calls are throttled) */
+	if (job->nbmarkets == 1 &&
+	    (ticks = getticks(job->bi, m, job->interval, 0, DESCENDING))) {
+		s = series_from_ticks(ticks);
+		free_ticks(ticks);
+	}
+	return s;
+}
+
+static void series_indicators(struct export_series *s) {
+	ind_rsi(s->col[3], s->n, RSI_PERIOD, s->col[6]);
+	ind_ema(s->col[3], s->n, EXPORT_EMA_PERIOD, s->col[7]);
+	ind_macd(s->col[3], s->n, MACD_FAST, MACD_SLOW, MACD_SIGNAL,
+		 s->col[8], s->col[9], s->col[10]);
+}
+
+static int write_csv(FILE *f, struct export_series *s) {
+	char *buf;
+	size_t len = 0, i;
+	int j;
+
+	if (!(buf = malloc(EXPORT_BUFSIZE)))
+		return -1;
+	for (j = 0; j < EXPORT_NBCOLS; j++)
+		len += sprintf(buf + len, j ? ",%s" : "%s", export_columns[j]);
+	buf[len++] = '\n';
+
+	for (i = 0; i < s->n; i++) {
+		/* flush before the next line may not fit */
+		if (EXPORT_BUFSIZE - len < 512) {
+			fwrite(buf, 1, len, f);
+			len = 0;
+		}
+		len += sprintf(buf + len, "%lld", (long long)s->timestamp[i]);
+		for (j = 0; j < EXPORT_NBCOLS - 1; j++)
+			len += sprintf(buf + len, ",%.8f", s->col[j][i]);
+		buf[len++] = '\n';
+	}
+	fwrite(buf, 1, len, f);
+	free(buf);
+	return ferror(f) ? -1 : 0;
+}
+
+static int write_bin(FILE *f, struct export_series *s, struct market *m, char *interval) {
+	struct export_header h;
+	int j;
+
+	memset(&h, 0, sizeof(h));
+	h.magic = EXPORT_MAGIC;
+	h.version = EXPORT_VERSION;
+	h.nbrows = s->n;
+	h.nbcols = EXPORT_NBCOLS;
+	strncpy(h.marketname, m->marketname, sizeof(h.marketname) - 1);
+	strncpy(h.interval, interval, sizeof(h.interval) - 1);
+	for (j = 0; j < EXPORT_NBCOLS; j++)
+		strncpy(h.columns[j], export_columns[j], sizeof(h.columns[j]) - 1);
+
+	fwrite(&h, sizeof(h), 1, f);
+	fwrite(s->timestamp, sizeof(int64_t), s->n, f);
+	for (j = 0; j < EXPORT_NBCOLS - 1; j++)
+		fwrite(s->col[j], sizeof(double), s->n, f);
+	return ferror(f) ? -1 : 0;
+}
+
+static int export_market(struct export_job *job, struct market *m) {
+	struct export_series *s;
+	char *path;
+	FILE *f;
+	int rc;
+
+	if (!(s = load_series(job, m)))
+		return 0;
+	series_indicators(s);
+
+	path = malloc(strlen(job->outdir) + strlen(m->marketname) +
+		      strlen(job->interval) + strlen("/..csv") + 1);
+	sprintf(path, "%s/%s.%s.%s", job->outdir, m->marketname, job->interval,
+		job->format == EXPORT_BIN ? "bin" : "csv");
+	if (!(f = fopen(path, "w"))) {
+		fprintf(stderr, "export: could not open %s\n", path);
+		free(path);
+		free_series(s);
+		return 0;
+	}
+	setvbuf(f, NULL, _IOFBF, EXPORT_BUFSIZE);
+	if (job->format == EXPORT_BIN)
+		rc = write_bin(f, s, m, job->interval);
+	else
+		rc = write_csv(f, s);
+	if (fclose(f) != 0 || rc < 0) {
+		fprintf(stderr, "export: could not write %s\n", path);
+		rc = -1;
+	}
+	free(path);
+	free_series(s);
+	return rc == 0;
+}
+
+static void *export_worker(void *j) {
+	struct export_job *job = (struct export_job *)j;
+	int i, ok;
+
+	while (1) {
+		pthread_mutex_lock(&(job->lock));
+		i = job->next++;
+		pthread_mutex_unlock(&(job->lock));
+		if (i >= job->nbmarkets)
+			break;
+		ok = export_market(job, job->markets[i]);
+		pthread_mutex_lock(&(job->lock));
+		job->done += ok;
+		pthread_mutex_unlock(&(job->lock));
+	}
+	return NULL;
+}
+
+int export_markets(struct bittrex_info *bi, struct market *m, char *interval,
+		   int format, char *outdir) {
+	struct export_job job;
+	struct market *single[2] = { m, NULL };
+	pthread_t threads[EXPORT_THREADS];
+	int i, nbthreads;
+
+	if (!interval || !outdir || (!m && !bi->markets))
+		return 0;
+
+	job.bi = bi;
+	job.markets = m ? single : bi->markets;
+	job.interval = interval;
+	job.outdir = outdir;
+	job.format = format;
+	job.next = 0;
+	job.done = 0;
+	for (job.nbmarkets = 0; job.markets[job.nbmarkets]; job.nbmarkets++);
+	pthread_mutex_init(&(job.lock), NULL);
+
+	nbthreads = job.nbmarkets < EXPORT_THREADS ? job.nbmarkets : EXPORT_THREADS;
+	for (i = 0; i < nbthreads; i++)
+		pthread_create(&(threads[i]), NULL, export_worker, &job);
+	for (i = 0; i < nbthreads; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&(job.lock));
+
+	return job.done;
+}
@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+
+#include "bittrex.h"
+#include "market.h"
+
+#define EXPORT_CSV	0
+#define EXPORT_BIN	1
+
+#define EXPORT_THREADS	8
+#define EXPORT_EMA_PERIOD 24
+#define EXPORT_BUFSIZE	(1 << 20)
+
+#define EXPORT_MAGIC	0x534c4f43 /* "COLS" */
+#define EXPORT_VERSION	1
+#define EXPORT_NBCOLS	12
+
+/*
+ * Columnar binary export (<outdir>/<market>.<interval>.bin):
+ * header then each column stored contiguously, nbrows values each.
+ * timestamp column is int64 (UTC epoch seconds), others are double.
+ */
+struct export_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t nbrows;
+	uint32_t nbcols;
+	uint32_t reserved;
+	char marketname[32];
+	char interval[16];
+	char columns[EXPORT_NBCOLS][16];
+};
+
+/*
+ * Export candles with RSI, EMA and MACD columns of market m,
+ * or of all markets if m is NULL, to outdir.
+ * Candles are read from the archive (bi->archivedir), getticks() is
+ * only used for a single market without archive.
+ * format is EXPORT_CSV or EXPORT_BIN.
+ * return number of markets exported.
+ */
+int export_markets(struct bittrex_info *bi, struct market *m, char *interval,
+		   int format, char *outdir);
+
+#endif
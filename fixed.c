@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#include "fixed.h"
+
+fixed_t fixed_from_double(double d) {
+	return llround(d * FIXED_ONE);
+}
+
+double fixed_to_double(fixed_t f) {
+	return (double)f / FIXED_ONE;
+}
+
+/*
+ * n / d rounded half away from zero, d != 0
+ */
+static int64_t div_round(__int128 n, __int128 d) {
+	__int128 q, r;
+
+	if (d < 0) {
+		n = -n;
+		d = -d;
+	}
+	q = n / d;
+	r = n % d;
+	if (r < 0)
+		r = -r;
+	if (2 * r >= d)
+		q += n < 0 ? -1 : 1;
+	return (int64_t)q;
+}
+
+fixed_t fixed_mul(fixed_t a, fixed_t b) {
+	return div_round((__int128)a * b, FIXED_ONE);
+}
+
+fixed_t fixed_div(fixed_t a, fixed_t b) {
+	if (b == 0)
+		return 0;
+	return div_round((__int128)a * FIXED_ONE, b);
+}
+
+fixed_t fixed_muldiv(fixed_t a, int64_t num, int64_t den) {
+	if (den == 0)
+		return 0;
+	return div_round((__int128)a * num, den);
+}
+
+int fixed_fmt(fixed_t f, char *buf) {
+	char tmp[FIXED_STRLEN];
+	uint64_t u;
+	int i = 0, len = 0;
+
+	if (f < 0) {
+		buf[len++] = '-';
+		u = -(uint64_t)f;
+	} else {
+		u = f;
+	}
+	/* digits in reverse order, at least one before the point */
+	do {
+		tmp[i++] = '0' + u % 10;
+		u /= 10;
+	} while (u || i <= FIXED_DECIMALS);
+
+	while (i > FIXED_DECIMALS)
+		buf[len++] = tmp[--i];
+	buf[len++] = '.';
+	while (i > 0)
+		buf[len++] = tmp[--i];
+	buf[len] = '\0';
+	return len;
+}
+
+int fixed_parse(const char *s, fixed_t *f) {
+	uint64_t ip = 0, fp = 0;
+	int neg = 0, digits = 0, decimals = 0;
+
+	if (!s)
+		return -1;
+	if (*s == '-' || *s == '+')
+		neg = (*s++ == '-');
+
+	for (; *s >= '0' && *s <= '9'; s++, digits++) {
+		ip = ip * 10 + (*s - '0');
+		if (ip > INT64_MAX / FIXED_ONE)
+			return -1;
+	}
+	if (*s == '.') {
+		for (s++; *s >= '0' && *s <= '9'; s++, digits++) {
+			if (decimals < FIXED_DECIMALS) {
+				fp = fp * 10 + (*s - '0');
+				decimals++;
+			} else if (decimals++ == FIXED_DECIMALS && *s >= '5') {
+				/* round on the 9th decimal */
+				fp++;
+			}
+		}
+	}
+	if (!digits || *s != '\0')
+		return -1;
+	while (decimals < FIXED_DECIMALS) {
+		fp *= 10;
+		decimals++;
+	}
+	if (ip * FIXED_ONE + fp > INT64_MAX)
+		return -1;
+	*f = (fixed_t)(ip * FIXED_ONE + fp);
+	if (neg)
+		*f = -*f;
+	return 0;
+}
+
+fixed_t json_fixed_get(json_t *tmp) {
+	if (json_is_integer(tmp))
+		return json_integer_value(tmp) * FIXED_ONE;
+	if (json_is_real(tmp))
+		return fixed_from_double(json_real_value(tmp));
+	return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+#include "lib/jansson/src/jansson.h"
+
+/*
+ * Prices, quantities and balances are stored as integers in 1e-8 units
+ * (satoshis for BTC), the precision of the Bittrex API.
+ * Sums and comparisons are exact, products and quotients are rounded
+ * half away from zero to the 8th decimal.
+ */
+typedef int64_t fixed_t;
+
+#define FIXED_DECIMALS	8
+#define FIXED_ONE	100000000LL
+/* "-92233720368.54775808" plus NUL */
+#define FIXED_STRLEN	24
+
+/* 0.25% commission on every trade, in basis points */
+#define FIXED_FEE_BPS	25
+
+fixed_t fixed_from_double(double d);
+double fixed_to_double(fixed_t f);
+
+/*
+ * a * b and a / b, rounded to the 8th decimal (b == 0 returns 0)
+ */
+fixed_t fixed_mul(fixed_t a, fixed_t b);
+fixed_t fixed_div(fixed_t a, fixed_t b);
+
+/*
+ * a * num / den, rounded (ex: fee with num = FIXED_FEE_BPS, den = 10000)
+ */
+fixed_t fixed_muldiv(fixed_t a, int64_t num, int64_t den);
+
+/*
+ * Format f with 8 decimals ("%.8f") in buf (FIXED_STRLEN bytes at least)
+ * return the length written.
+ */
+int fixed_fmt(fixed_t f, char *buf);
+
+/*
+ * Parse a decimal string ("0.001", "-12", "1.123456789" is rounded)
+ * return 0 on success, -1 if malformed or out of range.
+ */
+int fixed_parse(const char *s, fixed_t *f);
+
+/*
+ * json custom getter, 0 if tmp is NULL or not a number
+ */
+fixed_t json_fixed_get(json_t *tmp);
+
+#endif
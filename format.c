@@ -0,0 +1,247 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "format.h"
+#include "bittrex.h"
+
+int output_format = FORMAT_TEXT;
+
+int format_parse(const char *s) {
+	if (strcmp(s, "jsonl") == 0)
+		return FORMAT_JSONL;
+	if (strcmp(s, "csv") == 0)
+		return FORMAT_CSV;
+	if (strcmp(s, "tsv") == 0)
+		return FORMAT_TSV;
+	if (strcmp(s, "text") == 0)
+		return FORMAT_TEXT;
+	return -1;
+}
+
+void fmt_init(struct fmt *f) {
+	f->format = output_format;
+	f->nbrecords = 0;
+	f->nbfields = 0;
+	f->start = 0;
+	f->len = 0;
+	f->headlen = 0;
+}
+
+void fmt_flush(struct fmt *f) {
+	if (f->len)
+		fwrite(f->buf, 1, f->len, stdout);
+	f->len = 0;
+	fflush(stdout);
+}
+
+/*
+ * Room left in buf for the current record: end of line, and header
+ * inserted before the first record.
+ */
+static size_t room(struct fmt *f) {
+	size_t reserve = 2 + (f->nbrecords ? 0 : FORMAT_HEADSIZE + 1);
+
+	return f->len + reserve < FORMAT_BUFSIZE ? FORMAT_BUFSIZE - reserve - f->len : 0;
+}
+
+static void put(struct fmt *f, const char *s, size_t n) {
+	size_t r = room(f);
+
+	if (n > r)
+		n = r;
+	memcpy(f->buf + f->len, s, n);
+	f->len += n;
+}
+
+static void putch(struct fmt *f, char c) {
+	if (room(f))
+		f->buf[f->len++] = c;
+}
+
+static void head(struct fmt *f, const char *key) {
+	size_t n = strlen(key);
+
+	if (f->nbrecords || f->format == FORMAT_JSONL)
+		return;
+	if (f->nbfields && f->headlen < FORMAT_HEADSIZE)
+		f->head[f->headlen++] = f->format == FORMAT_CSV ? ',' : '\t';
+	if (n > FORMAT_HEADSIZE - f->headlen)
+		n = FORMAT_HEADSIZE - f->headlen;
+	memcpy(f->head + f->headlen, key, n);
+	f->headlen += n;
+}
+
+/*
+ * Separator, key and header for a new field
+ */
+static void field(struct fmt *f, const char *key) {
+	head(f, key);
+	if (f->nbfields++)
+		putch(f, f->format == FORMAT_TSV ? '\t' : ',');
+	if (f->format == FORMAT_JSONL) {
+		putch(f, '"');
+		put(f, key, strlen(key));
+		put(f, "\":", 2);
+	}
+}
+
+void fmt_begin(struct fmt *f) {
+	/* one record never straddles two writes */
+	if (FORMAT_BUFSIZE - f->len < FORMAT_LINESIZE + FORMAT_HEADSIZE + 1)
+		fmt_flush(f);
+	f->start = f->len;
+	f->nbfields = 0;
+	if (f->format == FORMAT_JSONL)
+		putch(f, '{');
+}
+
+void fmt_end(struct fmt *f) {
+	if (f->format == FORMAT_JSONL)
+		f->buf[f->len++] = '}';
+	f->buf[f->len++] = '\n';
+	if (!f->nbrecords && f->format != FORMAT_JSONL) {
+		memmove(f->buf + f->start + f->headlen + 1, f->buf + f->start,
+			f->len - f->start);
+		memcpy(f->buf + f->start, f->head, f->headlen);
+		f->buf[f->start + f->headlen] = '\n';
+		f->len += f->headlen + 1;
+	}
+	f->nbrecords++;
+}
+
+static void null(struct fmt *f) {
+	if (f->format == FORMAT_JSONL)
+		put(f, "null", 4);
+}
+
+void fmt_str(struct fmt *f, const char *key, const char *v) {
+	static const char hex[] = "0123456789abcdef";
+	const char *p;
+	char esc[6] = "\\u00";
+	int quote;
+
+	field(f, key);
+	if (!v) {
+		null(f);
+		return;
+	}
+	switch (f->format) {
+	case FORMAT_JSONL:
+		putch(f, '"');
+		for (p = v; *p; p++) {
+			if (*p == '"' || *p == '\\') {
+				putch(f, '\\');
+				putch(f, *p);
+			} else if ((unsigned char)*p < 0x20) {
+				esc[4] = hex[(unsigned char)*p >> 4];
+				esc[5] = hex[*p & 0xf];
+				put(f, esc, 6);
+			} else {
+				putch(f, *p);
+			}
+		}
+		putch(f, '"');
+		break;
+	case FORMAT_CSV:
+		/* RFC 4180 */
+		quote = strpbrk(v, ",\"\r\n") != NULL;
+		if (quote)
+			putch(f, '"');
+		for (p = v; *p; p++) {
+			if (*p == '"')
+				putch(f, '"');
+			putch(f, *p);
+		}
+		if (quote)
+			putch(f, '"');
+		break;
+	default:
+		for (p = v; *p; p++)
+			putch(f, (*p == '\t' || *p == '\n' || *p == '\r') ? ' ' : *p);
+	}
+}
+
+void fmt_fixed(struct fmt *f, const char *key, fixed_t v) {
+	char buf[FIXED_STRLEN];
+
+	field(f, key);
+	put(f, buf, fixed_fmt(v, buf));
+}
+
+void fmt_real(struct fmt *f, const char *key, double v) {
+	char buf[32];
+
+	if (isnan(v) || isinf(v)) {
+		field(f, key);
+		null(f);
+		return;
+	}
+	/* same digits as "%.8f", without printf, below 9e10 */
+	if (v > -9e10 && v < 9e10) {
+		fmt_fixed(f, key, fixed_from_double(v));
+		return;
+	}
+	field(f, key);
+	put(f, buf, snprintf(buf, sizeof(buf), "%.8e", v));
+}
+
+void fmt_int(struct fmt *f, const char *key, long long v) {
+	char tmp[24];
+	unsigned long long u = v < 0 ? -(unsigned long long)v : (unsigned long long)v;
+	int i = 0;
+
+	field(f, key);
+	if (v < 0)
+		putch(f, '-');
+	do {
+		tmp[i++] = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	while (i > 0)
+		putch(f, tmp[--i]);
+}
+
+void fmt_bool(struct fmt *f, const char *key, int v) {
+	field(f, key);
+	if (v)
+		put(f, "true", 4);
+	else
+		put(f, "false", 5);
+}
+
+void fmt_time(struct fmt *f, const char *key, int64_t ms) {
+	char ts[32];
+
+	if (!ms) {
+		field(f, key);
+		null(f);
+		return;
+	}
+	fmt_str(f, key, timestamp_str(ms, ts, sizeof(ts)));
+}
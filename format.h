@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fixed.h"
+
+/* --format */
+#define FORMAT_TEXT	0	/* human readable (default) */
+#define FORMAT_JSONL	1	/* one JSON object per line */
+#define FORMAT_CSV	2	/* header line, then one line per record */
+#define FORMAT_TSV	3
+
+#define FORMAT_BUFSIZE	(64 * 1024)	/* records written at once */
+#define FORMAT_LINESIZE	4096		/* longest record */
+#define FORMAT_HEADSIZE	1024		/* longest csv/tsv header */
+
+/*
+ * Output format of print functions, set once by main
+ */
+extern int output_format;
+
+/*
+ * "jsonl", "csv", "tsv" or "text", -1 if unknown
+ */
+int format_parse(const char *s);
+
+/*
+ * Records of one print call, serialized in buf and written to stdout
+ * with one fwrite per buffer (or per call). csv/tsv header comes from
+ * the keys of the first record, so all records must have the same keys.
+ */
+struct fmt {
+	int format;
+	int nbrecords;
+	int nbfields;	/* in the current record */
+	size_t start;	/* current record offset in buf */
+	size_t len;
+	size_t headlen;
+	char head[FORMAT_HEADSIZE];
+	char buf[FORMAT_BUFSIZE];
+};
+
+void fmt_init(struct fmt *f);
+void fmt_begin(struct fmt *f);
+void fmt_end(struct fmt *f);
+void fmt_flush(struct fmt *f);
+
+/*
+ * One field of the current record. Strings may be NULL (null/empty),
+ * reals are written with 8 decimals, times are epoch ms (0 is null).
+ */
+void fmt_str(struct fmt *f, const char *key, const char *v);
+void fmt_real(struct fmt *f, const char *key, double v);
+void fmt_fixed(struct fmt *f, const char *key, fixed_t v);
+void fmt_int(struct fmt *f, const char *key, long long v);
+void fmt_bool(struct fmt *f, const char *key, int v);
+void fmt_time(struct fmt *f, const char *key, int64_t ms);
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "hedge.h"
+#include "bittrex.h"
+
+struct hedge_transfer {
+	CURL *curl;
+	struct curl_slist *headers;
+	struct write_result result;
+	int done;
+};
+
+void hedge_init(struct hedge_policy *hp) {
+	hp->enabled = 0;
+	hp->nbendpoints = 0;
+}
+
+/*
+ * State of rootcall (added on first use), bi_lock held.
+ * Like retry endpoints, the last entry is shared if the table is full.
+ */
+static struct hedge_endpoint *endpoint(struct hedge_policy *hp, const char *rootcall) {
+	struct hedge_endpoint *e;
+	int i;
+
+	for (i = 0; i < hp->nbendpoints; i++) {
+		if (strcmp(hp->endpoints[i].rootcall, rootcall) == 0)
+			return &(hp->endpoints[i]);
+	}
+	if (hp->nbendpoints == HEDGE_ENDPOINTS)
+		return &(hp->endpoints[HEDGE_ENDPOINTS - 1]);
+
+	e = &(hp->endpoints[hp->nbendpoints++]);
+	memset(e, 0, sizeof(struct hedge_endpoint));
+	e->rootcall = rootcall;
+	return e;
+}
+
+static int compare_long(const void *a, const void *b) {
+	long la = *(const long *)a, lb = *(const long *)b;
+
+	return (la > lb) - (la < lb);
+}
+
+/*
+ * p95 latency of e in ms, -1 if not enough samples. bi_lock held.
+ */
+static long p95(struct hedge_endpoint *e) {
+	long sorted[HEDGE_SAMPLES];
+
+	if (e->nblatency < HEDGE_MIN_SAMPLES)
+		return -1;
+	memcpy(sorted, e->latency, e->nblatency * sizeof(long));
+	qsort(sorted, e->nblatency, sizeof(long), compare_long);
+	return sorted[(e->nblatency * 95) / 100];
+}
+
+void hedge_latency(struct bittrex_info *bi, const char *rootcall, long ms) {
+	struct hedge_endpoint *e;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->hedge), rootcall);
+	e->latency[e->next] = ms;
+	e->next = (e->next + 1) % HEDGE_SAMPLES;
+	if (e->nblatency < HEDGE_SAMPLES)
+		e->nblatency++;
+	e->calls++;
+	pthread_mutex_unlock(&(bi->bi_lock));
+}
+
+static long elapsed_ms(struct timespec *start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+		(now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int transfer_init(struct hedge_transfer *t, const char *url, char *hmac) {
+	char header[16 + 2 * 64];
+
+	memset(t, 0, sizeof(struct hedge_transfer));
+	if (!(t->curl = curl_easy_init()))
+		return -1;
+	if (!(t->result.data = malloc(BUFFER_SIZE))) {
+		curl_easy_cleanup(t->curl);
+		return -1;
+	}
+	curl_easy_setopt(t->curl, CURLOPT_URL, url);
+	request_share(t->curl);
+	curl_easy_setopt(t->curl, CURLOPT_WRITEFUNCTION, write_response);
+	curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, &(t->result));
+	if (hmac) {
+		snprintf(header, sizeof(header), "apisign:%s", hmac);
+		t->headers = curl_slist_append(t->headers, "Content-Type: ");
+		t->headers = curl_slist_append(t->headers, header);
+		curl_easy_setopt(t->curl, CURLOPT_HTTPHEADER, t->headers);
+	}
+	return 0;
+}
+
+static void transfer_free(CURLM *multi, struct hedge_transfer *t) {
+	curl_multi_remove_handle(multi, t->curl);
+	curl_easy_cleanup(t->curl);
+	curl_slist_free_all(t->headers);
+	free(t->result.data);
+}
+
+/*
+ * 0 if the transfer that just completed got a valid reply
+ */
+static int transfer_check(struct hedge_transfer *t, CURLcode status, const char *url) {
+	long code;
+
+	t->done = 1;
+	if (status != CURLE_OK) {
+		fprintf(stderr, "error: unable to request data from %s:\n", url);
+		fprintf(stderr, "%s\n", curl_easy_strerror(status));
+		return -1;
+	}
+	curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &code);
+	if (code != 200) {
+		fprintf(stderr, "error: server responded with code %ld\n", code);
+		return -1;
+	}
+	return 0;
+}
+
+char *hedged_request(struct bittrex_info *bi, const char *url, char *hmac,
+		     const char *hedge, char *hedgehmac, const char *rootcall) {
+	struct hedge_transfer t[2];
+	struct hedge_endpoint *e;
+	struct timespec start;
+	const char *urls[2] = {url, hedge};
+	CURLM *multi;
+	CURLMsg *msg;
+	char *data = NULL;
+	long threshold, wait;
+	int i, n = 1, running, left, failed = 0, winner = -1;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	threshold = p95(endpoint(&(bi->hedge), rootcall));
+	pthread_mutex_unlock(&(bi->bi_lock));
+	if (threshold < 0 || !hedge)
+		return hmac ? apikey_request(url, hmac) : request(url);
+	if (threshold < HEDGE_MIN_MS)
+		threshold = HEDGE_MIN_MS;
+
+	if (!(multi = curl_multi_init()))
+		return NULL;
+	if (transfer_init(&t[0], url, hmac)) {
+		curl_multi_cleanup(multi);
+		return NULL;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	curl_multi_add_handle(multi, t[0].curl);
+
+	for (;;) {
+		curl_multi_perform(multi, &running);
+		while (winner < 0 && (msg = curl_multi_info_read(multi, &left))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			i = msg->easy_handle == t[0].curl ? 0 : 1;
+			if (transfer_check(&t[i], msg->data.result, urls[i]) == 0)
+				winner = i;
+			else
+				failed++;
+		}
+		/* primary failing before the threshold is not hedged, caller retries */
+		if (winner >= 0 || failed == n)
+			break;
+		if (n == 1 && elapsed_ms(&start) >= threshold) {
+			if (transfer_init(&t[1], hedge, hedgehmac) == 0) {
+				curl_multi_add_handle(multi, t[1].curl);
+				n = 2;
+			}
+			/* hedge could not be sent, wait for primary only */
+			threshold = -1;
+		}
+		wait = 1000;
+		if (n == 1 && threshold > 0)
+			wait = threshold - elapsed_ms(&start);
+		curl_multi_wait(multi, NULL, 0, wait > 0 ? wait : 0, NULL);
+	}
+
+	if (winner >= 0) {
+		data = t[winner].result.data;
+		data[t[winner].result.pos] = '\0';
+		t[winner].result.data = NULL;
+	}
+	for (i = 0; i < n; i++)
+		transfer_free(multi, &t[i]);
+	curl_multi_cleanup(multi);
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->hedge), rootcall);
+	if (n == 2) {
+		e->hedged++;
+		if (winner == 1)
+			e->hedgewins++;
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+	return data;
+}
+
+void printhedgestats(struct bittrex_info *bi) {
+	struct hedge_endpoint *e;
+	int i;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	for (i = 0; i < bi->hedge.nbendpoints; i++) {
+		e = &(bi->hedge.endpoints[i]);
+		printf("%s\tcalls: %ld\tp95: %ldms\thedged: %ld\thedge won: %ld\n",
+		       e->rootcall, e->calls, p95(e), e->hedged, e->hedgewins);
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+}
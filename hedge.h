@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef HEDGE_H
+#define HEDGE_H
+
+#define HEDGE_ENDPOINTS		16
+#define HEDGE_SAMPLES		128	/* latencies kept per endpoint */
+#define HEDGE_MIN_SAMPLES	20	/* no hedging before */
+#define HEDGE_MIN_MS		20	/* never hedge sooner */
+
+struct bittrex_info;
+
+/*
+ * Latencies (ms, ring) and hedging counters of one API call,
+ * in bittrex_info, protected by bi_lock.
+ */
+struct hedge_endpoint {
+	const char *rootcall;
+	long latency[HEDGE_SAMPLES];
+	int nblatency;
+	int next;
+	long calls;
+	long hedged;	/* duplicate request sent */
+	long hedgewins;	/* duplicate replied first */
+};
+
+struct hedge_policy {
+	/* --hedge */
+	int enabled;
+	struct hedge_endpoint endpoints[HEDGE_ENDPOINTS];
+	int nbendpoints;
+};
+
+void hedge_init(struct hedge_policy *hp);
+
+/*
+ * Record the latency of a call to rootcall
+ */
+void hedge_latency(struct bittrex_info *bi, const char *rootcall, long ms);
+
+/*
+ * Send url (signed if hmac) and, if no reply came after the p95 latency
+ * of rootcall, hedge too (same read request, own nonce and hmac if signed).
+ * First successful reply wins, the other transfer is dropped.
+ * Same result as request()/apikey_request().
+ */
+char *hedged_request(struct bittrex_info *bi, const char *url, char *hmac,
+		     const char *hedge, char *hedgehmac, const char *rootcall);
+
+void printhedgestats(struct bittrex_info *bi);
+
+#endif
@@ -0,0 +1,534 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "indicators.h"
+
+/*
+ * AVX2 kernels are built with a target attribute so the rest of the program
+ * does not require -mavx2. They are only used if the CPU supports it and
+ * they match the scalar ones (ind_batch_selftest()).
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#define AVX2_KERNEL __attribute__((target("avx2")))
+#endif
+
+/* set by ind_dispatch() */
+static int avx2_kernels;
+
+static int use_avx2() {
+	return avx2_kernels;
+}
+
+/*
+ * 100 * avg_gain / (avg_gain + avg_loss) is 100 - 100 / (1 + RS)
+ * without the division by zero when there is no loss.
+ */
+static double rsi_value(double avg_gain, double avg_loss) {
+	if (avg_gain + avg_loss == 0)
+		return 50;
+	return 100 * avg_gain / (avg_gain + avg_loss);
+}
+
+/*
+ * Single series
+ */
+void ind_sma(const double *in, int n, int period, double *out) {
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		sum += in[i];
+		if (i >= period)
+			sum -= in[i-period];
+		out[i] = (i >= period - 1) ? sum / period : 0;
+	}
+}
+
+/*
+ * Moving average seeded with the simple average of the first period values
+ */
+static void ewma(const double *in, int n, int period, double weight, double *out) {
+	int i;
+
+	for (i = 0; i < n && i < period - 1; i++)
+		out[i] = 0;
+	if (n < period)
+		return;
+
+	out[period-1] = 0;
+	for (i = 0; i < period; i++)
+		out[period-1] += in[i];
+	out[period-1] /= period;
+
+	for (i = period; i < n; i++)
+		out[i] = in[i] * weight + out[i-1] * (1 - weight);
+}
+
+void ind_ema(const double *in, int n, int period, double *out) {
+	ewma(in, n, period, 2.0/(period+1), out);
+}
+
+void ind_mma(const double *in, int n, int period, double *out) {
+	ewma(in, n, period, 1.0/period, out);
+}
+
+/*
+ * Wilder RSI (modified moving average of gains and losses)
+ */
+void ind_rsi(const double *in, int n, int period, double *out) {
+	double weight = 1.0/period;
+	double avg_gain = 0, avg_loss = 0, diff;
+	int i;
+
+	for (i = 0; i < n && i <= period; i++)
+		out[i] = 0;
+	if (n <= period)
+		return;
+
+	for (i = 1; i <= period; i++) {
+		diff = in[i] - in[i-1];
+		if (diff > 0)
+			avg_gain += diff;
+		else
+			avg_loss -= diff;
+	}
+	avg_gain /= period;
+	avg_loss /= period;
+	out[period] = rsi_value(avg_gain, avg_loss);
+
+	for (i = period + 1; i < n; i++) {
+		diff = in[i] - in[i-1];
+		avg_gain = (diff > 0 ? diff : 0) * weight + avg_gain * (1 - weight);
+		avg_loss = (diff < 0 ? -diff : 0) * weight + avg_loss * (1 - weight);
+		out[i] = rsi_value(avg_gain, avg_loss);
+	}
+}
+
+void ind_macd(const double *in, int n, int fast, int slow, int signal,
+	      double *macd, double *macdsignal, double *macdhisto) {
+	double *f, *s;
+	int i;
+
+	memset(macd, 0, n * sizeof(double));
+	memset(macdsignal, 0, n * sizeof(double));
+	memset(macdhisto, 0, n * sizeof(double));
+	if (n < slow)
+		return;
+
+	f = malloc(n * sizeof(double));
+	s = malloc(n * sizeof(double));
+	if (!f || !s) {
+		free(f);
+		free(s);
+		return;
+	}
+	ind_ema(in, n, fast, f);
+	ind_ema(in, n, slow, s);
+	for (i = slow - 1; i < n; i++)
+		macd[i] = f[i] - s[i];
+
+	/* signal line is the EMA of the MACD line, once the MACD line exists */
+	ind_ema(macd + slow - 1, n - slow + 1, signal, macdsignal + slow - 1);
+	for (i = slow + signal - 2; i < n; i++)
+		macdhisto[i] = macd[i] - macdsignal[i];
+
+	free(f);
+	free(s);
+}
+
+void ind_bollinger(const double *in, int n, int period, double k,
+		   double *mid, double *up, double *low) {
+	double var;
+	int i, j;
+
+	ind_sma(in, n, period, mid);
+	for (i = 0; i < n; i++) {
+		if (i < period - 1) {
+			up[i] = low[i] = 0;
+			continue;
+		}
+		var = 0;
+		for (j = i - period + 1; j <= i; j++)
+			var += (in[j] - mid[i]) * (in[j] - mid[i]);
+		var = sqrt(var / period);
+		up[i] = mid[i] + k * var;
+		low[i] = mid[i] - k * var;
+	}
+}
+
+/*
+ * Batch of markets
+ */
+static double *ind_alloc(int stride, int nbticks) {
+	void *p = NULL;
+
+	if (posix_memalign(&p, 32, (size_t)stride * nbticks * sizeof(double)))
+		return NULL;
+	memset(p, 0, (size_t)stride * nbticks * sizeof(double));
+	return p;
+}
+
+struct ind_batch *new_ind_batch(int nbmarkets, int nbticks) {
+	struct ind_batch *b;
+
+	if (nbmarkets <= 0 || nbticks <= 0)
+		return NULL;
+	if (!(b = malloc(sizeof(struct ind_batch))))
+		return NULL;
+	b->nbmarkets = nbmarkets;
+	b->nbticks = nbticks;
+	b->stride = (nbmarkets + 3) & ~3;
+	if (!(b->close = ind_alloc(b->stride, nbticks))) {
+		free(b);
+		return NULL;
+	}
+	return b;
+}
+
+double *new_ind_column(struct ind_batch *b) {
+	return ind_alloc(b->stride, b->nbticks);
+}
+
+/*
+ * Copy the closes of a market, newest close always lands on the last tick.
+ * Shorter series are padded with their oldest close (no gain no loss),
+ * longer series keep only the last nbticks values.
+ */
+void ind_batch_set(struct ind_batch *b, int market, const double *close, int n) {
+	int t, pad;
+
+	if (market < 0 || market >= b->nbmarkets || n <= 0)
+		return;
+	if (n > b->nbticks) {
+		close += n - b->nbticks;
+		n = b->nbticks;
+	}
+	pad = b->nbticks - n;
+	for (t = 0; t < pad; t++)
+		b->close[t * b->stride + market] = close[0];
+	for (t = 0; t < n; t++)
+		b->close[(t + pad) * b->stride + market] = close[t];
+}
+
+double ind_batch_last(struct ind_batch *b, double *out, int market) {
+	return out[(b->nbticks - 1) * b->stride + market];
+}
+
+static void ewma_batch_scalar(const double *in, int stride, int nbticks,
+			      int period, double weight, double *out) {
+	int t, i;
+
+	memset(out, 0, (size_t)stride * nbticks * sizeof(double));
+	if (nbticks < period)
+		return;
+	for (t = 0; t < period; t++)
+		for (i = 0; i < stride; i++)
+			out[(period-1) * stride + i] += in[t * stride + i];
+	for (i = 0; i < stride; i++)
+		out[(period-1) * stride + i] /= period;
+	for (t = period; t < nbticks; t++)
+		for (i = 0; i < stride; i++)
+			out[t * stride + i] = in[t * stride + i] * weight +
+				out[(t-1) * stride + i] * (1 - weight);
+}
+
+static void rsi_batch_scalar(const double *in, int stride, int nbticks,
+			     int period, double *out) {
+	double weight = 1.0/period;
+	double *avg_gain, *avg_loss, diff;
+	int t, i;
+
+	memset(out, 0, (size_t)stride * nbticks * sizeof(double));
+	if (nbticks <= period)
+		return;
+	avg_gain = calloc(stride, sizeof(double));
+	avg_loss = calloc(stride, sizeof(double));
+	if (!avg_gain || !avg_loss) {
+		free(avg_gain);
+		free(avg_loss);
+		return;
+	}
+	for (t = 1; t <= period; t++) {
+		for (i = 0; i < stride; i++) {
+			diff = in[t * stride + i] - in[(t-1) * stride + i];
+			if (diff > 0)
+				avg_gain[i] += diff;
+			else
+				avg_loss[i] -= diff;
+		}
+	}
+	for (i = 0; i < stride; i++) {
+		avg_gain[i] /= period;
+		avg_loss[i] /= period;
+		out[period * stride + i] = rsi_value(avg_gain[i], avg_loss[i]);
+	}
+	for (t = period + 1; t < nbticks; t++) {
+		for (i = 0; i < stride; i++) {
+			diff = in[t * stride + i] - in[(t-1) * stride + i];
+			avg_gain[i] = (diff > 0 ? diff : 0) * weight + avg_gain[i] * (1 - weight);
+			avg_loss[i] = (diff < 0 ? -diff : 0) * weight + avg_loss[i] * (1 - weight);
+			out[t * stride + i] = rsi_value(avg_gain[i], avg_loss[i]);
+		}
+	}
+	free(avg_gain);
+	free(avg_loss);
+}
+
+#ifdef HAVE_AVX2_KERNELS
+AVX2_KERNEL
+static void ewma_batch_avx2(const double *in, int stride, int nbticks,
+			    int period, double weight, double *out) {
+	__m256d w = _mm256_set1_pd(weight);
+	__m256d w1 = _mm256_set1_pd(1 - weight);
+	__m256d p = _mm256_set1_pd(period);
+	__m256d acc;
+	int t, i;
+
+	memset(out, 0, (size_t)stride * nbticks * sizeof(double));
+	if (nbticks < period)
+		return;
+	for (i = 0; i < stride; i += 4) {
+		acc = _mm256_setzero_pd();
+		for (t = 0; t < period; t++)
+			acc = _mm256_add_pd(acc, _mm256_load_pd(in + t * stride + i));
+		acc = _mm256_div_pd(acc, p);
+		_mm256_store_pd(out + (period-1) * stride + i, acc);
+		for (t = period; t < nbticks; t++) {
+			acc = _mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(in + t * stride + i), w),
+					    _mm256_mul_pd(acc, w1));
+			_mm256_store_pd(out + t * stride + i, acc);
+		}
+	}
+}
+
+AVX2_KERNEL
+static __m256d rsi_value_avx2(__m256d avg_gain, __m256d avg_loss) {
+	__m256d sum = _mm256_add_pd(avg_gain, avg_loss);
+	__m256d zero = _mm256_cmp_pd(sum, _mm256_setzero_pd(), _CMP_EQ_OQ);
+	__m256d rsi = _mm256_div_pd(_mm256_mul_pd(avg_gain, _mm256_set1_pd(100)), sum);
+
+	return _mm256_blendv_pd(rsi, _mm256_set1_pd(50), zero);
+}
+
+AVX2_KERNEL
+static void rsi_batch_avx2(const double *in, int stride, int nbticks,
+			   int period, double *out) {
+	__m256d w = _mm256_set1_pd(1.0/period);
+	__m256d w1 = _mm256_set1_pd(1 - 1.0/period);
+	__m256d p = _mm256_set1_pd(period);
+	__m256d zero = _mm256_setzero_pd();
+	__m256d avg_gain, avg_loss, diff;
+	int t, i;
+
+	memset(out, 0, (size_t)stride * nbticks * sizeof(double));
+	if (nbticks <= period)
+		return;
+	for (i = 0; i < stride; i += 4) {
+		avg_gain = avg_loss = zero;
+		for (t = 1; t <= period; t++) {
+			diff = _mm256_sub_pd(_mm256_load_pd(in + t * stride + i),
+					     _mm256_load_pd(in + (t-1) * stride + i));
+			avg_gain = _mm256_add_pd(avg_gain, _mm256_max_pd(diff, zero));
+			avg_loss = _mm256_add_pd(avg_loss, _mm256_max_pd(_mm256_sub_pd(zero, diff), zero));
+		}
+		avg_gain = _mm256_div_pd(avg_gain, p);
+		avg_loss = _mm256_div_pd(avg_loss, p);
+		_mm256_store_pd(out + period * stride + i, rsi_value_avx2(avg_gain, avg_loss));
+		for (t = period + 1; t < nbticks; t++) {
+			diff = _mm256_sub_pd(_mm256_load_pd(in + t * stride + i),
+					     _mm256_load_pd(in + (t-1) * stride + i));
+			avg_gain = _mm256_add_pd(_mm256_mul_pd(_mm256_max_pd(diff, zero), w),
+						 _mm256_mul_pd(avg_gain, w1));
+			avg_loss = _mm256_add_pd(_mm256_mul_pd(_mm256_max_pd(_mm256_sub_pd(zero, diff), zero), w),
+						 _mm256_mul_pd(avg_loss, w1));
+			_mm256_store_pd(out + t * stride + i, rsi_value_avx2(avg_gain, avg_loss));
+		}
+	}
+}
+#endif
+
+static void ewma_batch(const double *in, int stride, int nbticks,
+		       int period, double weight, double *out) {
+#ifdef HAVE_AVX2_KERNELS
+	if (use_avx2()) {
+		ewma_batch_avx2(in, stride, nbticks, period, weight, out);
+		return;
+	}
+#endif
+	ewma_batch_scalar(in, stride, nbticks, period, weight, out);
+}
+
+void ind_ema_batch(struct ind_batch *b, int period, double *out) {
+	ewma_batch(b->close, b->stride, b->nbticks, period, 2.0/(period+1), out);
+}
+
+void ind_mma_batch(struct ind_batch *b, int period, double *out) {
+	ewma_batch(b->close, b->stride, b->nbticks, period, 1.0/period, out);
+}
+
+void ind_rsi_batch(struct ind_batch *b, int period, double *out) {
+#ifdef HAVE_AVX2_KERNELS
+	if (use_avx2()) {
+		rsi_batch_avx2(b->close, b->stride, b->nbticks, period, out);
+		return;
+	}
+#endif
+	rsi_batch_scalar(b->close, b->stride, b->nbticks, period, out);
+}
+
+void ind_macd_batch(struct ind_batch *b, int fast, int slow, int signal,
+		    double *macd, double *macdsignal, double *macdhisto) {
+	size_t size = (size_t)b->stride * b->nbticks;
+	double *s;
+	size_t i;
+	int start = (slow - 1) * b->stride;
+
+	memset(macdsignal, 0, size * sizeof(double));
+	memset(macdhisto, 0, size * sizeof(double));
+	if (b->nbticks < slow) {
+		memset(macd, 0, size * sizeof(double));
+		return;
+	}
+	if (!(s = new_ind_column(b)))
+		return;
+
+	ind_ema_batch(b, fast, macd);
+	ind_ema_batch(b, slow, s);
+	for (i = 0; i < size; i++)
+		macd[i] = ((int)i >= start) ? macd[i] - s[i] : 0;
+
+	/* signal line: EMA of the MACD line starting where MACD is defined */
+	ewma_batch(macd + start, b->stride, b->nbticks - slow + 1, signal,
+		   2.0/(signal+1), macdsignal + start);
+	for (i = (size_t)(slow + signal - 2) * b->stride; i < size; i++)
+		macdhisto[i] = macd[i] - macdsignal[i];
+
+	free(s);
+}
+
+void ind_bollinger_batch(struct ind_batch *b, int period, double k,
+			 double *mid, double *up, double *low) {
+	double *in = b->close, var;
+	int t, j, i, stride = b->stride;
+
+	memset(up, 0, (size_t)stride * b->nbticks * sizeof(double));
+	memset(low, 0, (size_t)stride * b->nbticks * sizeof(double));
+	memset(mid, 0, (size_t)stride * b->nbticks * sizeof(double));
+	for (t = period - 1; t < b->nbticks; t++) {
+		for (j = t - period + 1; j <= t; j++)
+			for (i = 0; i < stride; i++)
+				mid[t * stride + i] += in[j * stride + i];
+		for (i = 0; i < stride; i++)
+			mid[t * stride + i] /= period;
+		for (i = 0; i < stride; i++) {
+			var = 0;
+			for (j = t - period + 1; j <= t; j++)
+				var += (in[j * stride + i] - mid[t * stride + i]) *
+					(in[j * stride + i] - mid[t * stride + i]);
+			var = sqrt(var / period);
+			up[t * stride + i] = mid[t * stride + i] + k * var;
+			low[t * stride + i] = mid[t * stride + i] - k * var;
+		}
+	}
+}
+
+void free_ind_batch(struct ind_batch *b) {
+	if (b) {
+		free(b->close);
+		free(b);
+	}
+}
+
+/*
+ * Compare the batch kernels in use with the single series ones on
+ * 6 random walks (so the last AVX2 register is half padding).
+ */
+int ind_batch_selftest(void) {
+	double series[6][64], *single, *rsi = NULL, *ema = NULL, v;
+	struct ind_batch *b;
+	unsigned int seed = 42;
+	int i, t, rc = -1;
+
+	if (!(b = new_ind_batch(6, 64)) || !(single = malloc(64 * sizeof(double)))) {
+		free_ind_batch(b);
+		return -1;
+	}
+	for (i = 0; i < 6; i++) {
+		v = 1 + i;
+		for (t = 0; t < 64; t++) {
+			seed = seed * 1103515245 + 12345;
+			v *= 1 + ((int)(seed >> 16 & 0x7fff) - 0x4000) / 1e6;
+			series[i][t] = v;
+		}
+		ind_batch_set(b, i, series[i], 64);
+	}
+	if (!(rsi = new_ind_column(b)) || !(ema = new_ind_column(b)))
+		goto out;
+	ind_rsi_batch(b, RSI_PERIOD, rsi);
+	ind_ema_batch(b, MACD_FAST, ema);
+
+	for (i = 0; i < 6; i++) {
+		ind_rsi(series[i], 64, RSI_PERIOD, single);
+		for (t = 0; t < 64; t++)
+			if (fabs(rsi[t * b->stride + i] - single[t]) > 1e-9 * (1 + fabs(single[t])))
+				goto out;
+		ind_ema(series[i], 64, MACD_FAST, single);
+		for (t = 0; t < 64; t++)
+			if (fabs(ema[t * b->stride + i] - single[t]) > 1e-9 * (1 + fabs(single[t])))
+				goto out;
+	}
+	rc = 0;
+out:
+	free(rsi);
+	free(ema);
+	free(single);
+	free_ind_batch(b);
+	return rc;
+}
+
+/*
+ * Use the AVX2 kernels if the CPU supports them and they match the
+ * scalar ones. Runs before main() so no lock is needed.
+ */
+__attribute__((constructor))
+static void ind_dispatch(void) {
+	avx2_kernels = 0;
+#ifdef HAVE_AVX2_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		avx2_kernels = 1;
+#endif
+	if (ind_batch_selftest() != 0) {
+		avx2_kernels = 0;
+		if (ind_batch_selftest() != 0)
+			fprintf(stderr, "indicators: scalar batch kernels differ from single series\n");
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+/*
+ * Pure compute indicators, no API call in here.
+ *
+ * Series are arrays of closes, oldest first (in[0] is the oldest candle).
+ * Output arrays have the same size as the input, values not computable yet
+ * (warm up of the indicator) are set to 0.
+ */
+
+#define RSI_PERIOD	14
+#define MACD_FAST	12
+#define MACD_SLOW	26
+#define MACD_SIGNAL	9
+#define BOLLINGER_PERIOD 20
+#define BOLLINGER_K	2.0
+
+void ind_sma(const double *in, int n, int period, double *out);
+void ind_ema(const double *in, int n, int period, double *out);
+void ind_mma(const double *in, int n, int period, double *out);
+void ind_rsi(const double *in, int n, int period, double *out);
+void ind_macd(const double *in, int n, int fast, int slow, int signal,
+	      double *macd, double *macdsignal, double *macdhisto);
+void ind_bollinger(const double *in, int n, int period, double k,
+		   double *mid, double *up, double *low);
+
+/*
+ * Batch of markets in columns.
+ * close[t * stride + i] is the close of market i at tick t, so one AVX2
+ * register holds the same tick of 4 markets.
+ * All markets of a batch must have the same number of ticks, stride is
+ * nbmarkets rounded up to 4 (padding columns are ignored).
+ * Output arrays must be allocated with new_ind_column().
+ */
+struct ind_batch {
+	int nbmarkets;
+	int nbticks;
+	int stride;
+	double *close;
+};
+
+struct ind_batch *new_ind_batch(int nbmarkets, int nbticks);
+double *new_ind_column(struct ind_batch *b);
+void ind_batch_set(struct ind_batch *b, int market, const double *close, int n);
+double ind_batch_last(struct ind_batch *b, double *out, int market);
+
+void ind_ema_batch(struct ind_batch *b, int period, double *out);
+void ind_mma_batch(struct ind_batch *b, int period, double *out);
+void ind_rsi_batch(struct ind_batch *b, int period, double *out);
+void ind_macd_batch(struct ind_batch *b, int fast, int slow, int signal,
+		    double *macd, double *macdsignal, double *macdhisto);
+void ind_bollinger_batch(struct ind_batch *b, int period, double k,
+			 double *mid, double *up, double *low);
+
+void free_ind_batch(struct ind_batch *b);
+
+/*
+ * Check the batch kernels against the single series ones,
+ * return 0 if they match. AVX2 kernels are not used if they do not.
+ */
+int ind_batch_selftest(void);
+
+#endif
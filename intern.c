@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "intern.h"
+#include "arena.h"
+
+#define INTERN_MINSIZE	1024	/* hash slots, power of 2 */
+
+/*
+ * open addressing hash table of ids (id + 1, 0 is empty),
+ * strings are stored in one arena.
+ */
+static struct {
+	struct arena *strings;
+	char **names;
+	uint32_t *hashes;
+	int nbnames;
+	int capacity;
+	int *slots;
+	int nbslots;
+	pthread_mutex_t lock;
+} table = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* FNV-1a */
+static uint32_t hash(const char *s) {
+	uint32_t h = 2166136261u;
+
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/*
+ * slot of s, or empty slot where s should go
+ */
+static int find_slot(const char *s, uint32_t h) {
+	int i = h & (table.nbslots - 1), id;
+
+	while ((id = table.slots[i]) != 0) {
+		if (table.hashes[id - 1] == h && strcmp(table.names[id - 1], s) == 0)
+			return i;
+		i = (i + 1) & (table.nbslots - 1);
+	}
+	return i;
+}
+
+static int grow(void) {
+	int *slots, nbslots, i, j;
+
+	nbslots = table.nbslots ? 2 * table.nbslots : INTERN_MINSIZE;
+	if (!(slots = calloc(nbslots, sizeof(int))))
+		return -1;
+	for (i = 0; i < table.nbnames; i++) {
+		j = table.hashes[i] & (nbslots - 1);
+		while (slots[j])
+			j = (j + 1) & (nbslots - 1);
+		slots[j] = i + 1;
+	}
+	free(table.slots);
+	table.slots = slots;
+	table.nbslots = nbslots;
+	return 0;
+}
+
+static int intern_locked(const char *s, int add) {
+	char **names;
+	uint32_t *hashes, h;
+	int i;
+
+	if (!table.slots && (!add || grow() < 0))
+		return -1;
+	h = hash(s);
+	i = find_slot(s, h);
+	if (table.slots[i])
+		return table.slots[i] - 1;
+	if (!add)
+		return -1;
+
+	if (!table.strings && !(table.strings = new_arena(ARENA_BLOCKSIZE)))
+		return -1;
+	if (table.nbnames == table.capacity) {
+		table.capacity = table.capacity ? 2 * table.capacity : 256;
+		names = realloc(table.names, table.capacity * sizeof(char *));
+		if (names)
+			table.names = names;
+		hashes = realloc(table.hashes, table.capacity * sizeof(uint32_t));
+		if (hashes)
+			table.hashes = hashes;
+		if (!names || !hashes)
+			return -1;
+	}
+	if (!(table.names[table.nbnames] = arena_strdup(table.strings, s)))
+		return -1;
+	table.hashes[table.nbnames] = h;
+	table.slots[i] = ++table.nbnames;
+	/* keep load factor under 1/2 */
+	if (2 * table.nbnames > table.nbslots && grow() < 0)
+		return -1;
+	return table.nbnames - 1;
+}
+
+int intern(const char *s) {
+	int id;
+
+	if (!s)
+		return -1;
+	pthread_mutex_lock(&table.lock);
+	id = intern_locked(s, 1);
+	pthread_mutex_unlock(&table.lock);
+	return id;
+}
+
+int intern_lookup(const char *s) {
+	int id;
+
+	if (!s)
+		return -1;
+	pthread_mutex_lock(&table.lock);
+	id = intern_locked(s, 0);
+	pthread_mutex_unlock(&table.lock);
+	return id;
+}
+
+char *intern_name(int id) {
+	char *s = NULL;
+
+	pthread_mutex_lock(&table.lock);
+	if (id >= 0 && id < table.nbnames)
+		s = table.names[id];
+	pthread_mutex_unlock(&table.lock);
+	return s;
+}
+
+char *intern_string(const char *s) {
+	return s ? intern_name(intern(s)) : NULL;
+}
+
+void free_interned(void) {
+	pthread_mutex_lock(&table.lock);
+	free_arena(table.strings);
+	free(table.names);
+	free(table.hashes);
+	free(table.slots);
+	table.strings = NULL;
+	table.names = NULL;
+	table.hashes = NULL;
+	table.slots = NULL;
+	table.nbnames = table.capacity = table.nbslots = 0;
+	pthread_mutex_unlock(&table.lock);
+}
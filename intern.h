@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef INTERN_H
+#define INTERN_H
+
+/*
+ * Interned strings (market and currency names).
+ * Each distinct name gets a small integer id, valid for the whole
+ * process, and a single copy of the string that must not be freed.
+ * Thread safe.
+ */
+
+/*
+ * id of s, added if not yet interned, -1 on error
+ */
+int intern(const char *s);
+
+/*
+ * id of s, -1 if not interned (never adds)
+ */
+int intern_lookup(const char *s);
+
+/*
+ * interned string of id, NULL if invalid
+ */
+char *intern_name(int id);
+
+/*
+ * shortcut for intern_name(intern(s)), NULL if s is NULL
+ */
+char *intern_string(const char *s);
+
+void free_interned(void);
+
+#endif
@@ -131,19 +131,41 @@ void hmac_sha512(const unsigned char *key, unsigned int key_size,
     hmac_sha512_final(&ctx, mac, mac_size);
 }
 
+void hmac_hex(const unsigned char *mac, unsigned int size, char *out)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        out[2*i] = hex[mac[i] >> 4];
+        out[2*i + 1] = hex[mac[i] & 0x0f];
+    }
+    out[2*size] = '\0';
+}
+
 char *hmacstr(char *key, char *str)
 {
     unsigned char mac[SHA512_DIGEST_SIZE];
     char *output = malloc(2 * SHA512_DIGEST_SIZE + 1);
-    int i;
 
     hmac_sha512((const unsigned char*)key, strlen(key),
 		(unsigned char *) str, strlen(str),
 		mac, SHA512_DIGEST_SIZE);
-    for (i=0; i < SHA512_DIGEST_SIZE; i++) {
-	    sprintf(output + 2*i, "%02x", mac[i]);
-    }
+    hmac_hex(mac, SHA512_DIGEST_SIZE, output);
     return output;
 }
 
+char *hmacstr_ctx(const hmac_sha512_ctx *ctx, char *str)
+{
+    hmac_sha512_ctx tmp;
+    unsigned char mac[SHA512_DIGEST_SIZE];
+    char *output = malloc(2 * SHA512_DIGEST_SIZE + 1);
 
+    /* ipad/opad blocks are already compressed in the reinit contexts */
+    memcpy(&tmp.ctx_inside, &ctx->ctx_inside_reinit, sizeof(sha512_ctx));
+    memcpy(&tmp.ctx_outside, &ctx->ctx_outside_reinit, sizeof(sha512_ctx));
+    hmac_sha512_update(&tmp, (unsigned char *) str, strlen(str));
+    hmac_sha512_final(&tmp, mac, SHA512_DIGEST_SIZE);
+    hmac_hex(mac, SHA512_DIGEST_SIZE, output);
+    return output;
+}
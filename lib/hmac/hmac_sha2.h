@@ -36,6 +36,10 @@
  * - Kept only sha512 operations
  * - main replaced by hmacstr(string to be encoded, key string)
  *
+ * Modified in 2018:
+ * - hmacstr_ctx() signs with a context initialized once for the key
+ * - hex encoding without sprintf
+ *
  */
 
 #ifndef HMAC_SHA2_H
@@ -67,5 +71,16 @@ void hmac_sha512(const unsigned char *key, unsigned int key_size,
                  unsigned char *mac, unsigned mac_size);
 char *hmacstr(char *key, char *str);
 
+/*
+ * Same as hmacstr() with the key schedule of ctx (hmac_sha512_init() once),
+ * ctx is only read so it can be shared between threads.
+ */
+char *hmacstr_ctx(const hmac_sha512_ctx *ctx, char *str);
+
+/*
+ * Lowercase hex of mac in out (2 * size + 1 bytes)
+ */
+void hmac_hex(const unsigned char *mac, unsigned int size, char *out);
+
 #endif /* !HMAC_SHA2_H */
 
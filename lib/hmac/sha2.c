@@ -31,10 +31,7 @@
  * SUCH DAMAGE.
  */
 
-#if 0
-#define UNROLL_LOOPS /* Enable loops unrolling */
-#endif
-
+#include <stdio.h>
 #include <string.h>
 
 #include "sha2.h"
@@ -209,8 +206,15 @@ uint64 sha512_k[80] =
 
 /* SHA-512 functions */
 
-void sha512_transf(sha512_ctx *ctx, const unsigned char *message,
-                   unsigned int block_nb)
+/*
+ * Compression kernels. sha512_transf() calls the one selected at load
+ * time by sha512_dispatch(), the reference loop is the fallback.
+ */
+typedef void (*sha512_kernel_t)(sha512_ctx *ctx, const unsigned char *message,
+                                unsigned int block_nb);
+
+static void sha512_transf_ref(sha512_ctx *ctx, const unsigned char *message,
+                              unsigned int block_nb)
 {
     uint64 w[80];
     uint64 wv[8];
@@ -221,7 +225,6 @@ void sha512_transf(sha512_ctx *ctx, const unsigned char *message,
     for (i = 0; i < (int) block_nb; i++) {
         sub_block = message + (i << 7);
 
-#ifndef UNROLL_LOOPS
         for (j = 0; j < 16; j++) {
             PACK64(&sub_block[j << 3], &w[j]);
         }
@@ -251,7 +254,21 @@ void sha512_transf(sha512_ctx *ctx, const unsigned char *message,
         for (j = 0; j < 8; j++) {
             ctx->h[j] += wv[j];
         }
-#else
+    }
+}
+
+static void sha512_transf_unrolled(sha512_ctx *ctx, const unsigned char *message,
+                                   unsigned int block_nb)
+{
+    uint64 w[80];
+    uint64 wv[8];
+    uint64 t1, t2;
+    const unsigned char *sub_block;
+    int i, j;
+
+    for (i = 0; i < (int) block_nb; i++) {
+        sub_block = message + (i << 7);
+
         PACK64(&sub_block[  0], &w[ 0]); PACK64(&sub_block[  8], &w[ 1]);
         PACK64(&sub_block[ 16], &w[ 2]); PACK64(&sub_block[ 24], &w[ 3]);
         PACK64(&sub_block[ 32], &w[ 4]); PACK64(&sub_block[ 40], &w[ 5]);
@@ -300,7 +317,65 @@ void sha512_transf(sha512_ctx *ctx, const unsigned char *message,
         ctx->h[2] += wv[2]; ctx->h[3] += wv[3];
         ctx->h[4] += wv[4]; ctx->h[5] += wv[5];
         ctx->h[6] += wv[6]; ctx->h[7] += wv[7];
-#endif /* !UNROLL_LOOPS */
+    }
+}
+
+static sha512_kernel_t sha512_kernel = sha512_transf_ref;
+
+void sha512_transf(sha512_ctx *ctx, const unsigned char *message,
+                   unsigned int block_nb)
+{
+    sha512_kernel(ctx, message, block_nb);
+}
+
+/* FIPS 180-2 appendix C test vectors */
+static const struct {
+    const char *message;
+    const char *digest;
+} sha512_vectors[] = {
+    {"",
+     "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+     "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"},
+    {"abc",
+     "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+     "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+     "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+     "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"},
+    {NULL, NULL}
+};
+
+int sha512_selftest(void)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char digest[SHA512_DIGEST_SIZE];
+    int i, j;
+
+    for (i = 0; sha512_vectors[i].message; i++) {
+        sha512((const unsigned char *) sha512_vectors[i].message,
+               strlen(sha512_vectors[i].message), digest);
+        for (j = 0; j < SHA512_DIGEST_SIZE; j++) {
+            if (sha512_vectors[i].digest[2*j] != hex[digest[j] >> 4] ||
+                sha512_vectors[i].digest[2*j + 1] != hex[digest[j] & 0x0f])
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The unrolled kernel is kept only if it passes the test vectors.
+ * Runs before main() so no lock is needed.
+ */
+__attribute__((constructor))
+static void sha512_dispatch(void)
+{
+    sha512_kernel = sha512_transf_unrolled;
+    if (sha512_selftest() != 0) {
+        sha512_kernel = sha512_transf_ref;
+        if (sha512_selftest() != 0)
+            fprintf(stderr, "sha512: reference kernel failed test vectors\n");
     }
 }
 
@@ -316,17 +391,10 @@ void sha512(const unsigned char *message, unsigned int len,
 
 void sha512_init(sha512_ctx *ctx)
 {
-#ifndef UNROLL_LOOPS
     int i;
     for (i = 0; i < 8; i++) {
         ctx->h[i] = sha512_h0[i];
     }
-#else
-    ctx->h[0] = sha512_h0[0]; ctx->h[1] = sha512_h0[1];
-    ctx->h[2] = sha512_h0[2]; ctx->h[3] = sha512_h0[3];
-    ctx->h[4] = sha512_h0[4]; ctx->h[5] = sha512_h0[5];
-    ctx->h[6] = sha512_h0[6]; ctx->h[7] = sha512_h0[7];
-#endif /* !UNROLL_LOOPS */
 
     ctx->len = 0;
     ctx->tot_len = 0;
@@ -371,10 +439,7 @@ void sha512_final(sha512_ctx *ctx, unsigned char *digest)
     unsigned int block_nb;
     unsigned int pm_len;
     unsigned int len_b;
-
-#ifndef UNROLL_LOOPS
     int i;
-#endif
 
     block_nb = 1 + ((SHA512_BLOCK_SIZE - 17)
                      < (ctx->len % SHA512_BLOCK_SIZE));
@@ -388,19 +453,8 @@ void sha512_final(sha512_ctx *ctx, unsigned char *digest)
 
     sha512_transf(ctx, ctx->block, block_nb);
 
-#ifndef UNROLL_LOOPS
     for (i = 0 ; i < 8; i++) {
         UNPACK64(ctx->h[i], &digest[i << 3]);
     }
-#else
-    UNPACK64(ctx->h[0], &digest[ 0]);
-    UNPACK64(ctx->h[1], &digest[ 8]);
-    UNPACK64(ctx->h[2], &digest[16]);
-    UNPACK64(ctx->h[3], &digest[24]);
-    UNPACK64(ctx->h[4], &digest[32]);
-    UNPACK64(ctx->h[5], &digest[40]);
-    UNPACK64(ctx->h[6], &digest[48]);
-    UNPACK64(ctx->h[7], &digest[56]);
-#endif /* !UNROLL_LOOPS */
 }
 
@@ -36,6 +36,10 @@
  * - Kept only sha512 operations
  * - main replaced by hmacstr(string to be encoded, key string)
  *
+ * Modified in 2018:
+ * - unrolled compression kernel, reference loop as fallback
+ * - sha512_selftest() with FIPS 180-2 test vectors
+ *
  */
 
 
@@ -69,5 +73,10 @@ void sha512_final(sha512_ctx *ctx, unsigned char *digest);
 void sha512(const unsigned char *message, unsigned int len,
             unsigned char *digest);
 
+/*
+ * Check the selected kernel against FIPS 180-2 vectors, 0 if it matches.
+ */
+int sha512_selftest(void);
+
 #endif /* !SHA2_H */
 
@@ -29,6 +29,7 @@
 #include <getopt.h>
 #include <errno.h>
 #include <ctype.h>
+#include <unistd.h>
 
 #include "lib/jansson/src/jansson.h"
 #include "lib/hmac/hmac_sha2.h"
@@ -37,6 +38,15 @@
 #include "bittrex.h"
 #include "account.h"
 #include "bot.h"
+#include "fixed.h"
+#include "snapshot.h"
+#include "export.h"
+#include "tape.h"
+#include "daemon.h"
+#include "batch.h"
+#include "format.h"
+#include "strategy.h"
+#include "optimize.h"
 
 static void print_help(char *arg) {
 	if (!arg || strlen(arg) == 0) {
@@ -47,6 +57,16 @@ static void print_help(char *arg) {
 		printf(" -h, --help\tprint help\n");
 		printf(" -s, --stats\tprint stats only\n");
 		printf(" -b, --bot\ttrading bot, requires -a\n");
+		printf(" --snapshot\tbot warm state file, reloaded at startup\n");
+		printf(" --archive\tdirectory where fetched candles are archived\n");
+		printf(" --strategy\tbot strategy name[:params], repeat to paper trade others\n");
+		printf(" --hedge\tduplicate slow ticker and order status requests (bot)\n");
+		printf(" --cache\tkeep public replies (markets, currencies, summaries) in ~/.cache\n");
+		printf(" --daemon\tstay running and serve commands on a unix socket\n");
+		printf(" --socket=path\tsend the command to the daemon listening on path\n");
+		printf(" --batch\trun the command lines of a file (- for stdin)\n");
+		printf(" --jobs\tcommands of a batch run at once (default 8)\n");
+		printf(" --format\toutput format: text (default), jsonl, csv or tsv\n");
 		printf("Public API calls:\n");
 		printf(" ./bittrex [--getmarkets|--getcurrencies|--getmarketsummaries]\n");
 		printf(" ./bittrex --market=marketname --getticker||--getmarketsummary||--getmarkethistory\n");
@@ -54,6 +74,10 @@ static void print_help(char *arg) {
 		printf(" ./bittrex --market=marketname --getticks oneMin|fiveMin|thirtyMin|Hour\n");
 		printf(" ./bittrex --market=marketname --getema oneMin|fiveMin|thirtyMin|Hour,period\n");
 		printf(" ./bittrex --market=marketname --getrsi oneMin|fiveMin|thirtyMin|Hour,period\n");
+		printf(" ./bittrex --archive=dir --market=marketname --volumeonrange start_date,end_date\n");
+		printf(" ./bittrex --archive=dir --market=marketname --collect seconds\n");
+		printf(" ./bittrex --archive=dir [--market=marketname] [--samples=n] --optimize name:lo-hi/step,...\n");
+		printf(" ./bittrex --archive=dir [--market=marketname] --export oneMin|fiveMin|thirtyMin|Hour,csv|bin,outdir\n");
 		printf("Market API Calls:\n");
 		printf(" ./bittrex --apikeyfile=path --market=marketname --buylimit|--selllimit|--tradebuy|--tradesell quantity,rate\n");
 		printf(" ./bittrex --apikeyfile=path --market=marketname --cancel orderuuid\n");
@@ -87,6 +111,40 @@ static void print_help(char *arg) {
 		printf("getorderbook type invalid, use : both, buy or sell\n");
 		printf("ex: ./bittrex -m BTC-XVG --getorderbook sell\n");
 	}
+	if (strcmp(arg, "--volumeonrange") == 0) {
+		printf("volumeonrange requires start and end dates (UTC)\n");
+		printf("ex: ./bittrex --archive=/var/lib/bittrex -m BTC-XVG --volumeonrange 2018-01-01T00:00:00,2018-01-02T00:00:00\n");
+	}
+	if (strcmp(arg, "--collect") == 0) {
+		printf("collect requires a poll interval in seconds\n");
+	}
+	if (strcmp(arg, "--format") == 0) {
+		printf("format is one of text, jsonl, csv, tsv\n");
+		printf("ex: ./bittrex --format=csv --getmarketsummaries\n");
+	}
+	if (strcmp(arg, "--strategy") == 0) {
+		const struct strategy **s;
+
+		printf("strategy requires name[:params], the first one trades, others are paper traded\n");
+		for (s = strategies; *s; s++)
+			printf(" %s:%s\n", (*s)->name, (*s)->usage);
+		printf("ex: ./bittrex -a key -b --strategy=rsi:30,60,70,1 --strategy=rsi:25,60,75,2\n");
+	}
+	if (strcmp(arg, "--optimize") == 0) {
+		printf("optimize requires a strategy and its parameters, each one a value or lo-hi/step\n");
+		printf("ex: ./bittrex --archive=/var/lib/bittrex --optimize rsi:20-35/5,60,65-80/5,0.5-2/0.5\n");
+	}
+	if (strcmp(arg, "--samples") == 0) {
+		printf("samples requires a number of random parameter sets\n");
+	}
+	if (strcmp(arg, "--jobs") == 0) {
+		printf("jobs requires a number of commands run at once\n");
+		printf("ex: ./bittrex --jobs=4 --batch=commands.txt\n");
+	}
+	if (strcmp(arg, "--export") == 0) {
+		printf("export requires tick interval, format (csv or bin) and output directory\n");
+		printf("ex: ./bittrex --archive=/var/lib/bittrex --export Hour,csv,/tmp\n");
+	}
 	exit(EINVAL);
 }
 
@@ -133,13 +191,16 @@ static int nbc(char *s) {
 	return nb;
 }
 
-int main(int argc, char *argv[]) {
-	struct bittrex_info *bi;
+/*
+ * One command line on bi, returns the exit status.
+ * Called once by main, or by each daemon child on the warm bi.
+ */
+static int run(struct bittrex_info *bi, int argc, char *argv[]) {
 	struct market *market = NULL;
 	struct ticker *tick = NULL;
 	struct tick **ticks = NULL;
 	struct currency *c = NULL;
-	struct api *api = NULL;
+	struct api *api = bi->api;
 	struct user_order *o = NULL, **orders = NULL;
 	struct balance **balances = NULL, *b = NULL;
 	struct deposit **d = NULL;
@@ -148,15 +209,25 @@ int main(int argc, char *argv[]) {
 	char *tickinterval = NULL, *uuid = NULL, *destaddress = NULL;
 	char *da = NULL;
 	char *paymentid = NULL;
-	char *interval = NULL;
+	char *interval = NULL, *outdir = NULL;
+	char *marketname = NULL, *coin = NULL, *daemonpath = NULL, *batchpath = NULL;
 	char opt, key[33], secret[33];
-	char buf[255], buf2[32];
-	double quantity = -1, rate = -1;
+	char buf[255], buf2[32], buf3[255];
+	double quantity = -1;
+	fixed_t tradeqty = -1, rate = -1;
 	double *ma;
-	int period = 0;
+	int period = 0, exportformat = EXPORT_CSV, nbexported;
+	int jobs = BATCH_JOBS, rc;
+	int samples = 0;
+	struct optimize_space space;
 	int opt_index;
 	int api_required = 0, market_required = 0, currency_required = 0;
-	static int action_flag = -1;
+	int archive_required = 0;
+	int64_t start = 0, end = 0;
+	struct tape_volume tv;
+	int action_flag = -1;
+	static char *strategyspecs[STRATEGY_MAX + 1];
+	int nbstrategies = 0;
 
 	static struct option long_options[] = {
 		/* general options */
@@ -168,6 +239,15 @@ int main(int argc, char *argv[]) {
 
 		/* bot mode, api key required */
 		{"bot",			no_argument,		0, 'b'}, // bot mode
+		{"snapshot",		required_argument,	0, 14 }, // bot warm state file
+		{"archive",		required_argument,	0, 15 }, // candle archive directory
+		{"strategy",		required_argument,	0, 26 }, // bot strategy, repeatable
+		{"hedge",		no_argument,		0, 19 }, // hedged getticker/getorder
+		{"cache",		no_argument,		0, 20 }, // disk cache of public replies
+		{"daemon",		required_argument,	0, 21 }, // serve requests on unix socket
+		{"batch",		required_argument,	0, 23 }, // command lines file
+		{"jobs",		required_argument,	0, 24 }, // batch parallelism
+		{"format",		required_argument,	0, 25 }, // output format
 
 		/* public API */
 		{"getmarkets",		no_argument,		0,  0 },
@@ -201,14 +281,22 @@ int main(int argc, char *argv[]) {
 		{"getema",		required_argument,	0,  13 }, // exponantial moving average
 		{"getrsi",		required_argument,	0,  13 }, // RSI
 
+		/* export */
+		{"export",		required_argument,	0,  16 }, // interval, format, output dir
+
+		/* strategy parameters backtest */
+		{"optimize",		required_argument,	0,  27 }, // strategy and parameter ranges
+		{"samples",		required_argument,	0,  28 }, // random search
+
+		/* trade tape */
+		{"volumeonrange",	required_argument,	0,  17 }, // start date, end date
+		{"collect",		required_argument,	0,  18 }, // poll interval (s)
+
 		/* help */
 		{"help",		no_argument,		0, 'h'},
 		{0,           0,                 0,  0   }
 	};
 
-	// init bittrex_info struct
-	bi = bittrex_info();
-
 	/*
 	 * option rules
 	 * Here we set some flags if specific options are required.
@@ -255,8 +343,9 @@ int main(int argc, char *argv[]) {
 				fprintf(stderr, "(rest of the world style)\n");
 				exit(EINVAL);
 			}
-			rc = sscanf(optarg, "%lf,%lf", &quantity, &rate);
-			if (rc !=  2 || quantity < 0 || rate < 0) {
+			rc = sscanf(optarg, "%254[^,],%254s", buf, buf3);
+			if (rc !=  2 || fixed_parse(buf, &tradeqty) || fixed_parse(buf3, &rate) ||
+			    tradeqty < 0 || rate < 0) {
 				fprintf(stderr, "Invalid Quantity or Rate specified\n");
 				print_help(call);
 			}
@@ -330,6 +419,46 @@ int main(int argc, char *argv[]) {
 					print_help(call);
 			}
 			break;
+		case 16: //export
+			call = argv[optind-2];
+			action_flag = 16;
+			if (sscanf(optarg, "%254[^,],%31[^,],%254[^,]", buf, buf2, buf3) != 3 ||
+			    !tickInterval_is_valid(buf) ||
+			    (strcmp(buf2, "csv") != 0 && strcmp(buf2, "bin") != 0))
+				print_help(call);
+			interval = malloc(strlen(buf) + 1);
+			strcpy(interval, buf);
+			exportformat = strcmp(buf2, "bin") == 0 ? EXPORT_BIN : EXPORT_CSV;
+			outdir = malloc(strlen(buf3) + 1);
+			strcpy(outdir, buf3);
+			break;
+		case 17: //volumeonrange
+			market_required = archive_required = 1;
+			call = argv[optind-2];
+			action_flag = 17;
+			if (sscanf(optarg, "%254[^,],%254[^,]", buf, buf3) != 2 ||
+			    !(start = timestamp_ms(buf)) || !(end = timestamp_ms(buf3)))
+				print_help(call);
+			break;
+		case 18: //collect
+			market_required = archive_required = 1;
+			call = argv[optind-2];
+			action_flag = 18;
+			if (sscanf(optarg, "%d", &period) != 1 || period <= 0)
+				print_help(call);
+			break;
+		case 27: //optimize
+			archive_required = 1;
+			call = argv[optind-2];
+			action_flag = 27;
+			if (optimize_parse(&space, optarg) < 0)
+				print_help(call);
+			break;
+		case 28: //random search
+			if (sscanf(optarg, "%d", &samples) != 1 || samples < 1 ||
+			    samples > OPTIMIZE_MAXSETS)
+				print_help("--samples");
+			break;
 		case 'a':
 			apikey = optarg;
 			file = fopen(apikey, "r");
@@ -352,26 +481,51 @@ int main(int argc, char *argv[]) {
 			bi->api = api;
 			break;
 		case 'm':
-			getmarkets(bi);
-			market = getmarket(bi->markets, optarg);
-			if (!market) {
-				fprintf(stderr, "Invalid market specified: %s\n", optarg);
-				exit(EINVAL);
-			}
+			marketname = optarg;
 			break;
 		case 'c':
-			bi->currencies = getcurrencies(bi);
-			c = getcurrency(bi->currencies, optarg);
-			if (!c) {
-				fprintf(stderr, "Invalid currency specified: %s\n", optarg);
-				exit(EINVAL);
-			}
+			coin = optarg;
 			break;
 		case 'b': //bot mode
 			api_required = 1;
 			action_flag = 12;
 			call = argv[optind-1];
 			break;
+		case 14: //snapshot file
+			bi->snapshotpath = optarg;
+			break;
+		case 15: //candle archive
+			bi->archivedir = optarg;
+			break;
+		case 19: //hedged requests
+			bi->hedge.enabled = 1;
+			break;
+		case 20: //disk cache
+			cache_disk(&(bi->cache), NULL);
+			break;
+		case 21: //daemon
+			action_flag = 21;
+			daemonpath = optarg;
+			break;
+		case 23: //batch
+			action_flag = 23;
+			batchpath = optarg;
+			break;
+		case 24: //batch parallelism
+			if (sscanf(optarg, "%d", &jobs) != 1 || jobs < 1)
+				print_help("--jobs");
+			break;
+		case 25: //output format
+			if ((output_format = format_parse(optarg)) < 0)
+				print_help("--format");
+			break;
+		case 26: //bot strategies
+			if (nbstrategies >= STRATEGY_MAX || strategy_check(optarg) < 0)
+				print_help("--strategy");
+			strategyspecs[nbstrategies++] = optarg;
+			strategyspecs[nbstrategies] = NULL;
+			bi->strategies = strategyspecs;
+			break;
 		case 's': //statistics
 			break;
 		case 'h':
@@ -388,6 +542,29 @@ int main(int argc, char *argv[]) {
 
 	}
 
+	/*
+	 * Market and currency once all options are known (--cache),
+	 * markets and currencies are fetched once.
+	 */
+	if (marketname) {
+		if (!bi->markets)
+			getmarkets(bi);
+		market = getmarket(bi->markets, marketname);
+		if (!market) {
+			fprintf(stderr, "Invalid market specified: %s\n", marketname);
+			exit(EINVAL);
+		}
+	}
+	if (coin) {
+		if (!bi->currencies)
+			bi->currencies = getcurrencies(bi);
+		c = getcurrency(bi->currencies, coin);
+		if (!c) {
+			fprintf(stderr, "Invalid currency specified: %s\n", coin);
+			exit(EINVAL);
+		}
+	}
+
 	/*
 	 * Check required arguments flags
 	 */
@@ -399,6 +576,10 @@ int main(int argc, char *argv[]) {
 		arg_required(call, "market (-m || --market)");
 	}
 
+	if (archive_required && !bi->archivedir) {
+		arg_required(call, "archive directory (--archive)");
+	}
+
 	if (currency_required && !c) {
 		arg_required(call, "currency (-c || --currency)");
 	}
@@ -409,12 +590,14 @@ int main(int argc, char *argv[]) {
 	switch (action_flag) {
 	case 0:
 		if (strcmp(call, "--getmarkets") == 0) {
-			getmarkets(bi);
+			if (!bi->markets)
+				getmarkets(bi);
 			printmarkets(bi->markets);
 		}
 		if (strcmp(call, "--getcurrencies") == 0) {
+			if (!bi->currencies)
 				bi->currencies = getcurrencies(bi);
-				printcurrencies(bi->currencies);
+			printcurrencies(bi->currencies);
 		}
 		if (strcmp(call, "--getmarketsummaries") == 0) {
 			getmarketsummaries(bi);
@@ -440,18 +623,19 @@ int main(int argc, char *argv[]) {
 		}
 		break;
 	case 2:	/* getticks */
-		printf("Newest to oldest\n");
+		if (output_format == FORMAT_TEXT)
+			printf("Newest to oldest\n");
 		printticks((ticks = getticks(bi, market, tickinterval, 100, ASCENDING)));
 		free_ticks(ticks);
 		break;
 	case 3:	/* trades */
 		if (strcmp(call, "--buylimit") == 0) {
 			// API V1.1
-			buylimit(bi, market, quantity, rate);
+			buylimit(bi, market, tradeqty, rate);
 		}
 		if (strcmp(call, "--selllimit") == 0) {
 			//API V1.1
-			selllimit(bi, market, quantity, rate);
+			selllimit(bi, market, tradeqty, rate);
 		}
 		if (strcmp(call, "--tradebuy") == 0) {
 			/* fixme API V2*/
@@ -475,7 +659,7 @@ int main(int argc, char *argv[]) {
 			free_balance(b);
 		}
 		if (strcmp(call, "--getdepositaddress") == 0) {
-			printf("Currency %s deposit address: %s\n", c->coin, (da = getdepositaddress(bi, c, api)));
+			printdepositaddress(c, (da = getdepositaddress(bi, c, api)));
 			free(da);
 		}
 		break;
@@ -530,13 +714,19 @@ int main(int argc, char *argv[]) {
 		free_user_orders(orders);
 		break;
 	case 12: /* bot */
-		getmarkets(bi);
+		/* warm start: markets, currencies and indicators from snapshot */
+		if (!snapshot_load(bi, bi->snapshotpath)) {
+			if (!bi->markets)
+				getmarkets(bi);
+			if (!bi->currencies)
+				bi->currencies = getcurrencies(bi);
+		}
 		if (!conn_init(bi)) {
 			fprintf(stderr, "Connection to MySQL failed\n. Exiting.\n");
 			exit(EPERM);
 		}
+		/* summaries are always refreshed */
 		getmarketsummaries(bi);
-		bi->currencies = getcurrencies(bi);
 		bot(bi);
 		break;
 	case 13: /* EMA or RSI */
@@ -549,12 +739,75 @@ int main(int argc, char *argv[]) {
 			printf("%.4f\n", rsi_mma_interval_period(bi, market, interval, period));
 		free(interval);
 		break;
+	case 16: /* export */
+		if (!market && !bi->markets)
+			getmarkets(bi);
+		nbexported = export_markets(bi, market, interval, exportformat, outdir);
+		printf("Exported %d market(s) to %s\n", nbexported, outdir);
+		free(interval);
+		free(outdir);
+		if (nbexported == 0) {
+			return ENOENT;
+		}
+		break;
+	case 27: /* optimize */
+		if (!market && !bi->markets)
+			getmarkets(bi);
+		if (optimize(bi, market, &space, samples) < 0)
+			return ENOENT;
+		break;
+	case 17: /* volumeonrange */
+		/* merge last fills first */
+		if (getmarkethistory(bi, market) >= 0)
+			tape_merge(bi->archivedir, market);
+		if (tape_volumeonrange(bi->archivedir, market->marketname, start, end, &tv) < 0) {
+			fprintf(stderr, "No trade tape for %s\n", market->marketname);
+			return ENOENT;
+		}
+		printtapevolume(&tv);
+		break;
+	case 18: /* collect trade tape */
+		while (1) {
+			if (getmarkethistory(bi, market) >= 0)
+				printf("%s: %d fills merged\n", market->marketname,
+				       tape_merge(bi->archivedir, market));
+			sleep(period);
+		}
+		break;
+	case 21: /* daemon */
+		return daemon_serve(bi, daemonpath, run);
+	case 23: /* batch */
+		if (strcmp(batchpath, "-") == 0)
+			return batch_run(bi, stdin, jobs, run);
+		if (!(file = fopen(batchpath, "r"))) {
+			fprintf(stderr, "File %s could not be opened\n", batchpath);
+			return ENOENT;
+		}
+		rc = batch_run(bi, file, jobs, run);
+		fclose(file);
+		return rc;
 	default:
 		printf("No command specified.\n./bittrex --help for help\n");
 		return 0;
 	}
 
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	struct bittrex_info *bi;
+	int i, rc;
+
+	/* client mode: the daemon runs the same options */
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--socket=", strlen("--socket=")) == 0)
+			return daemon_client(argv[i] + strlen("--socket="), argc, argv);
+	}
+
+	// init bittrex_info struct
+	bi = bittrex_info();
+	rc = run(bi, argc, argv);
 	free_bi(bi);
 
-	return 0;
+	return rc;
 }
@@ -33,6 +33,12 @@
 #include "bittrex.h"
 #include "trade.h"
 #include "account.h"
+#include "indicators.h"
+#include "archive.h"
+#include "arena.h"
+#include "intern.h"
+#include "url.h"
+#include "format.h"
 
 int compare_market_by_volume(const void *a, const void *b) {
 	struct market **ma = (struct market **)a;
@@ -50,14 +56,7 @@ int compare_market_by_volume(const void *a, const void *b) {
 }
 
 int market_exists(struct market **mtab, char *marketname) {
-	struct market **tmp = mtab;
-
-	while (*tmp) {
-		if (strcmp((*tmp)->marketname, marketname) == 0)
-			return 0;
-		tmp++;
-	}
-	return -1;
+	return getmarket(mtab, marketname) ? 0 : -1;
 }
 
 struct market *new_market() {
@@ -69,6 +68,7 @@ struct market *new_market() {
 	m->mh = NULL;
 	m->ms = NULL;
 	m->ob = NULL;
+	m->market_id = -1;
 	m->marketname = NULL;
 	m->marketcurrency = NULL;
 	m->marketcurrencylong = NULL;
@@ -108,19 +108,20 @@ int getmarkets(struct bittrex_info *bi) {
 		m = new_market();
 
 		market_name = json_object_get(raw, "MarketName");
-		m->marketname = json_string_get(m->marketname, market_name);
+		m->market_id = intern(json_string_value(market_name));
+		m->marketname = intern_name(m->market_id);
 
 		tmp = json_object_get(raw, "MarketCurrency");
-		m->marketcurrency = json_string_get(m->marketcurrency, tmp);
+		m->marketcurrency = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "MarketCurrencyLong");
-		m->marketcurrencylong = json_string_get(m->marketcurrencylong, tmp);
+		m->marketcurrencylong = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "BaseCurrency");
-		m->basecurrency = json_string_get(m->basecurrency, tmp);
+		m->basecurrency = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "BaseCurrencyLong");
-		m->basecurrencylong = json_string_get(m->basecurrencylong, tmp);
+		m->basecurrencylong = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "IsActive");
 		m->isactive = json_is_true(tmp);
@@ -138,13 +139,15 @@ int getmarkets(struct bittrex_info *bi) {
 
 struct market *getmarket(struct market **markets, char *marketname) {
 	struct market **tmp;
+	int id;
 
-	if (!markets || !marketname)
+	/* names never interned cannot match */
+	if (!markets || (id = intern_lookup(marketname)) < 0)
 		return NULL;
 	tmp = markets;
 
 	while (tmp && *tmp) {
-		if (strcmp((*tmp)->marketname, marketname) == 0)
+		if ((*tmp)->market_id == id)
 			return *tmp;
 		tmp++;
 	}
@@ -153,6 +156,7 @@ struct market *getmarket(struct market **markets, char *marketname) {
 
 struct ticker *getticker(struct bittrex_info *bi, struct market *m) {
 	json_t *root, *result;
+	struct url u;
 	char *url;
 	struct ticker *ticker;
 
@@ -161,12 +165,13 @@ struct ticker *getticker(struct bittrex_info *bi, struct market *m) {
 		return NULL;
 	}
 
-	url = malloc((strlen(GETTICKER)+strlen(m->marketname)+1)*sizeof(char));
-	url[0]='\0';
-	url = strcat(url, GETTICKER);
-	url = strcat(url, m->marketname);
+	url_init(&u, GETTICKER);
+	url_value(&u, m->marketname);
+	if (!(url = url_str(&u)))
+		return NULL;
 
-	root = api_call(bi, url, GETTICKER);
+	/* same public URL for the hedge */
+	root = api_call_hedged(bi, url, NULL, url, NULL, GETTICKER);
 	if (!root)
 		return NULL;
 	result = json_object_get(root,"result");
@@ -177,7 +182,6 @@ struct ticker *getticker(struct bittrex_info *bi, struct market *m) {
 	ticker->last = json_real_value(json_object_get(result, "Last"));
 
 	json_decref(root);
-	free(url);
 
 	return ticker;
 }
@@ -193,22 +197,22 @@ struct tick **getticks(struct bittrex_info *bi,
 		       int nbtick,
 		       int sort) {
 	json_t *root, *result, *raw;
+	struct url u;
 	char *url;
 	int size, i, offset = 0;
 	struct tick **ticks, *tick;
+	struct arena *a;
 
 	if (!m || !m->marketname || (sort != ASCENDING && sort != DESCENDING)) {
 		fprintf(stderr, "getticks: invalid parameter.\n");
 		return NULL;
 	}
 
-	url = malloc((strlen(GETTICKS)+strlen(m->marketname)+
-		      strlen(interval)+strlen("&tickInterval=")+1)*sizeof(char));
-	url[0]='\0';
-	url = strcat(url, GETTICKS);
-	url = strcat(url, m->marketname);
-	url = strcat(url, "&tickInterval=");
-	url = strcat(url, interval);
+	url_init(&u, GETTICKS);
+	url_value(&u, m->marketname);
+	url_param(&u, "tickInterval", interval);
+	if (!(url = url_str(&u)))
+		return NULL;
 
 	root = api_call(bi, url, GETTICKS);
 	if (!root)
@@ -227,7 +231,9 @@ struct tick **getticks(struct bittrex_info *bi,
 		m->lastnbticks = nbtick;
 		offset = size - nbtick;
 	}
-	ticks = malloc((nbtick+1) * sizeof(struct tick*));
+	/* one region for the whole reply, see free_ticks() */
+	a = new_arena((nbtick+2) * sizeof(struct tick*) + nbtick * sizeof(struct tick) + 1024);
+	ticks = arena_list(a, nbtick);
 
 
 	for (i=0; i < size && i < nbtick; i++) {
@@ -235,31 +241,34 @@ struct tick **getticks(struct bittrex_info *bi,
 			raw = json_array_get(result, size-i-1);
 		if (sort == DESCENDING)
 			raw = json_array_get(result, i+offset);
-		tick = malloc(sizeof(struct tick));
-		tick->open = json_real_value(json_object_get(raw, "C"));
+		tick = arena_alloc(a, sizeof(struct tick));
+		tick->open = json_real_value(json_object_get(raw, "O"));
 		tick->high = json_real_value(json_object_get(raw, "H"));
 		tick->low = json_real_value(json_object_get(raw, "L"));
 		tick->close = json_real_value(json_object_get(raw, "C"));
 		tick->volume = json_real_value(json_object_get(raw, "V"));
 		tick->btcval = json_real_value(json_object_get(raw, "BV"));
-		tick->timestamp = json_string_get(tick->timestamp, json_object_get(raw, "T"));
+		tick->timestamp = json_timestamp_get(json_object_get(raw, "T"));
 		ticks[i] = tick;
 	}
 	ticks[i] = NULL;
 
+	if (bi->archivedir)
+		archive_ticks(bi->archivedir, m, interval, ticks);
+
 	json_decref(root);
-	free(url);
 
 	return ticks;
 }
 
 struct currency *getcurrency(struct currency **currency, char *coin) {
 	struct currency **tmp;
+	int id;
 
-	if (currency && *currency && coin) {
+	if (currency && *currency && (id = intern_lookup(coin)) >= 0) {
 		tmp = currency;
 		while (*tmp) {
-			if (strcmp((*tmp)->coin, coin) == 0)
+			if ((*tmp)->currency_id == id)
 				return (*tmp);
 			tmp++;
 		}
@@ -289,10 +298,11 @@ struct currency **getcurrencies(struct bittrex_info *bi) {
 		c = malloc(sizeof(struct currency));
 
 		tmp = json_object_get(raw, "Currency");
-		c->coin = json_string_get(c->coin, tmp);
+		c->currency_id = intern(json_string_value(tmp));
+		c->coin = intern_name(c->currency_id);
 
 		tmp = json_object_get(raw, "CurrencyLong");
-		c->currencylong = json_string_get(c->currencylong, tmp);
+		c->currencylong = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "MinConfirmation");
 		c->minconfirmation = json_integer_value(tmp);
@@ -304,7 +314,7 @@ struct currency **getcurrencies(struct bittrex_info *bi) {
 		c->isactive = json_is_true(tmp);
 
 		tmp = json_object_get(raw, "CoinType");
-		c->cointype = json_string_get(c->cointype, tmp);
+		c->cointype = intern_string(json_string_value(tmp));
 
 		tmp = json_object_get(raw, "BaseAddress");
 		c->baseaddress = json_string_get(c->baseaddress, tmp);
@@ -322,7 +332,6 @@ struct currency **getcurrencies(struct bittrex_info *bi) {
  */
 int getmarketsummaries(struct bittrex_info *bi){
 	struct market *m = NULL;
-	struct tm *ctm = NULL;
 	int i = 0;
 	json_t *result, *raw, *market_name, *root, *tmp;
 
@@ -344,30 +353,11 @@ int getmarketsummaries(struct bittrex_info *bi){
 		m = getmarket(bi->markets,(char*)json_string_value(market_name));
 
 		if (m) {
-			if (!m->ms) {
+			if (!m->ms)
 				m->ms = malloc(sizeof(struct market_summary));
-				m->ms->timestamp = NULL;
-				m->ms->ctm = NULL;
-			}
 
 			tmp = json_object_get(raw, "TimeStamp");
-
-			/* free if update only*/
-			if (m->ms->timestamp)
-				free(m->ms->timestamp);
-
-			m->ms->timestamp = malloc(strlen(json_string_value(tmp))+1);
-			m->ms->timestamp = strcpy(m->ms->timestamp, json_string_value(tmp));
-			ctm = malloc(sizeof(struct tm));
-			sscanf(json_string_value(tmp), "%d-%d-%dT%d:%d:%d", &ctm->tm_year,
-			       &ctm->tm_mon, &ctm->tm_mday, &ctm->tm_hour,
-			       &ctm->tm_min, &ctm->tm_sec);
-
-			/* free if update only*/
-			if (m->ms->ctm)
-				free(m->ms->ctm);
-
-			m->ms->ctm = ctm;
+			m->ms->timestamp = json_timestamp_get(tmp);
 
 			tmp = json_object_get(raw, "Last");
 			m->ms->last = json_real_value(tmp);
@@ -408,23 +398,24 @@ int getmarketsummaries(struct bittrex_info *bi){
 }
 
 /*
- * get market history (last 100)
+ * get market history (last 100), merged by Id
  */
 int getmarkethistory(struct bittrex_info *bi, struct market *m) {
 	json_t *root, *result, *tmp, *raw;
-	int size, i;
+	struct market_history *f;
+	int size, i, nbnew, id;
+	struct url u;
 	char *url;
-	struct tm  *ctm;
 
 	if (!m || !m->marketname) {
 		fprintf(stderr, "getmarkethistory: invalid market specified.\n");
 		return -1;
 	}
 
-	url = malloc((strlen(GETMARKETHISTORY)+strlen(m->marketname)+1)*sizeof(char));
-	url[0]='\0';
-	url = strcat(url, GETMARKETHISTORY);
-	url = strcat(url, m->marketname);
+	url_init(&u, GETMARKETHISTORY);
+	url_value(&u, m->marketname);
+	if (!(url = url_str(&u)))
+		return -1;
 
 	root = api_call(bi, url, GETMARKETHISTORY);
 	if (!root)
@@ -433,83 +424,93 @@ int getmarkethistory(struct bittrex_info *bi, struct market *m) {
 	result = json_object_get(root,"result");
 	if (!json_is_array(result)) {
 		fprintf(stderr, "getmarkethistory: API returned not an array");
+		json_decref(root);
 		return -1;
 	}
 	size = json_array_size(result);
 	/* alloc only first call */
-	if (!m->mh) {
-		m->mh = malloc((size+1) * sizeof(struct market_history*));
-		for (i=0; i < size; i++) {
-			m->mh[i] = malloc(sizeof(struct market_history));
-			m->mh[i]->timestamp = NULL;
-			m->mh[i]->ctm = NULL;
-			m->mh[i]->filltype = NULL;
-			m->mh[i]->ordertype = NULL;
-		}
+	if (!m->mh && !(m->mh = calloc(1, sizeof(struct market_history_ring)))) {
+		json_decref(root);
+		return -1;
 	}
 
-	for (i=0; i < size; i++) {
-		raw = json_array_get(result, i);
+	/* newest first, stop at the last Id already merged */
+	for (nbnew = 0; nbnew < size; nbnew++) {
+		raw = json_array_get(result, nbnew);
+		id = json_integer_value(json_object_get(raw, "Id"));
+		if (id <= m->mh->lastid)
+			break;
+	}
+	/*
+	 * Whole page is new: fills between the last poll and the oldest
+	 * of this page may be lost (Ids are not contiguous per market).
+	 */
+	if (m->mh->lastid && nbnew == size && size > 0) {
+		m->mh->gaps++;
+		fprintf(stderr, "getmarkethistory: %s possible gap after Id %d (%ld so far)\n",
+			m->marketname, m->mh->lastid, m->mh->gaps);
+	}
 
-		tmp = json_object_get(raw, "Id");
-		m->mh[i]->id = json_number_value(tmp);
+	/* oldest new fill first */
+	for (i = nbnew - 1; i >= 0; i--) {
+		raw = json_array_get(result, i);
+		f = &(m->mh->fills[m->mh->head]);
 
+		f->id = json_integer_value(json_object_get(raw, "Id"));
 
 		tmp = json_object_get(raw, "TimeStamp");
-		/* free old timestamp */
-		if (m->mh[i] && m->mh[i]->timestamp)
-			free(m->mh[i]->timestamp);
-		if (json_string_value(tmp)) {
-			m->mh[i]->timestamp = malloc(strlen(json_string_value(tmp))+1);
-			m->mh[i]->timestamp = strcpy(m->mh[i]->timestamp, json_string_value(tmp));
-			ctm = malloc(sizeof(struct tm));
-			sscanf(json_string_value(tmp), "%d-%d-%dT%d:%d:%d", &ctm->tm_year,
-			       &ctm->tm_mon, &ctm->tm_mday, &ctm->tm_hour,
-			       &ctm->tm_min, &ctm->tm_sec);
-		}
-		/* free if update only*/
-		if (m->mh[i]->ctm)
-			free(m->mh[i]->ctm);
-		m->mh[i]->ctm = ctm;
+		f->timestamp = json_timestamp_get(tmp);
 
 		tmp = json_object_get(raw, "Price");
-		m->mh[i]->price = json_real_value(tmp);
+		f->price = json_real_value(tmp);
 
 		tmp = json_object_get(raw, "Quantity");
-		m->mh[i]->quantity = json_real_value(tmp);
+		f->quantity = json_real_value(tmp);
 
 		tmp = json_object_get(raw, "Total");
-		m->mh[i]->total = json_real_value(tmp);
+		f->total = json_real_value(tmp);
 
+		f->filltype[0] = '\0';
 		tmp = json_object_get(raw, "FillType");
-		m->mh[i]->filltype = json_string_get(m->mh[i]->filltype, tmp);
+		if (json_string_value(tmp))
+			strncat(f->filltype, json_string_value(tmp), sizeof(f->filltype) - 1);
 
+		f->ordertype[0] = '\0';
 		tmp = json_object_get(raw, "OrderType");
-		m->mh[i]->ordertype = json_string_get(m->mh[i]->ordertype, tmp);
+		if (json_string_value(tmp))
+			strncat(f->ordertype, json_string_value(tmp), sizeof(f->ordertype) - 1);
 
+		m->mh->lastid = f->id;
+		m->mh->head = (m->mh->head + 1) % MARKET_HISTORY_SIZE;
+		if (m->mh->count < MARKET_HISTORY_SIZE)
+			m->mh->count++;
 	}
-	m->mh[i] = NULL;
 
 	json_decref(root);
-	free(url);
 
-	return 0;
+	return nbnew;
+}
+
+struct market_history *market_history_get(struct market_history_ring *mh, int i) {
+	if (!mh || i < 0 || i >= mh->count)
+		return NULL;
+	return &(mh->fills[(mh->head - 1 - i + MARKET_HISTORY_SIZE) % MARKET_HISTORY_SIZE]);
 }
 
 int getmarketsummary(struct bittrex_info *bi, struct market *m) {
 	json_t *root, *result, *tmp, *raw;
+	struct url u;
 	char *url;
-	struct tm  *ctm;
 
 	if (!m || !m->marketname) {
 		fprintf(stderr, "getmarketsummary: invalid market specified.\n");
 		return -1;
 	}
 
-	url = malloc((strlen(GETMARKETSUMMARY)+strlen(m->marketname)+1)*sizeof(char));
-	url[0]='\0';
-	url = strcat(url, GETMARKETSUMMARY);
-	url = strcat(url, m->marketname);
+	url_init(&u, GETMARKETSUMMARY);
+	url_value(&u, m->marketname);
+	if (!(url = url_str(&u)))
+		return -1;
 
 	root = api_call(bi, url, GETMARKETSUMMARY);
 	if (!root)
@@ -522,29 +523,12 @@ int getmarketsummary(struct bittrex_info *bi, struct market *m) {
 	}
 
 	/* alloc only first call */
-	if (!m->ms) {
+	if (!m->ms)
 		m->ms = malloc(sizeof(struct market_summary));
-		m->ms->timestamp = NULL;
-		m->ms->ctm = NULL;
-	}
 
 	raw = json_array_get(result, 0);
 	tmp = json_object_get(raw, "TimeStamp");
-
-	if (!m->ms->timestamp)
-		m->ms->timestamp = malloc(strlen(json_string_value(tmp))+1);
-
-	m->ms->timestamp = strcpy(m->ms->timestamp, json_string_value(tmp));
-	ctm = malloc(sizeof(struct tm));
-	sscanf(json_string_value(tmp), "%d-%d-%dT%d:%d:%d", &ctm->tm_year,
-	       &ctm->tm_mon, &ctm->tm_mday, &ctm->tm_hour,
-	       &ctm->tm_min, &ctm->tm_sec);
-
-	/* free if update only*/
-	if (m->ms->ctm)
-		free(m->ms->ctm);
-
-	m->ms->ctm = ctm;
+	m->ms->timestamp = json_timestamp_get(tmp);
 
 	tmp = json_object_get(raw, "Last");
 	m->ms->last = json_real_value(tmp);
@@ -577,19 +561,21 @@ int getmarketsummary(struct bittrex_info *bi, struct market *m) {
 	m->ms->prevday = json_real_value(tmp);
 
 	json_decref(root);
-	free(url);
 
 	return 0;
 }
 
 static struct order **getorders(json_t *tab, int size) {
 	struct order **o;
+	struct arena *a;
 	json_t *tmp, *raw;
 	int i = 0;
 
-	o = malloc((size+1) * sizeof(struct order*));
+	/* one region per side, see free_order_book() */
+	a = new_arena((size+2) * sizeof(struct order*) + size * sizeof(struct order) + 1024);
+	o = arena_list(a, size);
 	for (i=0; i < size; i++) {
-		o[i] = malloc(sizeof(struct order));
+		o[i] = arena_alloc(a, sizeof(struct order));
 		raw = json_array_get(tab, i);
 		tmp = json_object_get(raw, "Quantity");
 		o[i]->quantity = json_real_value(tmp);
@@ -607,6 +593,7 @@ static struct order **getorders(json_t *tab, int size) {
 int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 	json_t *root, *result, *tmp;
 	int size;
+	struct url u;
 	char *url;
 
 	if (!m || !m->marketname) {
@@ -620,15 +607,11 @@ int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 		return -1;
 	}
 
-	url = malloc((strlen(GETORDERBOOK)+
-		      strlen(m->marketname)+
-		      strlen("&type=")+
-		      strlen(type)+1)*sizeof(char));
-	url[0]='\0';
-	url = strcat(url, GETORDERBOOK);
-	url = strcat(url, m->marketname);
-	url = strcat(url, "&type=");
-	url = strcat(url, type);
+	url_init(&u, GETORDERBOOK);
+	url_value(&u, m->marketname);
+	url_param(&u, "type", type);
+	if (!(url = url_str(&u)))
+		return -1;
 	root = api_call(bi, url, GETORDERBOOK);
 	if (!root)
 		return -1;
@@ -647,6 +630,7 @@ int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 			return -1;
 		}
 		size = json_array_size(tmp);
+		free_arena_list(m->ob->buy);
 		m->ob->buy = getorders(tmp, size);
 
 		tmp =  json_object_get(result, "sell");
@@ -655,6 +639,7 @@ int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 			return -1;
 		}
 		size = json_array_size(tmp);
+		free_arena_list(m->ob->sell);
 		m->ob->sell = getorders(tmp, size);
 
 
@@ -665,6 +650,8 @@ int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 			return -1;
 		}
 		size = json_array_size(tmp);
+		free_arena_list(m->ob->buy);
+		free_arena_list(m->ob->sell);
 		if (strcmp("buy", type) == 0) {
 			m->ob->buy = getorders(tmp, size);
 			m->ob->sell = NULL;
@@ -676,32 +663,21 @@ int getorderbook(struct bittrex_info *bi, struct market *m, char *type) {
 	}
 
 	json_decref(root);
-	free(url);
 
 	return 0;
 }
 
 struct tick **reverse_ticks(struct tick **ticks, int size) {
-	struct tick **reverse;
+	struct tick *tmp;
 	int i;
 
-	reverse = malloc((size+1) * sizeof(struct tick*));
-	for (i = 0; i < size; i++) {
-		reverse[i] = malloc(sizeof(struct tick));
-		reverse[i]->open = ticks[size-i-1]->open;
-		reverse[i]->high = ticks[size-i-1]->high;
-		reverse[i]->low = ticks[size-i-1]->low;
-		reverse[i]->close = ticks[size-i-1]->close;
-		reverse[i]->volume = ticks[size-i-1]->volume;
-		reverse[i]->btcval = ticks[size-i-1]->btcval;
-		if (ticks[size-i-1]->timestamp != NULL) {
-			reverse[i]->timestamp = malloc(strlen(ticks[size-i-1]->timestamp)+1);
-			reverse[i]->timestamp = strcpy(reverse[i]->timestamp, ticks[size-i-1]->timestamp);
-		}
+	/* in place, ticks stay in their arena */
+	for (i = 0; i < size / 2; i++) {
+		tmp = ticks[i];
+		ticks[i] = ticks[size-i-1];
+		ticks[size-i-1] = tmp;
 	}
-	reverse[i] = NULL;
-	free_ticks(ticks);
-	return reverse;
+	return ticks;
 }
 
 static double sum(double *array, int index, int size) {
@@ -736,8 +712,8 @@ double rsi_interval_period(struct bittrex_info *bi, struct market *m, char *inte
 	/*
 	 * Wait until API replies
 	 */
-	while (!ticks)
-		ticks = getticks(bi, m, interval, period*2, DESCENDING);
+	while (!(ticks = getticks(bi, m, interval, period*2, DESCENDING)))
+		retry_pause(bi, GETTICKS);
 
 	for (i=1; i < period * 2 ; i++) {
 		gain[i-1] = (ticks[i]->close - ticks[i-1]->close > 0) ?
@@ -780,8 +756,8 @@ double rsi_mma_interval_period(struct bittrex_info *bi, struct market *m, char *
 	/*
 	 * Wait until API replies
 	 */
-	while (!ticks)
-		ticks = getticks(bi, m, interval, 0, DESCENDING);
+	while (!(ticks = getticks(bi, m, interval, 0, DESCENDING)))
+		retry_pause(bi, GETTICKS);
 
 	if (m->lastnbticks == 0)
 		return -1;
@@ -826,135 +802,131 @@ double rsi_mma_interval_period(struct bittrex_info *bi, struct market *m, char *
 	return res;
 }
 
+/*
+ * closes of ticks, oldest first (ticks must be sorted DESCENDING)
+ */
+static double *ticks_close(struct tick **ticks, int size) {
+	double *close;
+	int i;
+
+	if (!(close = malloc(size * sizeof(double))))
+		return NULL;
+	for (i = 0; i < size && ticks[i]; i++)
+		close[i] = ticks[i]->close;
+	for (; i < size; i++)
+		close[i] = close[i-1];
+	return close;
+}
+
 struct tick **getticks_rsi_mma_interval_period(struct bittrex_info *bi,
 						struct market *m,
 						char *interval,
 						int period)
 {
 	struct tick **ticks = NULL;
-	double *gain, *loss;
-	double *avg_gain, *avg_loss;
-	double *rs, *rsi;
-	double weight = 1.0/(period);
-	int i, k = 0;
+	double *close, *rsi;
+	int i;
 
 	/*
 	 * Wait until API replies
 	 */
-	while (!ticks)
-		ticks = getticks(bi, m, interval, 0, DESCENDING);
+	while (!(ticks = getticks(bi, m, interval, 0, DESCENDING)))
+		retry_pause(bi, GETTICKS);
 
 	if (m->lastnbticks == 0)
 		return NULL;
 
-	gain = malloc((m->lastnbticks - 1) * sizeof(double));
-	loss = malloc((m->lastnbticks - 1)* sizeof(double));
-	avg_gain = malloc(m->lastnbticks * sizeof(double));
-	avg_loss = malloc(m->lastnbticks * sizeof(double));
-	rs = malloc(m->lastnbticks * sizeof(double));
+	close = ticks_close(ticks, m->lastnbticks);
 	rsi = malloc(m->lastnbticks * sizeof(double));
-
-	for (i = 1; i < m->lastnbticks; i++) {
-		gain[i-1] = (ticks[i]->close - ticks[i-1]->close > 0) ?
-			ticks[i]->close - ticks[i-1]->close : 0;
-		loss[i-1] = (ticks[i]->close - ticks[i-1]->close < 0) ?
-			-1.0*(ticks[i]->close - ticks[i-1]->close) : 0;
+	if (!close || !rsi) {
+		free(close);
+		free(rsi);
+		return ticks;
 	}
 
-	/* gain[0] and loss[0] are 0 and must be ignored */
-	avg_gain[0] = sum(gain, 1, period) / period;
-	avg_loss[0] = sum(loss, 1, period) / period;
-	rs[0] = avg_gain[0] / avg_loss[0];
-	rsi[0] = 100 - 100/(1.0+rs[0]);
-	for (k = 1; k < (m->lastnbticks-period-1); k++) {
-		avg_gain[k] =  gain[period+k] * weight + avg_gain[k-1]*(1-weight);
-		avg_loss[k] =  loss[period+k] * weight + avg_loss[k-1]*(1-weight);
-		rs[k] = avg_gain[k] / avg_loss[k];
-		rsi[k] = 100 - 100/(1.0+rs[k]);
-		ticks[k+period+1]->rsi_ema = rsi[k];
-		/* printf("tick of %d, %.8f\t%.8f\t\n", k+period+1,ticks[k+period+1]->close, rsi[k]); */
-	}
+	/* first tick is ignored (first gain and loss are 0) */
+	ind_rsi(close + 1, m->lastnbticks - 1, period, rsi);
+	for (i = period + 1; i < m->lastnbticks; i++)
+		ticks[i]->rsi_ema = rsi[i-1];
 
-	free(gain);
-	free(loss);
-	free(avg_gain);
-	free(avg_loss);
-	free(rs);
+	market_indicators(m, close, m->lastnbticks);
+
+	free(close);
 	free(rsi);
 
 	return ticks;
 }
 
-double *ema_interval_period(struct bittrex_info *bi, struct market *m, char *interval, int period) {
+/*
+ * Compute MACD of market from closes (oldest first)
+ */
+void market_indicators(struct market *m, double *close, int size) {
+	double *macd, *signal, *histo;
+
+	if (!m || !close || size < MACD_SLOW + MACD_SIGNAL)
+		return;
+
+	macd = malloc(3 * size * sizeof(double));
+	if (!macd)
+		return;
+	signal = macd + size;
+	histo = signal + size;
+	ind_macd(close, size, MACD_FAST, MACD_SLOW, MACD_SIGNAL, macd, signal, histo);
+
+	pthread_mutex_lock(&(m->indicators_lock));
+	m->macd = macd[size-1];
+	m->macdsignal = signal[size-1];
+	m->macdhisto = histo[size-1];
+	pthread_mutex_unlock(&(m->indicators_lock));
+
+	free(macd);
+}
+
+/*
+ * Moving average of period values, seeded with average of the previous period
+ * ticks. Result[period-1] is the most recent value.
+ */
+static double *ma_interval_period(struct bittrex_info *bi, struct market *m,
+				  char *interval, int period,
+				  void (*ma)(const double *, int, int, double *)) {
 	struct tick **ticks = NULL;
-	double weight = (2.0/(period+1));
-	double *moving_average = NULL;
-	int i, j = 0;
+	double *moving_average = NULL, *close, *tmp;
 
 	if (!(moving_average = malloc(period * sizeof(double))))
 		return NULL;
-	moving_average[0] = 0;
 
 	/*
 	 * Wait until API replies
 	 */
-	while (!ticks)
-		ticks = getticks(bi, m, interval, period*2, DESCENDING);
-
-	/*
-	 * init EMA(0)
-	 */
-	for (i = 1; i <= period ; i++) {
-		moving_average[0] += ticks[i]->close;
-		j++;
+	while (!(ticks = getticks(bi, m, interval, period*2, DESCENDING)))
+		retry_pause(bi, GETTICKS);
+
+	close = ticks_close(ticks, period*2);
+	tmp = malloc(period * 2 * sizeof(double));
+	if (!close || !tmp) {
+		free(close);
+		free(tmp);
+		free(moving_average);
+		free_ticks(ticks);
+		return NULL;
 	}
-	j++;
-	moving_average[0] /= period;
 
-	for (i = 1; i < period; i++) {
-		moving_average[i] = ticks[j]->close * weight + moving_average[i-1]*(1-weight);
-		//printf("tick %d: %.8f(%s), i %d %.8f\n", j, ticks[j]->close, ticks[j]->timestamp, i, moving_average[i]);
-		j++;
-	}
+	/* init MA(0) on ticks 1 to period, then one value per tick */
+	ma(close + 1, period*2 - 1, period, tmp);
+	memcpy(moving_average, tmp + period - 1, period * sizeof(double));
 
+	free(close);
+	free(tmp);
 	free_ticks(ticks);
 	return moving_average;
 }
 
-double *mma_interval_period(struct bittrex_info *bi, struct market *m, char *interval, int period) {
-	struct tick **ticks = NULL;
-	double weight = (1.0/period);
-	double *moving_average = NULL;
-	int i, j = 0;
-
-	if (!(moving_average = malloc(period * sizeof(double))))
-		return NULL;
-	moving_average[0] = 0;
-
-	/*
-	 * Wait until API replies
-	 */
-	while (!ticks)
-		ticks = getticks(bi, m, interval, period*2, DESCENDING);
-
-	/*
-	 * init MMA(0)
-	 */
-	for (i = 1; i <= period; i++) {
-		moving_average[0] += ticks[i]->close;
-		j++;
-	}
-	moving_average[0] /= period;
-	j++;
-
-	for (i = 1; i < period; i++) {
-		moving_average[i] = ticks[j]->close * weight + moving_average[i-1]*(1-weight);
-		//printf("%.8f\n", moving_average[i]);
-		j++;
-	}
+double *ema_interval_period(struct bittrex_info *bi, struct market *m, char *interval, int period) {
+	return ma_interval_period(bi, m, interval, period, ind_ema);
+}
 
-	free_ticks(ticks);
-	return moving_average;
+double *mma_interval_period(struct bittrex_info *bi, struct market *m, char *interval, int period) {
+	return ma_interval_period(bi, m, interval, period, ind_mma);
 }
 
 int pumped(struct bittrex_info *bi, struct market *m) {
@@ -982,50 +954,25 @@ void free_markets(struct market **markets) {
 }
 
 void free_market(struct market *m) {
+	/* names are interned */
 	if (m) {
-		if (m->marketname)
-			free(m->marketname);
 		if (m->mh)
 			free_market_history(m->mh);
 		if (m->ms)
 			free_market_summary(m->ms);
 		if (m->ob)
 			free_order_book(m->ob);
-		if (m->basecurrency)
-			free(m->basecurrency);
-		if (m->basecurrencylong)
-			free(m->basecurrencylong);
-		if (m->marketcurrency)
-			free(m->marketcurrency);
-		if (m->marketcurrencylong)
-			free(m->marketcurrencylong);
 		free(m);
 	}
 }
 
-void free_market_history(struct market_history **mh) {
-	struct market_history **tmp = mh;
-
-	while (tmp && *tmp) {
-		free((*tmp)->timestamp);
-		free((*tmp)->ctm);
-		free((*tmp)->filltype);
-		free((*tmp)->ordertype);
-		free(*tmp);
-		tmp++;
-	}
-	if (mh)
-		free(mh);
+void free_market_history(struct market_history_ring *mh) {
+	free(mh);
 }
 
 void free_market_summary(struct market_summary *ms) {
-	if (ms) {
-		if (ms->timestamp)
-			free(ms->timestamp);
-		if (ms->ctm)
-			free(ms->ctm);
+	if (ms)
 		free(ms);
-	}
 }
 
 void free_currencies(struct currency **currencies) {
@@ -1042,11 +989,6 @@ void free_currencies(struct currency **currencies) {
 void free_currency(struct currency *c) {
 
 	if (c) {
-		free(c->coin);
-		if (c->currencylong)
-			free(c->currencylong);
-		if (c->cointype)
-			free(c->cointype);
 		if (c->baseaddress)
 			free(c->baseaddress);
 		free(c);
@@ -1054,64 +996,79 @@ void free_currency(struct currency *c) {
 }
 
 void free_order_book(struct orderbook *ob) {
-	struct order **tmp;
-
 	if (ob) {
-		if (ob->buy) {
-			tmp = ob->buy;
-			while (tmp && *tmp) {
-				free(*tmp);
-				tmp++;
-			}
-			free(ob->buy);
-		}
-		if (ob->sell) {
-			tmp = ob->sell;
-			while (tmp && *tmp) {
-				free(*tmp);
-				tmp++;
-			}
-			free(ob->sell);
-		}
+		free_arena_list(ob->buy);
+		free_arena_list(ob->sell);
 		free(ob);
 	}
 }
 
 void free_ticks(struct tick **t) {
-	struct tick **tmp = t;
-
-	while (tmp && *tmp) {
-		free((*tmp)->timestamp);
-		free(*tmp);
-		tmp++;
-	}
-	free(t);
+	/* allocated in one arena by getticks() */
+	free_arena_list(t);
 }
 
 /*
  * Print Functions
+ * --format other than text: one record per item, see format.h
  */
 void printmarkethistory(struct market *m){
-	struct market_history **tmp;
+	struct market_history *f;
+	struct fmt out;
+	char ts[32];
+	int i;
 
+	if (m && m->mh && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (i = 0; (f = market_history_get(m->mh, i)); i++) {
+			fmt_begin(&out);
+			fmt_int(&out, "Id", f->id);
+			fmt_time(&out, "TimeStamp", f->timestamp);
+			fmt_real(&out, "Quantity", f->quantity);
+			fmt_real(&out, "Price", f->price);
+			fmt_real(&out, "Total", f->total);
+			fmt_str(&out, "FillType", f->filltype);
+			fmt_str(&out, "OrderType", f->ordertype);
+			fmt_end(&out);
+		}
+		fmt_flush(&out);
+		return;
+	}
 	if (m && m->mh) {
-		tmp = m->mh;
-		while (*tmp) {
-			printf("Id:\t\t%d\n", (*tmp)->id);
-			printf("TimeStamp:\t%s\n", (*tmp)->timestamp);
-			printf("Quantity:\t%.8f\n", (*tmp)->quantity);
-			printf("Price:\t\t%.8f\n", (*tmp)->price);
-			printf("Total:\t\t%.8f\n", (*tmp)->total);
-			printf("FillType:\t%s\n", (*tmp)->filltype);
-			printf("OrderType:\t%s\n\n", (*tmp)->ordertype);
-			tmp++;
+		for (i = 0; (f = market_history_get(m->mh, i)); i++) {
+			printf("Id:\t\t%d\n", f->id);
+			printf("TimeStamp:\t%s\n", timestamp_str(f->timestamp, ts, sizeof(ts)));
+			printf("Quantity:\t%.8f\n", f->quantity);
+			printf("Price:\t\t%.8f\n", f->price);
+			printf("Total:\t\t%.8f\n", f->total);
+			printf("FillType:\t%s\n", f->filltype);
+			printf("OrderType:\t%s\n\n", f->ordertype);
 		}
 	}
 }
 
+static void orderbook_records(struct fmt *out, struct order **o, const char *type) {
+	while (o && *o) {
+		fmt_begin(out);
+		fmt_str(out, "Type", type);
+		fmt_real(out, "Quantity", (*o)->quantity);
+		fmt_real(out, "Rate", (*o)->rate);
+		fmt_end(out);
+		o++;
+	}
+}
+
 void printorderbook(struct market *m) {
 	struct order **tmp;
-
+	struct fmt out;
+
+	if (m->ob && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		orderbook_records(&out, m->ob->buy, "buy");
+		orderbook_records(&out, m->ob->sell, "sell");
+		fmt_flush(&out);
+		return;
+	}
 	if (m->ob) {
 		tmp = m->ob->buy;
 		if (tmp) {
@@ -1134,7 +1091,24 @@ void printorderbook(struct market *m) {
 
 void printmarkets(struct market **markets) {
 	struct market **tmp = markets;
-
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++) {
+			fmt_begin(&out);
+			fmt_str(&out, "MarketCurrency", (*tmp)->marketcurrency);
+			fmt_str(&out, "BaseCurrency", (*tmp)->basecurrency);
+			fmt_str(&out, "MarketCurrencyLong", (*tmp)->marketcurrencylong);
+			fmt_str(&out, "BaseCurrencyLong", (*tmp)->basecurrencylong);
+			fmt_real(&out, "MinTradeSize", (*tmp)->mintradesize);
+			fmt_str(&out, "MarketName", (*tmp)->marketname);
+			fmt_bool(&out, "IsActive", (*tmp)->isactive);
+			fmt_end(&out);
+		}
+		fmt_flush(&out);
+		return;
+	}
 	while (tmp && *tmp) {
 		if ((*tmp)->marketcurrency)
 			printf("MarketCurrency:\t\t %s\n", (*tmp)->marketcurrency);
@@ -1153,9 +1127,36 @@ void printmarkets(struct market **markets) {
 }
 
 
+static void summary_record(struct fmt *out, struct market *m) {
+	fmt_begin(out);
+	fmt_str(out, "MarketName", m->marketname);
+	fmt_real(out, "High", m->ms->high);
+	fmt_real(out, "Low", m->ms->low);
+	fmt_real(out, "Volume", m->ms->volume);
+	fmt_real(out, "Last", m->ms->last);
+	fmt_real(out, "BaseVolume", m->ms->basevolume);
+	fmt_time(out, "TimeStamp", m->ms->timestamp);
+	fmt_real(out, "Bid", m->ms->bid);
+	fmt_real(out, "Ask", m->ms->ask);
+	fmt_int(out, "OpenBuyOrders", m->ms->openb);
+	fmt_int(out, "OpenSellOrders", m->ms->opens);
+	fmt_real(out, "PrevDay", m->ms->prevday);
+	fmt_end(out);
+}
+
 void printmarketsummaries(struct market **m) {
 	struct market **tmp = m;
+	struct fmt out;
 
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++) {
+			if ((*tmp)->ms)
+				summary_record(&out, *tmp);
+		}
+		fmt_flush(&out);
+		return;
+	}
 	while (tmp && *tmp) {
 		printf("MarketName:\t%s\n", (*tmp)->marketname);
 		printmarketsummary(*tmp);
@@ -1165,13 +1166,22 @@ void printmarketsummaries(struct market **m) {
 }
 
 void printmarketsummary(struct market *m) {
+	struct fmt out;
+	char ts[32];
+
+	if (m && m->ms && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		summary_record(&out, m);
+		fmt_flush(&out);
+		return;
+	}
 	if (m && m->ms) {
 		printf("High:\t\t%.8f\n", m->ms->high);
 		printf("Low:\t\t%.8f\n", m->ms->low);
 		printf("Volume:\t\t%.8f\n", m->ms->volume);
 		printf("Last:\t\t%.8f\n", m->ms->last);
 		printf("BaseVolume:\t%.8f\n", m->ms->basevolume);
-		printf("Timestamp:\t%s\n", m->ms->timestamp);
+		printf("Timestamp:\t%s\n", timestamp_str(m->ms->timestamp, ts, sizeof(ts)));
 		printf("Bid:\t\t%.8f\n", m->ms->bid);
 		printf("Ask:\t\t%.8f\n", m->ms->ask);
 		printf("OpenBuyOrders:\t%d\n", m->ms->openb);
@@ -1182,7 +1192,23 @@ void printmarketsummary(struct market *m) {
 
 void printcurrencies(struct currency **currencies) {
 	struct currency **tmp = currencies;
-
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++) {
+			fmt_begin(&out);
+			fmt_str(&out, "Currency", (*tmp)->coin);
+			fmt_str(&out, "CurrencyLong", (*tmp)->currencylong);
+			fmt_int(&out, "MinConfirmation", (*tmp)->minconfirmation);
+			fmt_real(&out, "TxFee", (*tmp)->txfee);
+			fmt_str(&out, "CoinType", (*tmp)->cointype);
+			fmt_str(&out, "BaseAddress", (*tmp)->baseaddress);
+			fmt_end(&out);
+		}
+		fmt_flush(&out);
+		return;
+	}
 	while (*tmp) {
 		printf("Coin:\t\t%s\n", (*tmp)->coin);
 		printf("Name:\t\t%s\n", (*tmp)->currencylong);
@@ -1206,6 +1232,18 @@ void printtopN(struct market **markets, int n) {
 }
 
 void printticker(struct ticker *t) {
+	struct fmt out;
+
+	if (t && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		fmt_begin(&out);
+		fmt_real(&out, "Bid", t->bid);
+		fmt_real(&out, "Ask", t->ask);
+		fmt_real(&out, "Last", t->last);
+		fmt_end(&out);
+		fmt_flush(&out);
+		return;
+	}
 	if (t) {
 		printf("Bid:\t%.8f\n", t->bid);
 		printf("Ask:\t%.8f\n", t->ask);
@@ -1213,9 +1251,29 @@ void printticker(struct ticker *t) {
 	}
 }
 
+static void tick_record(struct fmt *out, struct tick *t) {
+	fmt_begin(out);
+	fmt_time(out, "TimeStamp", t->timestamp);
+	fmt_real(out, "Open", t->open);
+	fmt_real(out, "High", t->high);
+	fmt_real(out, "Low", t->low);
+	fmt_real(out, "Close", t->close);
+	fmt_real(out, "Volume", t->volume);
+	fmt_real(out, "BTCValue", t->btcval);
+	fmt_end(out);
+}
+
 void printticks(struct tick **ticks) {
 	struct tick **tmp =  ticks;
-
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (; tmp && *tmp; tmp++)
+			tick_record(&out, *tmp);
+		fmt_flush(&out);
+		return;
+	}
 	while (tmp && *tmp) {
 		printtick(*tmp);
 		tmp++;
@@ -1223,6 +1281,15 @@ void printticks(struct tick **ticks) {
 }
 
 void printtick(struct tick *t) {
+	struct fmt out;
+	char ts[32];
+
+	if (t && output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		tick_record(&out, t);
+		fmt_flush(&out);
+		return;
+	}
 	if (t) {
 		printf("Open:\t\t%.8f\n", t->open);
 		printf("High:\t\t%.8f\n", t->high);
@@ -1231,6 +1298,6 @@ void printtick(struct tick *t) {
 		printf("Volume:\t\t%.8f\n", t->volume);
 		printf("BTC value:\t%.8f\n", t->btcval);
 		if (t->timestamp)
-			printf("Timestamp:\t%s\n\n", t->timestamp);
+			printf("Timestamp:\t%s\n\n", timestamp_str(t->timestamp, ts, sizeof(ts)));
 	}
 }
@@ -26,6 +26,7 @@
 #define MARKET_H
 
 #include <time.h>
+#include <stdint.h>
 #include <pthread.h>
 #include "lib/jansson/src/jansson.h"
 #include "bittrex.h"
@@ -37,13 +38,26 @@
  */
 struct market_history {
 	int id;
-	char *timestamp;
-	struct tm *ctm; /* used for converting timestamp strings in time struct */
+	int64_t timestamp; /* UTC epoch milliseconds */
 	double quantity;
 	double total;
 	double price;
-	char *filltype;
-	char *ordertype;
+	char filltype[16];
+	char ordertype[8];
+};
+
+#define MARKET_HISTORY_SIZE 1024
+
+/*
+ * Fills merged by getmarkethistory(), oldest are overwritten.
+ * fills[(head - 1) % MARKET_HISTORY_SIZE] is the newest.
+ */
+struct market_history_ring {
+	struct market_history fills[MARKET_HISTORY_SIZE];
+	int head;
+	int count;
+	int lastid;	/* newest Id merged */
+	long gaps;	/* polls where fills may have been lost */
 };
 
 /*
@@ -51,8 +65,7 @@ struct market_history {
  * Used only in struct market
  */
 struct market_summary {
-	char *timestamp;
-	struct tm *ctm; /* used for converting timestamp in time struct */
+	int64_t timestamp; /* UTC epoch milliseconds */
 	double last, low, high, basevolume, volume, bid, ask,prevday;
 	int openb, opens;
 };
@@ -61,6 +74,8 @@ struct market_summary {
  * Market
  */
 struct market {
+	int market_id;	/* interned marketname */
+	/* names are interned, do not free */
 	char *marketname;
 	char *marketcurrency;
 	char *marketcurrencylong;
@@ -72,12 +87,12 @@ struct market {
 	double low;
 	double basevolume; // duplicate of ms->basevolume (to speed up qsort)
 	double volume;
-	struct market_history **mh;
+	struct market_history_ring *mh;
 	struct market_summary *ms;
 	struct orderbook *ob;
 	double rsi; // Wilder RSI with mobile moving averages
 	double brsi; // Bechu RSI
-	double macd; // MACD 14 28 9 with exponential moving averages
+	double macd; // MACD 12 26 9 with exponential moving averages
 	double macdsignal;
 	double macdhisto;
 	int bot_rank;
@@ -103,7 +118,7 @@ struct tick {
 	double close;
 	double volume;
 	double btcval;
-	char *timestamp;
+	int64_t timestamp; /* UTC epoch milliseconds */
 	double rsi;
 	double rsi_mma;
 	double rsi_ema;
@@ -122,6 +137,8 @@ struct ticker {
  * Currency
  */
 struct	currency {
+	int currency_id;	/* interned coin */
+	/* coin, currencylong and cointype are interned, do not free */
 	char *coin;
 	char *currencylong;
 	int minconfirmation;
@@ -180,10 +197,17 @@ struct currency *getcurrency(struct currency **currencies, char *coin);
 int getmarketsummaries(struct bittrex_info *bi);
 
 /*
- * get last 100 transaction of given market
+ * merge last transactions (100) of given market into m->mh,
+ * only fills newer than the last seen Id are parsed.
+ * return number of new fills, -1 on error.
  */
 int getmarkethistory(struct bittrex_info *bi, struct market *m);
 
+/*
+ * i-th newest fill of market history (0 is the newest), NULL if none
+ */
+struct market_history *market_history_get(struct market_history_ring *mh, int i);
+
 /*
  * get market summary of given market
  */
@@ -229,6 +253,11 @@ struct tick **getticks_rsi_mma_interval_period(struct bittrex_info *bi,
 					       char *interval,
 					       int period);
 
+/*
+ * Update market MACD from closes (oldest first), no API call
+ */
+void market_indicators(struct market *m, double *close, int size);
+
 /*
  * If price increased more than 20% on last 24h
  * Consider the coin has been pumped
@@ -240,7 +269,7 @@ int pumped(struct bittrex_info *bi, struct market *m);
  */
 void free_markets(struct market **markets);
 void free_market(struct market *m);
-void free_market_history(struct market_history **mh);
+void free_market_history(struct market_history_ring *mh);
 void free_market_summary(struct market_summary *ms);
 void free_currencies(struct currency **currencies);
 void free_currency(struct currency *c);
@@ -0,0 +1,595 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "optimize.h"
+#include "archive.h"
+#include "indicators.h"
+#include "format.h"
+
+/* hour RSI must be computed before the first candle is fed */
+#define OPTIMIZE_WARMUP		(RSI_PERIOD + 1)
+
+/*
+ * Candles of one market, built once and read by all threads
+ */
+struct opt_series {
+	struct market *m;
+	struct tick *minute;
+	struct tick *hour;	/* aggregated from minutes */
+	struct tick **minutep;
+	struct tick **hourp;
+	size_t *hourof;		/* hour candles closed at minute i */
+	size_t nbminute;
+	size_t nbhour;
+	size_t first;		/* first minute fed */
+};
+
+/*
+ * Tasks [next, end) of a worker, others steal the upper half when
+ * their own range is empty. Tasks are market major so a range
+ * mostly reads the candles of one market.
+ */
+struct opt_queue {
+	pthread_mutex_t lock;
+	size_t next;
+	size_t end;
+};
+
+struct opt_task {
+	fixed_t pnl;
+	fixed_t maxdrawdown;
+	int trades;
+	int wins;
+};
+
+struct opt_job {
+	struct optimize_space *space;
+	struct opt_series *series;
+	int nbseries;
+	char (*params)[STRATEGY_PARAMSIZE];
+	int nbsets;
+	struct opt_task *tasks;
+	struct opt_queue *queues;
+	int nbthreads;
+};
+
+struct opt_worker {
+	struct opt_job *job;
+	int id;
+};
+
+int optimize_parse(struct optimize_space *space, const char *spec) {
+	struct optimize_range *r;
+	char name[32];
+	const char *p = strchr(spec, ':');
+	size_t len = p ? (size_t)(p - spec) : strlen(spec);
+	char *end;
+
+	memset(space, 0, sizeof(struct optimize_space));
+	if (len >= sizeof(name)) {
+		fprintf(stderr, "Invalid strategy: %s\n", spec);
+		return -1;
+	}
+	memcpy(name, spec, len);
+	name[len] = '\0';
+	if (!(space->s = strategy_find(name))) {
+		fprintf(stderr, "Unknown strategy: %s\n", name);
+		return -1;
+	}
+	if (!p)
+		return 0;
+
+	for (p++; *p; p = *end ? end + 1 : end) {
+		if (space->nbparams >= OPTIMIZE_MAXPARAMS)
+			goto invalid;
+		r = &(space->range[space->nbparams++]);
+		r->lo = r->hi = strtod(p, &end);
+		if (end == p)
+			goto invalid;
+		if (*end == '-') {
+			p = end + 1;
+			r->hi = strtod(p, &end);
+			if (end == p || *end != '/')
+				goto invalid;
+			p = end + 1;
+			r->step = strtod(p, &end);
+			if (end == p || r->step <= 0 || r->hi < r->lo)
+				goto invalid;
+		}
+		if (*end && *end != ',')
+			goto invalid;
+	}
+	return 0;
+
+invalid:
+	fprintf(stderr, "Invalid parameter ranges for strategy %s: %s (%s)\n",
+		name, spec + len + 1, space->s->usage);
+	return -1;
+}
+
+static void params_print(char *buf, double *v, int n) {
+	size_t len = 0;
+	int i;
+
+	buf[0] = '\0';
+	for (i = 0; i < n && len < STRATEGY_PARAMSIZE; i++)
+		len += snprintf(buf + len, STRATEGY_PARAMSIZE - len,
+				i ? ",%g" : "%g", v[i]);
+}
+
+/*
+ * Parameter sets of the grid, or samples random ones, accepted by the
+ * strategy init. return number of sets, -1 if the grid is too large.
+ */
+static int params_sets(struct optimize_space *space, int samples,
+		       char (**sets)[STRATEGY_PARAMSIZE]) {
+	double v[OPTIMIZE_MAXPARAMS];
+	int count[OPTIMIZE_MAXPARAMS], idx[OPTIMIZE_MAXPARAMS];
+	struct optimize_range *r;
+	unsigned int seed = time(NULL) ^ getpid();
+	void *scratch;
+	long total = 1;
+	int i, k, n = 0;
+
+	for (k = 0; k < space->nbparams; k++) {
+		r = &(space->range[k]);
+		count[k] = r->step > 0 ? (int)floor((r->hi - r->lo) / r->step + 1e-9) + 1 : 1;
+		idx[k] = 0;
+		total *= count[k];
+		if (total > OPTIMIZE_MAXSETS)
+			break;
+	}
+	if (samples > 0)
+		total = samples;
+	if (total > OPTIMIZE_MAXSETS) {
+		fprintf(stderr, "optimize: more than %d parameter sets, use --samples\n",
+			OPTIMIZE_MAXSETS);
+		return -1;
+	}
+
+	*sets = malloc(total * STRATEGY_PARAMSIZE);
+	scratch = malloc(space->s->statesize);
+	if (!*sets || !scratch) {
+		free(*sets);
+		free(scratch);
+		return -1;
+	}
+	for (i = 0; i < total; i++) {
+		for (k = 0; k < space->nbparams; k++) {
+			r = &(space->range[k]);
+			if (samples > 0)
+				v[k] = r->lo + (r->hi - r->lo) * rand_r(&seed) / RAND_MAX;
+			else
+				v[k] = r->lo + idx[k] * r->step;
+		}
+		/* next grid point */
+		for (k = space->nbparams - 1; k >= 0; k--) {
+			if (++idx[k] < count[k])
+				break;
+			idx[k] = 0;
+		}
+		params_print((*sets)[n], v, space->nbparams);
+		memset(scratch, 0, space->s->statesize);
+		if (space->s->init(scratch, (*sets)[n]) == 0)
+			n++;
+	}
+	free(scratch);
+	return n;
+}
+
+static void free_series(struct opt_series *se) {
+	free(se->minute);
+	free(se->hour);
+	free(se->minutep);
+	free(se->hourp);
+	free(se->hourof);
+}
+
+static void ticks_rsi(struct tick *t, size_t n) {
+	double *close, *rsi;
+	size_t i;
+
+	/* rsi_ema is left to 0, as getticks does, if it can not be computed */
+	if (n < RSI_PERIOD + 2)
+		return;
+	/* calloc: gcc can not see the loop below initializes it */
+	close = calloc(n, sizeof(double));
+	rsi = malloc(n * sizeof(double));
+	if (!close || !rsi) {
+		free(close);
+		free(rsi);
+		return;
+	}
+	for (i = 0; i < n; i++)
+		close[i] = t[i].close;
+
+	/* same as getticks_rsi_mma_interval_period(), first tick ignored */
+	ind_rsi(close + 1, (int)n - 1, RSI_PERIOD, rsi);
+	for (i = RSI_PERIOD + 1; i < n; i++)
+		t[i].rsi_ema = rsi[i-1];
+
+	free(close);
+	free(rsi);
+}
+
+static int load_series(char *dir, struct market *m, struct opt_series *se) {
+	struct archive *a;
+	struct archive_candle *c;
+	struct tick *h;
+	int64_t bucket;
+	size_t i, j;
+
+	memset(se, 0, sizeof(struct opt_series));
+	se->m = m;
+	if (!(a = archive_open(dir, m->marketname, OPTIMIZE_INTERVAL)))
+		return -1;
+	if (a->nbcandles < RSI_PERIOD + 2) {
+		archive_close(a);
+		return -1;
+	}
+
+	/* archives have gaps: count the hours instead of guessing */
+	for (i = 0, j = 0, bucket = -1; i < a->nbcandles; i++) {
+		if (a->candles[i].timestamp - a->candles[i].timestamp % 3600 != bucket) {
+			bucket = a->candles[i].timestamp - a->candles[i].timestamp % 3600;
+			j++;
+		}
+	}
+
+	se->nbminute = a->nbcandles;
+	se->minute = calloc(a->nbcandles, sizeof(struct tick));
+	se->hour = calloc(j, sizeof(struct tick));
+	se->minutep = malloc(a->nbcandles * sizeof(struct tick*));
+	se->hourp = malloc(j * sizeof(struct tick*));
+	se->hourof = malloc(a->nbcandles * sizeof(size_t));
+	if (!se->minute || !se->hour || !se->minutep || !se->hourp || !se->hourof) {
+		archive_close(a);
+		free_series(se);
+		return -1;
+	}
+
+	for (i = 0; i < a->nbcandles; i++) {
+		c = &(a->candles[i]);
+		se->minute[i].open = c->open;
+		se->minute[i].high = c->high;
+		se->minute[i].low = c->low;
+		se->minute[i].close = c->close;
+		se->minute[i].volume = c->volume;
+		se->minute[i].btcval = c->btcval;
+		se->minute[i].timestamp = c->timestamp * 1000;
+		se->minutep[i] = &(se->minute[i]);
+
+		bucket = c->timestamp - c->timestamp % 3600;
+		h = se->nbhour ? &(se->hour[se->nbhour-1]) : NULL;
+		if (!h || h->timestamp != bucket * 1000) {
+			h = &(se->hour[se->nbhour]);
+			se->hourp[se->nbhour++] = h;
+			*h = se->minute[i];
+			h->timestamp = bucket * 1000;
+			continue;
+		}
+		if (c->high > h->high)
+			h->high = c->high;
+		if (c->low < h->low)
+			h->low = c->low;
+		h->close = c->close;
+		h->volume += c->volume;
+		h->btcval += c->btcval;
+	}
+	archive_close(a);
+
+	ticks_rsi(se->minute, se->nbminute);
+	if (se->nbhour > 1)
+		ticks_rsi(se->hour, se->nbhour);
+
+	/* an hour candle is closed with its last minute */
+	se->first = se->nbminute;
+	for (i = 0, j = 0; i < se->nbminute; i++) {
+		while (j < se->nbhour &&
+		       se->hour[j].timestamp + 3600000 <= se->minute[i].timestamp + 60000)
+			j++;
+		se->hourof[i] = j;
+		if (j > OPTIMIZE_WARMUP && se->first == se->nbminute)
+			se->first = i;
+	}
+	if (se->first == se->nbminute) {
+		free_series(se);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Paper trade params on one market, candle by candle
+ */
+static void backtest(struct opt_series *se, const struct strategy *s,
+		     const char *params, void *state, struct opt_task *t) {
+	struct strategy_instance inst;
+	struct strategy_feed feed;
+	fixed_t equity = 0, peak = 0, gain;
+	int signal, trades;
+	size_t i;
+
+	memset(&inst, 0, sizeof(struct strategy_instance));
+	memset(t, 0, sizeof(struct opt_task));
+	memset(state, 0, s->statesize);
+	inst.s = s;
+	inst.state = state;
+	inst.pos.paper = 1;
+	strcpy(inst.params, params);
+	if (s->init(state, params) != 0)
+		return;
+
+	feed.m = se->m;
+	feed.minute = se->minutep;
+	feed.hour = se->hourp;
+	for (i = se->first; i < se->nbminute; i++) {
+		feed.nbminute = i + 1;
+		feed.nbhour = se->hourof[i];
+		feed.last = fixed_from_double(se->minute[i].close);
+		/* candle is closed */
+		feed.now = se->minute[i].timestamp / 1000 + 60;
+
+		gain = inst.gain;
+		trades = inst.trades;
+		signal = s->on_candle(state, &feed, &(inst.pos));
+		strategy_paper(&inst, &feed, signal);
+		signal = s->on_ticker(state, &feed, &(inst.pos));
+		strategy_paper(&inst, &feed, signal);
+		if (inst.trades > trades && inst.gain > gain)
+			t->wins++;
+
+		equity = inst.gain;
+		if (inst.pos.state == POSITION_HOLDING)
+			equity += strategy_gain(&(inst.pos), feed.last);
+		if (equity > peak)
+			peak = equity;
+		if (peak - equity > t->maxdrawdown)
+			t->maxdrawdown = peak - equity;
+	}
+	/* open position valued at the last close */
+	t->pnl = equity;
+	t->trades = inst.trades;
+}
+
+/*
+ * Next task of worker id, stolen from the fullest queue if its own
+ * is empty. return 0 when all queues are empty.
+ */
+static int take_task(struct opt_job *job, int id, size_t *task) {
+	struct opt_queue *q = &(job->queues[id]), *v;
+	size_t size, bestsize, mid, end;
+	int i, best;
+
+	pthread_mutex_lock(&(q->lock));
+	if (q->next < q->end) {
+		*task = q->next++;
+		pthread_mutex_unlock(&(q->lock));
+		return 1;
+	}
+	pthread_mutex_unlock(&(q->lock));
+
+	while (1) {
+		best = -1;
+		bestsize = 0;
+		for (i = 0; i < job->nbthreads; i++) {
+			if (i == id)
+				continue;
+			pthread_mutex_lock(&(job->queues[i].lock));
+			size = job->queues[i].end - job->queues[i].next;
+			pthread_mutex_unlock(&(job->queues[i].lock));
+			if (size > bestsize) {
+				best = i;
+				bestsize = size;
+			}
+		}
+		if (best < 0)
+			return 0;
+
+		v = &(job->queues[best]);
+		pthread_mutex_lock(&(v->lock));
+		size = v->end - v->next;
+		if (size == 0) {
+			/* emptied meanwhile */
+			pthread_mutex_unlock(&(v->lock));
+			continue;
+		}
+		mid = v->next + size / 2;
+		end = v->end;
+		v->end = mid;
+		pthread_mutex_unlock(&(v->lock));
+
+		pthread_mutex_lock(&(q->lock));
+		q->next = mid + 1;
+		q->end = end;
+		pthread_mutex_unlock(&(q->lock));
+		*task = mid;
+		return 1;
+	}
+}
+
+static void *optimize_worker(void *w) {
+	struct opt_worker *worker = (struct opt_worker *)w;
+	struct opt_job *job = worker->job;
+	const struct strategy *s = job->space->s;
+	void *state;
+	size_t task;
+
+	if (!(state = malloc(s->statesize)))
+		return NULL;
+	while (take_task(job, worker->id, &task)) {
+		backtest(&(job->series[task / job->nbsets]), s,
+			 job->params[task % job->nbsets], state, &(job->tasks[task]));
+	}
+	free(state);
+	return NULL;
+}
+
+static int compare_results(const void *a, const void *b) {
+	const struct optimize_result *ra = a, *rb = b;
+
+	if (ra->pnl > rb->pnl)
+		return -1;
+	if (ra->pnl < rb->pnl)
+		return 1;
+	return 0;
+}
+
+static void print_results(const struct strategy *s, struct optimize_result *r, int n) {
+	static struct fmt out;
+	int i;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		for (i = 0; i < n; i++) {
+			fmt_begin(&out);
+			fmt_str(&out, "Strategy", s->name);
+			fmt_str(&out, "Params", r[i].params);
+			fmt_int(&out, "Markets", r[i].markets);
+			fmt_int(&out, "Trades", r[i].trades);
+			fmt_int(&out, "Wins", r[i].wins);
+			fmt_fixed(&out, "PnL", r[i].pnl);
+			fmt_fixed(&out, "MaxDrawdown", r[i].maxdrawdown);
+			fmt_end(&out);
+		}
+		fmt_flush(&out);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		printf("%s%s%s\tpnl: %.8f\tper market: %.8f\ttrades: %d\twins: %.1f%%\tmax drawdown: %.8f\n",
+		       s->name, r[i].params[0] ? ":" : "", r[i].params,
+		       fixed_to_double(r[i].pnl),
+		       r[i].markets ? fixed_to_double(r[i].pnl) / r[i].markets : 0,
+		       r[i].trades,
+		       r[i].trades ? 100.0 * r[i].wins / r[i].trades : 0,
+		       fixed_to_double(r[i].maxdrawdown));
+	}
+}
+
+int optimize(struct bittrex_info *bi, struct market *m,
+	     struct optimize_space *space, int samples) {
+	struct market *single[2] = { m, NULL }, **markets;
+	struct opt_job job;
+	struct opt_worker *workers;
+	struct optimize_result *results;
+	struct opt_task *t;
+	pthread_t *threads;
+	size_t nbtasks, i;
+	int j, nbcpu, nbmarkets;
+
+	markets = m ? single : bi->markets;
+	if (!markets)
+		return -1;
+	memset(&job, 0, sizeof(struct opt_job));
+	job.space = space;
+	if ((job.nbsets = params_sets(space, samples, &(job.params))) <= 0) {
+		if (job.nbsets == 0) {
+			fprintf(stderr, "optimize: no valid parameter set (%s)\n", space->s->usage);
+			free(job.params);
+		}
+		return -1;
+	}
+
+	for (nbmarkets = 0; markets[nbmarkets]; nbmarkets++);
+	job.series = malloc(nbmarkets * sizeof(struct opt_series));
+	for (j = 0; job.series && j < nbmarkets; j++) {
+		if (load_series(bi->archivedir, markets[j], &(job.series[job.nbseries])) == 0)
+			job.nbseries++;
+	}
+	if (job.nbseries == 0) {
+		fprintf(stderr, "optimize: no archived %s candles (%d hours at least)\n",
+			OPTIMIZE_INTERVAL, OPTIMIZE_WARMUP + 1);
+		free(job.series);
+		free(job.params);
+		return -1;
+	}
+
+	nbtasks = (size_t)job.nbseries * job.nbsets;
+	nbcpu = sysconf(_SC_NPROCESSORS_ONLN);
+	job.nbthreads = nbcpu < 1 ? 1 : nbcpu > OPTIMIZE_THREADS ? OPTIMIZE_THREADS : nbcpu;
+	if ((size_t)job.nbthreads > nbtasks)
+		job.nbthreads = nbtasks;
+	job.tasks = calloc(nbtasks, sizeof(struct opt_task));
+	job.queues = malloc(job.nbthreads * sizeof(struct opt_queue));
+	workers = malloc(job.nbthreads * sizeof(struct opt_worker));
+	threads = malloc(job.nbthreads * sizeof(pthread_t));
+	results = calloc(job.nbsets, sizeof(struct optimize_result));
+	if (!job.tasks || !job.queues || !workers || !threads || !results) {
+		fprintf(stderr, "optimize: out of memory\n");
+		job.nbsets = -1;
+		goto out;
+	}
+
+	fprintf(stderr, "Testing %d parameter set(s) on %d market(s) with %d thread(s)\n",
+		job.nbsets, job.nbseries, job.nbthreads);
+	for (j = 0; j < job.nbthreads; j++) {
+		pthread_mutex_init(&(job.queues[j].lock), NULL);
+		job.queues[j].next = nbtasks * j / job.nbthreads;
+		job.queues[j].end = nbtasks * (j + 1) / job.nbthreads;
+		workers[j].job = &job;
+		workers[j].id = j;
+	}
+	for (j = 0; j < job.nbthreads; j++)
+		pthread_create(&(threads[j]), NULL, optimize_worker, &(workers[j]));
+	for (j = 0; j < job.nbthreads; j++)
+		pthread_join(threads[j], NULL);
+	for (j = 0; j < job.nbthreads; j++)
+		pthread_mutex_destroy(&(job.queues[j].lock));
+
+	for (i = 0; i < nbtasks; i++) {
+		t = &(job.tasks[i]);
+		j = i % job.nbsets;
+		results[j].pnl += t->pnl;
+		results[j].trades += t->trades;
+		results[j].wins += t->wins;
+		results[j].markets++;
+		if (t->maxdrawdown > results[j].maxdrawdown)
+			results[j].maxdrawdown = t->maxdrawdown;
+	}
+	for (j = 0; j < job.nbsets; j++)
+		strcpy(results[j].params, job.params[j]);
+	qsort(results, job.nbsets, sizeof(struct optimize_result), compare_results);
+	print_results(space->s, results, job.nbsets);
+
+out:
+	for (j = 0; j < job.nbseries; j++)
+		free_series(&(job.series[j]));
+	free(job.series);
+	free(job.params);
+	free(job.tasks);
+	free(job.queues);
+	free(workers);
+	free(threads);
+	free(results);
+	return job.nbsets;
+}
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "bittrex.h"
+#include "market.h"
+#include "fixed.h"
+#include "strategy.h"
+
+#define OPTIMIZE_INTERVAL	"oneMin"
+#define OPTIMIZE_THREADS	64	/* at most, one per online cpu */
+#define OPTIMIZE_MAXPARAMS	8
+#define OPTIMIZE_MAXSETS	65536
+
+/*
+ * One positional parameter: lo == hi for a single value
+ */
+struct optimize_range {
+	double lo;
+	double hi;
+	double step;	/* grid only, 0 for a single value */
+};
+
+/*
+ * Parameters searched for a strategy, from "name[:r1,r2,...]"
+ * where each r is a value or lo-hi/step, ex: rsi:20-35/5,60,65-80/5,1
+ */
+struct optimize_space {
+	const struct strategy *s;
+	struct optimize_range range[OPTIMIZE_MAXPARAMS];
+	int nbparams;
+};
+
+/*
+ * Backtest of one parameter set over all markets.
+ * Amounts are BTC per BTC invested (each paper buy is 1 BTC).
+ */
+struct optimize_result {
+	char params[STRATEGY_PARAMSIZE];
+	fixed_t pnl;		/* sum over markets */
+	fixed_t maxdrawdown;	/* worst market, open position included */
+	int markets;
+	int trades;
+	int wins;
+};
+
+/*
+ * 0 if spec is valid, -1 otherwise (error printed)
+ */
+int optimize_parse(struct optimize_space *space, const char *spec);
+
+/*
+ * Backtest the grid of space (samples == 0) or samples random sets on
+ * the archived oneMin candles of m, or of all markets if m is NULL.
+ * Candles are loaded once and shared by all threads. Results are
+ * printed best pnl first.
+ * return number of parameter sets tested, -1 if nothing to test.
+ */
+int optimize(struct bittrex_info *bi, struct market *m,
+	     struct optimize_space *space, int samples);
+
+#endif
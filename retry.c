@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "retry.h"
+#include "bittrex.h"
+
+void retry_init(struct retry_policy *rp) {
+	rp->nbendpoints = 0;
+	rp->seed = (unsigned int)time(NULL);
+}
+
+/*
+ * State of rootcall (added on first use), bi_lock held.
+ * rootcall are endpoint defines, the table never fills up in practice;
+ * if it does the last entry is shared.
+ */
+static struct retry_endpoint *endpoint(struct retry_policy *rp, const char *rootcall) {
+	struct retry_endpoint *e;
+	int i;
+
+	for (i = 0; i < rp->nbendpoints; i++) {
+		if (strcmp(rp->endpoints[i].rootcall, rootcall) == 0)
+			return &(rp->endpoints[i]);
+	}
+	if (rp->nbendpoints == RETRY_ENDPOINTS)
+		return &(rp->endpoints[RETRY_ENDPOINTS - 1]);
+
+	e = &(rp->endpoints[rp->nbendpoints++]);
+	e->rootcall = rootcall;
+	e->budget = RETRY_BUDGET;
+	e->window = time(NULL);
+	e->failures = 0;
+	e->open_until = 0;
+	e->probing = 0;
+	return e;
+}
+
+int retry_allow(struct bittrex_info *bi, const char *rootcall) {
+	struct retry_endpoint *e;
+	time_t now = time(NULL);
+	int rc = 0;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->retry), rootcall);
+	if (e->failures >= BREAKER_THRESHOLD) {
+		/* open, then one probe at a time once cooled down */
+		if (now < e->open_until || e->probing)
+			rc = -1;
+		else
+			e->probing = 1;
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+
+	if (rc)
+		fprintf(stderr, "%s: API keeps failing, call skipped (circuit open)\n",
+			rootcall);
+	return rc;
+}
+
+long retry_backoff(struct bittrex_info *bi, const char *rootcall, int attempt) {
+	struct retry_endpoint *e;
+	time_t now = time(NULL);
+	long cap, delay = -1;
+
+	if (attempt + 1 >= RETRY_MAX_ATTEMPTS)
+		return -1;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->retry), rootcall);
+	if (difftime(now, e->window) >= 60) {
+		e->window = now;
+		e->budget = RETRY_BUDGET;
+	}
+	if (e->budget > 0) {
+		e->budget--;
+		/* full jitter */
+		cap = (long)RETRY_BASE_MS << attempt;
+		if (cap > RETRY_MAX_MS)
+			cap = RETRY_MAX_MS;
+		delay = rand_r(&(bi->retry.seed)) % (cap + 1);
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+
+	if (delay < 0)
+		fprintf(stderr, "%s: retry budget exhausted\n", rootcall);
+	return delay;
+}
+
+void retry_done(struct bittrex_info *bi, const char *rootcall, int success) {
+	struct retry_endpoint *e;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->retry), rootcall);
+	e->probing = 0;
+	if (success) {
+		e->failures = 0;
+	} else if (++e->failures >= BREAKER_THRESHOLD) {
+		if (e->failures == BREAKER_THRESHOLD)
+			fprintf(stderr, "%s: %d failed calls in a row, pausing for %ds\n",
+				rootcall, e->failures, BREAKER_COOLDOWN);
+		e->open_until = time(NULL) + BREAKER_COOLDOWN;
+	}
+	pthread_mutex_unlock(&(bi->bi_lock));
+}
+
+void retry_pause(struct bittrex_info *bi, const char *rootcall) {
+	struct retry_endpoint *e;
+	time_t now = time(NULL);
+	unsigned int wait = 1;
+
+	pthread_mutex_lock(&(bi->bi_lock));
+	e = endpoint(&(bi->retry), rootcall);
+	if (e->failures >= BREAKER_THRESHOLD && e->open_until > now + 1)
+		wait = e->open_until - now;
+	pthread_mutex_unlock(&(bi->bi_lock));
+	sleep(wait);
+}
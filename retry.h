@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef RETRY_H
+#define RETRY_H
+
+#include <time.h>
+
+#define RETRY_ENDPOINTS		32	/* distinct API calls tracked */
+#define RETRY_MAX_ATTEMPTS	5	/* per call, first one included */
+#define RETRY_BASE_MS		250	/* backoff: random in [0, base * 2^attempt] */
+#define RETRY_MAX_MS		8000
+#define RETRY_BUDGET		20	/* retries per endpoint and per minute */
+#define BREAKER_THRESHOLD	5	/* consecutive failed calls opening the circuit */
+#define BREAKER_COOLDOWN	30	/* seconds before a probe call is allowed */
+
+struct bittrex_info;
+
+/*
+ * Retry and circuit breaker state of one API call (rootcall),
+ * in bittrex_info, protected by bi_lock.
+ */
+struct retry_endpoint {
+	const char *rootcall;
+	/* retries left in the current minute */
+	int budget;
+	time_t window;
+	/* failed calls in a row, circuit is open until open_until */
+	int failures;
+	time_t open_until;
+	/* a probe call is running after cooldown (half open) */
+	int probing;
+};
+
+struct retry_policy {
+	struct retry_endpoint endpoints[RETRY_ENDPOINTS];
+	int nbendpoints;
+	unsigned int seed;
+};
+
+void retry_init(struct retry_policy *rp);
+
+/*
+ * 0 if a call to rootcall may be sent, -1 if its circuit is open
+ */
+int retry_allow(struct bittrex_info *bi, const char *rootcall);
+
+/*
+ * After a failed attempt (0 for the first one): milliseconds to wait
+ * before the next one, -1 if attempts or retry budget are exhausted.
+ */
+long retry_backoff(struct bittrex_info *bi, const char *rootcall, int attempt);
+
+/*
+ * Outcome of a call, after its last attempt
+ */
+void retry_done(struct bittrex_info *bi, const char *rootcall, int success);
+
+/*
+ * For loops replaying a failed call until it succeeds: sleep until the
+ * circuit of rootcall may be probed again, at least one second.
+ */
+void retry_pause(struct bittrex_info *bi, const char *rootcall);
+
+#endif
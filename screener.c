@@ -0,0 +1,292 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "screener.h"
+#include "indicators.h"
+
+/*
+ * Shared between screener threads, next is the next candidate to fetch.
+ */
+struct screener_job {
+	struct bittrex_info *bi;
+	struct screener_filter *f;
+	struct screened_market *cand;
+	double **close;		/* closes of each candidate, oldest first */
+	int *size;
+	int *pass;
+	int nbcand;
+	int next;
+	pthread_mutex_t lock;
+};
+
+void screener_defaults(struct screener_filter *f) {
+	f->base = "BTC-";
+	f->minvolume = 0;
+	f->maxspread = 1;
+	f->maxpump = 1.2;
+	f->rsimin = 0;
+	f->rsimax = 100;
+	f->maxcandidates = SCREENER_CANDIDATES;
+	f->nbthreads = SCREENER_THREADS;
+}
+
+/*
+ * Fetch the candles of candidate c, RSI and pump are computed
+ * for all candidates at once by screen_indicators().
+ */
+static int screen_market(struct screener_job *job, int c) {
+	struct tick **ticks = NULL;
+	double *close;
+	int size, i;
+
+	/* one fetch per market, retried like other bot calls */
+	for (i = 0; i < 3 && !ticks; i++)
+		ticks = getticks(job->bi, job->cand[c].m, SCREENER_INTERVAL, 0, DESCENDING);
+	if (!ticks)
+		return 0;
+	for (size = 0; ticks[size]; size++);
+
+	if (!size || !(close = malloc(size * sizeof(double)))) {
+		free_ticks(ticks);
+		return 0;
+	}
+	for (i = 0; i < size; i++)
+		close[i] = ticks[i]->close;
+	free_ticks(ticks);
+
+	market_indicators(job->cand[c].m, close, size);
+	job->close[c] = close;
+	job->size[c] = size;
+	return 1;
+}
+
+/*
+ * RSI of candidates, one column per market. Only series of the same
+ * length share a batch: padding a shorter one would change its seed.
+ */
+static void screen_rsi(struct screener_job *job, int *idx, int *done) {
+	struct ind_batch *b;
+	double *rsi;
+	int i, j, n;
+
+	for (i = 0; i < job->nbcand; i++) {
+		if (!job->pass[i] || done[i] || job->size[i] <= RSI_PERIOD)
+			continue;
+		for (n = 0, j = i; j < job->nbcand; j++) {
+			if (job->pass[j] && !done[j] && job->size[j] == job->size[i]) {
+				idx[n++] = j;
+				done[j] = 1;
+			}
+		}
+		if (!(b = new_ind_batch(n, job->size[i])))
+			continue;
+		if (!(rsi = new_ind_column(b))) {
+			free_ind_batch(b);
+			continue;
+		}
+		for (j = 0; j < n; j++)
+			ind_batch_set(b, j, job->close[idx[j]], job->size[idx[j]]);
+		ind_rsi_batch(b, RSI_PERIOD, rsi);
+		for (j = 0; j < n; j++)
+			job->cand[idx[j]].rsi = ind_batch_last(b, rsi, j);
+		free(rsi);
+		free_ind_batch(b);
+	}
+}
+
+/*
+ * Same as pumped(): EMA(24) now compared to EMA(24) one period ago.
+ * Every series is cut to its last 2 * period - 1 closes (seed on the
+ * first period), so all candidates fit in one batch.
+ */
+static void screen_pump(struct screener_job *job, int *idx) {
+	int period = SCREENER_PUMP_PERIOD;
+	struct ind_batch *b;
+	double *ema, first;
+	int i, n;
+
+	for (n = 0, i = 0; i < job->nbcand; i++)
+		if (job->pass[i] && job->size[i] >= 2 * period)
+			idx[n++] = i;
+	if (!(b = new_ind_batch(n, 2 * period - 1)))
+		return;
+	if (!(ema = new_ind_column(b))) {
+		free_ind_batch(b);
+		return;
+	}
+	for (i = 0; i < n; i++)
+		ind_batch_set(b, i, job->close[idx[i]], job->size[idx[i]]);
+	ind_ema_batch(b, period, ema);
+	for (i = 0; i < n; i++) {
+		first = ema[(period-1) * b->stride + i];
+		if (first != 0)
+			job->cand[idx[i]].pump = ind_batch_last(b, ema, i) / first;
+	}
+	free(ema);
+	free_ind_batch(b);
+}
+
+static void screen_indicators(struct screener_job *job) {
+	int *idx, *done;
+
+	idx = malloc((job->nbcand + 1) * sizeof(int));
+	done = calloc(job->nbcand + 1, sizeof(int));
+	if (idx && done) {
+		screen_rsi(job, idx, done);
+		screen_pump(job, idx);
+	}
+	free(idx);
+	free(done);
+}
+
+static int screen_filter(struct screener_job *job, struct screened_market *s) {
+	if (s->pump > job->f->maxpump) {
+		printf("Market: %s pumped recently, ignoring\n", s->m->marketname);
+		return 0;
+	}
+	if (s->rsi < job->f->rsimin || s->rsi > job->f->rsimax)
+		return 0;
+	return 1;
+}
+
+static void *screener_worker(void *j) {
+	struct screener_job *job = (struct screener_job *)j;
+	int i;
+
+	while (1) {
+		pthread_mutex_lock(&(job->lock));
+		i = job->next++;
+		pthread_mutex_unlock(&(job->lock));
+		if (i >= job->nbcand)
+			break;
+		job->pass[i] = screen_market(job, i);
+	}
+	return NULL;
+}
+
+static int compare_screened(const void *a, const void *b) {
+	struct screened_market **sa = (struct screened_market **)a;
+	struct screened_market **sb = (struct screened_market **)b;
+
+	if ((*sa)->score > (*sb)->score)
+		return -1;
+	if ((*sa)->score < (*sb)->score)
+		return 1;
+	return 0;
+}
+
+struct screened_market **screener(struct bittrex_info *bi, struct screener_filter *f, int max) {
+	struct screener_job job;
+	struct screened_market **res;
+	struct market *m;
+	pthread_t *threads;
+	int i, nbthreads, nbres = 0;
+
+	if (!bi->markets || max <= 0)
+		return NULL;
+
+	job.bi = bi;
+	job.f = f;
+	job.next = 0;
+	job.nbcand = 0;
+	job.cand = malloc((bi->nbmarkets + 1) * sizeof(struct screened_market));
+	job.pass = calloc(bi->nbmarkets + 1, sizeof(int));
+	job.close = calloc(bi->nbmarkets + 1, sizeof(double*));
+	job.size = calloc(bi->nbmarkets + 1, sizeof(int));
+	if (!job.cand || !job.pass || !job.close || !job.size) {
+		free(job.cand);
+		free(job.pass);
+		free(job.close);
+		free(job.size);
+		return NULL;
+	}
+	pthread_mutex_init(&(job.lock), NULL);
+
+	/*
+	 * Markets are sorted by volume (getmarketsummaries),
+	 * cheap filters first, no API call here.
+	 */
+	for (i = 0; i < bi->nbmarkets && job.nbcand < f->maxcandidates; i++) {
+		m = bi->markets[i];
+		if (f->base && strncmp(f->base, m->marketname, strlen(f->base)) != 0)
+			continue;
+		if (!m->isactive || !m->ms || m->basevolume < f->minvolume)
+			continue;
+		job.cand[job.nbcand].m = m;
+		job.cand[job.nbcand].spread = m->ms->bid > 0 ?
+			(m->ms->ask - m->ms->bid) / m->ms->bid : 1;
+		job.cand[job.nbcand].score = m->basevolume;
+		job.cand[job.nbcand].rsi = 0;
+		job.cand[job.nbcand].pump = 0;
+		if (job.cand[job.nbcand].spread > f->maxspread)
+			continue;
+		job.nbcand++;
+	}
+
+	nbthreads = f->nbthreads < job.nbcand ? f->nbthreads : job.nbcand;
+	if (nbthreads < 1)
+		nbthreads = 1;
+	threads = malloc(nbthreads * sizeof(pthread_t));
+	for (i = 0; i < nbthreads; i++)
+		pthread_create(&(threads[i]), NULL, screener_worker, &job);
+	for (i = 0; i < nbthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&(job.lock));
+
+	screen_indicators(&job);
+	res = malloc((job.nbcand + 1) * sizeof(struct screened_market*));
+	for (i = 0; i < job.nbcand; i++) {
+		free(job.close[i]);
+		if (!job.pass[i] || !screen_filter(&job, &(job.cand[i])))
+			continue;
+		res[nbres] = malloc(sizeof(struct screened_market));
+		*res[nbres] = job.cand[i];
+		nbres++;
+	}
+	qsort(res, nbres, sizeof(struct screened_market*), compare_screened);
+	for (i = max; i < nbres; i++)
+		free(res[i]);
+	res[nbres < max ? nbres : max] = NULL;
+
+	free(job.cand);
+	free(job.pass);
+	free(job.close);
+	free(job.size);
+	return res;
+}
+
+void free_screened(struct screened_market **s) {
+	struct screened_market **tmp = s;
+
+	while (tmp && *tmp) {
+		free(*tmp);
+		tmp++;
+	}
+	free(s);
+}
@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCREENER_H
+#define SCREENER_H
+
+#include "bittrex.h"
+#include "market.h"
+
+#define SCREENER_THREADS	8
+#define SCREENER_CANDIDATES	32
+#define SCREENER_INTERVAL	"Hour"
+#define SCREENER_PUMP_PERIOD	24
+
+/*
+ * Filters applied on candidate markets.
+ * Volume and spread come from market summaries (no extra API call),
+ * pump and RSI are computed from candles fetched in parallel.
+ */
+struct screener_filter {
+	char *base;		/* market prefix, ex: "BTC-" */
+	double minvolume;	/* minimum base volume (24h) */
+	double maxspread;	/* maximum (ask - bid) / bid */
+	double maxpump;		/* EMA ratio over the last period, 1.2 is +20% */
+	double rsimin;		/* RSI(14) bounds on SCREENER_INTERVAL */
+	double rsimax;
+	int maxcandidates;	/* top volume markets considered */
+	int nbthreads;
+};
+
+struct screened_market {
+	struct market *m;
+	double rsi;
+	double pump;
+	double spread;
+	double score;
+};
+
+/*
+ * default filter used by the bot
+ */
+void screener_defaults(struct screener_filter *f);
+
+/*
+ * Return at most max markets passing the filter, best score first,
+ * NULL terminated. Market summaries must be loaded.
+ */
+struct screened_market **screener(struct bittrex_info *bi, struct screener_filter *f, int max);
+void free_screened(struct screened_market **s);
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "bittrex.h"
+#include "market.h"
+#include "trade.h"
+#include "bot.h"
+#include "intern.h"
+
+/*
+ * copy string into fixed size field
+ */
+static void field_set(char *dest, size_t size, const char *src) {
+	dest[0] = '\0';
+	if (src) {
+		strncpy(dest, src, size - 1);
+		dest[size - 1] = '\0';
+	}
+}
+
+/*
+ * string from fixed size field, NULL if empty
+ */
+static char *field_get(const char *src, size_t size) {
+	char *dest;
+	size_t len = strnlen(src, size);
+
+	if (len == 0)
+		return NULL;
+	dest = malloc(len + 1);
+	memcpy(dest, src, len);
+	dest[len] = '\0';
+	return dest;
+}
+
+#define FIELD_SET(dest, src) field_set(dest, sizeof(dest), src)
+#define FIELD_GET(src) field_get(src, sizeof(src))
+
+static void snapshot_market_set(struct snapshot_market *sm, struct market *m) {
+	memset(sm, 0, sizeof(struct snapshot_market));
+	FIELD_SET(sm->marketname, m->marketname);
+	FIELD_SET(sm->marketcurrency, m->marketcurrency);
+	FIELD_SET(sm->basecurrency, m->basecurrency);
+	FIELD_SET(sm->marketcurrencylong, m->marketcurrencylong);
+	FIELD_SET(sm->basecurrencylong, m->basecurrencylong);
+	sm->isactive = m->isactive;
+	sm->mintradesize = m->mintradesize;
+	sm->high = m->high;
+	sm->low = m->low;
+	sm->basevolume = m->basevolume;
+	sm->volume = m->volume;
+	if (m->ms) {
+		sm->has_summary = 1;
+		sm->timestamp = m->ms->timestamp;
+		sm->last = m->ms->last;
+		sm->bid = m->ms->bid;
+		sm->ask = m->ms->ask;
+		sm->prevday = m->ms->prevday;
+		sm->openb = m->ms->openb;
+		sm->opens = m->ms->opens;
+	}
+	pthread_mutex_lock(&(m->indicators_lock));
+	sm->rsi = m->rsi;
+	sm->brsi = m->brsi;
+	sm->macd = m->macd;
+	sm->macdsignal = m->macdsignal;
+	sm->macdhisto = m->macdhisto;
+	pthread_mutex_unlock(&(m->indicators_lock));
+}
+
+static struct market *snapshot_market_get(struct snapshot_market *sm) {
+	struct market *m;
+
+	if (!(m = new_market()))
+		return NULL;
+	m->market_id = intern(sm->marketname);
+	m->marketname = intern_name(m->market_id);
+	m->marketcurrency = intern_string(sm->marketcurrency);
+	m->basecurrency = intern_string(sm->basecurrency);
+	m->marketcurrencylong = intern_string(sm->marketcurrencylong);
+	m->basecurrencylong = intern_string(sm->basecurrencylong);
+	m->isactive = sm->isactive;
+	m->mintradesize = sm->mintradesize;
+	m->high = sm->high;
+	m->low = sm->low;
+	m->basevolume = sm->basevolume;
+	m->volume = sm->volume;
+	if (sm->has_summary) {
+		m->ms = malloc(sizeof(struct market_summary));
+		m->ms->timestamp = sm->timestamp;
+		m->ms->high = sm->high;
+		m->ms->low = sm->low;
+		m->ms->basevolume = sm->basevolume;
+		m->ms->volume = sm->volume;
+		m->ms->last = sm->last;
+		m->ms->bid = sm->bid;
+		m->ms->ask = sm->ask;
+		m->ms->prevday = sm->prevday;
+		m->ms->openb = sm->openb;
+		m->ms->opens = sm->opens;
+	}
+	m->rsi = sm->rsi;
+	m->brsi = sm->brsi;
+	m->macd = sm->macd;
+	m->macdsignal = sm->macdsignal;
+	m->macdhisto = sm->macdhisto;
+	return m;
+}
+
+static void snapshot_currency_set(struct snapshot_currency *sc, struct currency *c) {
+	memset(sc, 0, sizeof(struct snapshot_currency));
+	FIELD_SET(sc->coin, c->coin);
+	FIELD_SET(sc->currencylong, c->currencylong);
+	FIELD_SET(sc->cointype, c->cointype);
+	FIELD_SET(sc->baseaddress, c->baseaddress);
+	sc->minconfirmation = c->minconfirmation;
+	sc->isactive = c->isactive;
+	sc->txfee = c->txfee;
+}
+
+static struct currency *snapshot_currency_get(struct snapshot_currency *sc) {
+	struct currency *c;
+
+	if (!(c = malloc(sizeof(struct currency))))
+		return NULL;
+	c->currency_id = intern(sc->coin);
+	c->coin = intern_name(c->currency_id);
+	c->currencylong = intern_string(sc->currencylong);
+	c->cointype = intern_string(sc->cointype);
+	c->baseaddress = FIELD_GET(sc->baseaddress);
+	c->minconfirmation = sc->minconfirmation;
+	c->isactive = sc->isactive;
+	c->txfee = sc->txfee;
+	return c;
+}
+
+void snapshot_trade_set(struct snapshot_trade *st, struct market *m, int type,
+			char *uuid, fixed_t quantity, fixed_t rate, fixed_t btcpaid,
+			int completed) {
+	memset(st, 0, sizeof(struct snapshot_trade));
+	if (!uuid)
+		return;
+	FIELD_SET(st->market, m->marketname);
+	FIELD_SET(st->uuid, uuid);
+	st->buyorsell = type;
+	st->completed = completed;
+	st->quantity = quantity;
+	st->rate = rate;
+	st->btcpaid = btcpaid;
+}
+
+int snapshot_write(struct bittrex_info *bi, struct bittrex_bot **bbot, int clean) {
+	struct snapshot_header h;
+	struct snapshot_market sm;
+	struct snapshot_currency sc;
+	struct snapshot_trade st[2];
+	char *tmppath;
+	FILE *f;
+	int i, j;
+
+	if (!bi->snapshotpath || !bi->markets)
+		return -1;
+
+	tmppath = malloc(strlen(bi->snapshotpath) + strlen(".tmp") + 1);
+	strcpy(tmppath, bi->snapshotpath);
+	strcat(tmppath, ".tmp");
+	if (!(f = fopen(tmppath, "w"))) {
+		fprintf(stderr, "snapshot: could not open %s\n", tmppath);
+		free(tmppath);
+		return -1;
+	}
+
+	memset(&h, 0, sizeof(h));
+	h.magic = SNAPSHOT_MAGIC;
+	h.version = SNAPSHOT_VERSION;
+	h.timestamp = time(NULL);
+	h.clean = clean;
+	for (i = 0; bi->markets[i]; i++);
+	h.nbmarkets = i;
+	for (i = 0; bi->currencies && bi->currencies[i]; i++);
+	h.nbcurrencies = i;
+	for (i = 0; bbot && bbot[i] && bbot[i]->market; i++);
+	h.nbtrades = 2 * i;
+	fwrite(&h, sizeof(h), 1, f);
+
+	for (i = 0; bi->markets[i]; i++) {
+		snapshot_market_set(&sm, bi->markets[i]);
+		fwrite(&sm, sizeof(sm), 1, f);
+	}
+	for (i = 0; bi->currencies && bi->currencies[i]; i++) {
+		snapshot_currency_set(&sc, bi->currencies[i]);
+		fwrite(&sc, sizeof(sc), 1, f);
+	}
+	/* copy under lock, bot threads update their state with it */
+	for (i = 0; bbot && bbot[i] && bbot[i]->market; i++) {
+		pthread_mutex_lock(&(bi->bi_lock));
+		for (j = 0; j < 2; j++)
+			st[j] = bbot[i]->state[j];
+		pthread_mutex_unlock(&(bi->bi_lock));
+		fwrite(st, sizeof(struct snapshot_trade), 2, f);
+	}
+
+	if (fclose(f) != 0 || rename(tmppath, bi->snapshotpath) != 0) {
+		fprintf(stderr, "snapshot: could not write %s\n", bi->snapshotpath);
+		unlink(tmppath);
+		free(tmppath);
+		return -1;
+	}
+	free(tmppath);
+	return 0;
+}
+
+/*
+ * Clear the clean flag of the snapshot file (in place)
+ */
+static int snapshot_unclean(char *path) {
+	uint32_t clean = 0;
+	int fd, rc = 0;
+
+	if ((fd = open(path, O_WRONLY)) < 0)
+		return -1;
+	if (pwrite(fd, &clean, sizeof(clean),
+		   offsetof(struct snapshot_header, clean)) != sizeof(clean) ||
+	    fsync(fd) != 0)
+		rc = -1;
+	close(fd);
+	return rc;
+}
+
+int snapshot_load(struct bittrex_info *bi, char *path) {
+	struct snapshot *s;
+	struct snapshot_market *sm;
+	struct snapshot_currency *sc;
+	struct stat st;
+	size_t expected;
+	int fd;
+	unsigned int i;
+
+	if (!path || (fd = open(path, O_RDONLY)) < 0)
+		return 0;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct snapshot_header)) {
+		close(fd);
+		return 0;
+	}
+
+	s = malloc(sizeof(struct snapshot));
+	s->size = st.st_size;
+	s->map = mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (s->map == MAP_FAILED) {
+		free(s);
+		return 0;
+	}
+	s->header = (struct snapshot_header *)s->map;
+
+	expected = sizeof(struct snapshot_header) +
+		s->header->nbmarkets * sizeof(struct snapshot_market) +
+		s->header->nbcurrencies * sizeof(struct snapshot_currency) +
+		s->header->nbtrades * sizeof(struct snapshot_trade);
+	if (s->header->magic != SNAPSHOT_MAGIC ||
+	    s->header->version != SNAPSHOT_VERSION ||
+	    s->size != expected || s->header->nbmarkets == 0) {
+		fprintf(stderr, "snapshot: %s is invalid, ignoring\n", path);
+		free_snapshot(s);
+		return 0;
+	}
+	if (difftime(time(NULL), s->header->timestamp) > SNAPSHOT_MAXAGE) {
+		fprintf(stderr, "snapshot: %s is too old, ignoring\n", path);
+		free_snapshot(s);
+		return 0;
+	}
+
+	/*
+	 * Orders placed from now on are only in the database until the
+	 * next write: the file must not be trusted by the next start.
+	 */
+	s->clean = s->header->clean;
+	if (s->clean && snapshot_unclean(path) < 0) {
+		fprintf(stderr, "snapshot: could not clear clean flag of %s, resuming from database\n",
+			path);
+		s->clean = 0;
+	}
+
+	sm = (struct snapshot_market *)(s->header + 1);
+	sc = (struct snapshot_currency *)(sm + s->header->nbmarkets);
+	s->trades = (struct snapshot_trade *)(sc + s->header->nbcurrencies);
+
+	/* do not replace what has already been fetched (-m, -c) */
+	if (!bi->markets) {
+		bi->markets = malloc((s->header->nbmarkets + 1) * sizeof(struct market*));
+		for (i = 0; i < s->header->nbmarkets; i++)
+			bi->markets[i] = snapshot_market_get(&sm[i]);
+		bi->markets[i] = NULL;
+		/* same as getmarkets() */
+		bi->nbmarkets = i - 1;
+	}
+	if (!bi->currencies) {
+		bi->currencies = malloc((s->header->nbcurrencies + 1) * sizeof(struct currency*));
+		for (i = 0; i < s->header->nbcurrencies; i++)
+			bi->currencies[i] = snapshot_currency_get(&sc[i]);
+		bi->currencies[i] = NULL;
+	}
+
+	/* kept mapped for bot resuming */
+	free_snapshot(bi->snapshot);
+	bi->snapshot = s;
+
+	printf("Loaded snapshot %s (%u markets, %u currencies, %.0fs old)\n",
+	       path, s->header->nbmarkets, s->header->nbcurrencies,
+	       difftime(time(NULL), s->header->timestamp));
+	return 1;
+}
+
+struct trade *snapshot_trade_get(struct bittrex_info *bi, struct market *m, int type) {
+	struct snapshot_trade *st;
+	struct trade *t;
+	unsigned int i;
+
+	if (!bi->snapshot || !bi->snapshot->clean)
+		return NULL;
+
+	for (i = 0; i < bi->snapshot->header->nbtrades; i++) {
+		st = &(bi->snapshot->trades[i]);
+		if (st->buyorsell != type || intern_lookup(st->market) != m->market_id)
+			continue;
+		t = new_trade(m, LIMIT, st->quantity, st->rate, IMMEDIATE_OR_CANCEL,
+			      NONE, 0, type, st->uuid);
+		t->realqty = st->quantity;
+		t->btcpaid = st->btcpaid;
+		t->fee = fixed_muldiv(fixed_mul(t->realqty, st->rate), FIXED_FEE_BPS, 10000);
+		return t;
+	}
+	return NULL;
+}
+
+void free_snapshot(struct snapshot *s) {
+	if (s) {
+		munmap(s->map, s->size);
+		free(s);
+	}
+}
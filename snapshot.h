@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bittrex.h"
+#include "fixed.h"
+
+#define SNAPSHOT_MAGIC		0x50414e53 /* "SNAP" */
+#define SNAPSHOT_VERSION	3
+#define SNAPSHOT_INTERVAL	60	/* seconds between two writes in bot mode */
+#define SNAPSHOT_MAXAGE		3600	/* older snapshots are ignored */
+
+struct market;
+struct trade;
+struct bittrex_bot;
+
+/*
+ * Binary snapshot of the bot warm state, fixed size records:
+ * header, markets, currencies then open trades of bot threads.
+ * Strings are NUL terminated (truncated if too long).
+ */
+struct snapshot_header {
+	uint32_t magic;
+	uint32_t version;
+	int64_t timestamp;
+	uint32_t nbmarkets;
+	uint32_t nbcurrencies;
+	uint32_t nbtrades;
+	/* 1 if written after all bot threads stopped */
+	uint32_t clean;
+};
+
+struct snapshot_market {
+	char marketname[32];
+	char marketcurrency[16];
+	char basecurrency[16];
+	char marketcurrencylong[64];
+	char basecurrencylong[64];
+	int64_t timestamp;	/* summary, epoch ms */
+	int32_t isactive;
+	int32_t has_summary;
+	double mintradesize, high, low, basevolume, volume;
+	double last, bid, ask, prevday;
+	int32_t openb, opens;
+	/* indicators */
+	double rsi, brsi, macd, macdsignal, macdhisto;
+};
+
+struct snapshot_currency {
+	char coin[16];
+	char currencylong[64];
+	char cointype[32];
+	char baseaddress[128];
+	int32_t minconfirmation;
+	int32_t isactive;
+	double txfee;
+};
+
+/*
+ * Pending order of a bot thread, same fields as the Orders table.
+ */
+struct snapshot_trade {
+	char market[32];
+	char uuid[48];
+	int32_t buyorsell;	/* 0 if no order */
+	int32_t completed;
+	fixed_t quantity;	/* 1e-8 units, see fixed.h */
+	fixed_t rate;
+	fixed_t btcpaid;
+};
+
+struct snapshot {
+	void *map;
+	size_t size;
+	struct snapshot_header *header;
+	struct snapshot_trade *trades;
+	/* header clean flag when loaded, cleared on disk at once */
+	int clean;
+};
+
+/*
+ * Load markets and currencies from snapshot file into bi (mmap),
+ * those already fetched are kept. A clean snapshot is trusted once:
+ * its flag is cleared in the file, so that a crash before the next
+ * write resumes from the database.
+ * return 1 if snapshot is valid and loaded, 0 otherwise.
+ */
+int snapshot_load(struct bittrex_info *bi, char *path);
+
+/*
+ * Write snapshot of bi and bot threads states (bbot NULL terminated, may be NULL)
+ */
+int snapshot_write(struct bittrex_info *bi, struct bittrex_bot **bbot, int clean);
+
+/*
+ * Pending order of market found in a clean snapshot (for bot resuming)
+ * type is BUY or SELL. Returns NULL if not found or snapshot not clean.
+ */
+struct trade *snapshot_trade_get(struct bittrex_info *bi, struct market *m, int type);
+
+/*
+ * Fill snapshot_trade from bot state
+ */
+void snapshot_trade_set(struct snapshot_trade *st, struct market *m, int type,
+			char *uuid, fixed_t quantity, fixed_t rate, fixed_t btcpaid,
+			int completed);
+
+void free_snapshot(struct snapshot *s);
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strategy.h"
+
+/*
+ * rsi: buy when RSI(14) on minutes is low and not high on hours,
+ * sell with any gain once RSI(14) is high, or at a fixed gain.
+ */
+struct rsi_state {
+	double buy;		/* buy under this minute RSI */
+	double maxhour;		/* and hour RSI not above */
+	double sell;		/* sell with any gain over this minute RSI */
+	double gain;		/* or with this gain (%) */
+	double delay;		/* cancel a buy not filled after (s) */
+	double cancel;		/* if minute RSI is over */
+	double rise;		/* and rose more than this in a minute */
+	fixed_t previousloss;
+};
+
+static int rsi_init(void *state, const char *params) {
+	struct rsi_state *s = state;
+
+	s->buy = 30;
+	s->maxhour = 60;
+	s->sell = 70;
+	s->gain = 1;
+	s->delay = 60;
+	s->cancel = 35;
+	s->rise = 5;
+	/* the cancel rule parameters are optional */
+	if (*params && sscanf(params, "%lf,%lf,%lf,%lf,%lf,%lf,%lf",
+			      &s->buy, &s->maxhour, &s->sell, &s->gain,
+			      &s->delay, &s->cancel, &s->rise) < 4)
+		return -1;
+	if (s->buy <= 0 || s->buy >= s->sell || s->gain <= 0 || s->delay < 0)
+		return -1;
+	return 0;
+}
+
+static int rsi_candle(void *state, const struct strategy_feed *feed,
+		      const struct strategy_position *pos) {
+	struct rsi_state *s = state;
+	double rsi, prev;
+
+	if (feed->nbminute < 2 || feed->nbhour < 1)
+		return SIGNAL_NONE;
+	rsi = feed->minute[feed->nbminute-1]->rsi_ema;
+	prev = feed->minute[feed->nbminute-2]->rsi_ema;
+
+	switch (pos->state) {
+	case POSITION_NONE:
+		/* rsi == 0 if indicators could not be computed */
+		if (rsi < s->buy && rsi != 0 &&
+		    feed->hour[feed->nbhour-1]->rsi_ema <= s->maxhour)
+			return SIGNAL_BUY;
+		break;
+	case POSITION_BUYING:
+		/* not filled after delay: cancel if RSI is raising */
+		if (difftime(feed->now, pos->since) >= s->delay &&
+		    rsi > s->cancel && rsi > prev + s->rise)
+			return SIGNAL_CANCEL;
+		break;
+	}
+	return SIGNAL_NONE;
+}
+
+static int rsi_ticker(void *state, const struct strategy_feed *feed,
+		      const struct strategy_position *pos) {
+	struct rsi_state *s = state;
+	fixed_t gain, target;
+	double rsi;
+
+	if (pos->state != POSITION_HOLDING || !feed->last || feed->nbminute < 1)
+		return SIGNAL_NONE;
+	rsi = feed->minute[feed->nbminute-1]->rsi_ema;
+	gain = strategy_gain(pos, feed->last);
+	target = fixed_from_double(fixed_to_double(pos->btcpaid) * s->gain / 100);
+
+	if ((gain > 0 && rsi >= s->sell) || gain >= target)
+		return SIGNAL_SELL;
+	if (rsi >= s->sell && gain != s->previousloss && !pos->paper) {
+		printf("Warning, RSI of %s over %.0f but no opportunity found (loss: %.8f)\n",
+		       feed->m->marketname, s->sell, fixed_to_double(gain));
+		s->previousloss = gain;
+	}
+	return SIGNAL_NONE;
+}
+
+static const struct strategy rsi_strategy = {
+	.name = "rsi",
+	.usage = "buy,maxhour,sell,gain[,delay,cancel,rise] (default 30,60,70,1,60,35,5)",
+	.statesize = sizeof(struct rsi_state),
+	.init = rsi_init,
+	.on_candle = rsi_candle,
+	.on_ticker = rsi_ticker,
+	.on_fill = NULL,
+};
+
+const struct strategy *strategies[] = {
+	&rsi_strategy,
+	NULL
+};
+
+const struct strategy *strategy_find(const char *name) {
+	int i;
+
+	for (i = 0; strategies[i]; i++) {
+		if (strcmp(strategies[i]->name, name) == 0)
+			return strategies[i];
+	}
+	return NULL;
+}
+
+/*
+ * Split "name[:params]" and set up inst, -1 if invalid
+ */
+static int instance_init(struct strategy_instance *inst, const char *spec) {
+	char name[32];
+	const char *params = strchr(spec, ':');
+	size_t len = params ? (size_t)(params - spec) : strlen(spec);
+
+	memset(inst, 0, sizeof(struct strategy_instance));
+	if (len >= sizeof(name) || (params && strlen(params + 1) >= STRATEGY_PARAMSIZE)) {
+		fprintf(stderr, "Invalid strategy: %s\n", spec);
+		return -1;
+	}
+	memcpy(name, spec, len);
+	name[len] = '\0';
+	strcpy(inst->params, params ? params + 1 : "");
+
+	if (!(inst->s = strategy_find(name))) {
+		fprintf(stderr, "Unknown strategy: %s\n", name);
+		return -1;
+	}
+	if (!(inst->state = calloc(1, inst->s->statesize)))
+		return -1;
+	if (inst->s->init(inst->state, inst->params) != 0) {
+		fprintf(stderr, "Invalid parameters for strategy %s: %s (%s)\n",
+			name, inst->params, inst->s->usage);
+		free(inst->state);
+		inst->state = NULL;
+		return -1;
+	}
+	inst->pos.paper = 1;
+	return 0;
+}
+
+int strategy_check(const char *spec) {
+	struct strategy_instance inst;
+
+	if (instance_init(&inst, spec) != 0)
+		return -1;
+	free(inst.state);
+	return 0;
+}
+
+int strategy_set_init(struct strategy_set *set, char **specs) {
+	static char *defaults[] = {STRATEGY_DEFAULT, NULL};
+	int i;
+
+	if (!specs || !specs[0])
+		specs = defaults;
+	set->nbinst = 0;
+	for (i = 0; specs[i] && i < STRATEGY_MAX; i++) {
+		if (instance_init(&(set->inst[i]), specs[i]) != 0) {
+			strategy_set_free(set);
+			return -1;
+		}
+		set->nbinst++;
+	}
+	return 0;
+}
+
+void strategy_set_free(struct strategy_set *set) {
+	int i;
+
+	for (i = 0; i < set->nbinst; i++)
+		free(set->inst[i].state);
+	set->nbinst = 0;
+}
+
+fixed_t strategy_gain(const struct strategy_position *pos, fixed_t rate) {
+	fixed_t sellminusfee;
+
+	sellminusfee = fixed_muldiv(fixed_mul(rate, pos->realqty),
+				    10000 - FIXED_FEE_BPS, 10000);
+	return sellminusfee - pos->btcpaid;
+}
+
+void strategy_paper(struct strategy_instance *inst, const struct strategy_feed *feed,
+		    int signal) {
+	struct strategy_position *pos = &(inst->pos);
+
+	if (!feed->last)
+		return;
+	if (signal == SIGNAL_BUY && pos->state == POSITION_NONE) {
+		pos->realqty = fixed_div(FIXED_ONE, feed->last);
+		pos->btcpaid = fixed_muldiv(FIXED_ONE, 10000 + FIXED_FEE_BPS, 10000);
+		pos->state = POSITION_HOLDING;
+	} else if (signal == SIGNAL_SELL && pos->state == POSITION_HOLDING) {
+		inst->gain += strategy_gain(pos, feed->last);
+		inst->trades++;
+		pos->state = POSITION_NONE;
+	} else {
+		return;
+	}
+	pos->since = feed->now;
+	if (inst->s->on_fill)
+		inst->s->on_fill(inst->state, signal, pos);
+}
+
+static int feed_set(struct strategy_set *set, const struct strategy_feed *feed,
+		    const struct strategy_position *live, int candle) {
+	struct strategy_instance *inst;
+	int i, signal, rc = SIGNAL_NONE;
+
+	for (i = 0; i < set->nbinst; i++) {
+		inst = &(set->inst[i]);
+		if (candle)
+			signal = inst->s->on_candle(inst->state, feed, i ? &(inst->pos) : live);
+		else
+			signal = inst->s->on_ticker(inst->state, feed, i ? &(inst->pos) : live);
+		if (i)
+			strategy_paper(inst, feed, signal);
+		else
+			rc = signal;
+	}
+	return rc;
+}
+
+int strategy_candle(struct strategy_set *set, const struct strategy_feed *feed,
+		    const struct strategy_position *live) {
+	return feed_set(set, feed, live, 1);
+}
+
+int strategy_ticker(struct strategy_set *set, const struct strategy_feed *feed,
+		    const struct strategy_position *live) {
+	return feed_set(set, feed, live, 0);
+}
+
+void strategy_fill(struct strategy_set *set, int signal,
+		   const struct strategy_position *live) {
+	if (set->nbinst && set->inst[0].s->on_fill)
+		set->inst[0].s->on_fill(set->inst[0].state, signal, live);
+}
+
+void strategy_report(struct strategy_set *set, const char *marketname) {
+	struct strategy_instance *inst;
+	int i;
+
+	for (i = 1; i < set->nbinst; i++) {
+		inst = &(set->inst[i]);
+		printf("%s: paper %s:%s, %d trade(s), gain %.8f BTC per BTC%s\n",
+		       marketname, inst->s->name, inst->params, inst->trades,
+		       fixed_to_double(inst->gain),
+		       inst->pos.state == POSITION_HOLDING ? " (holding)" : "");
+	}
+}
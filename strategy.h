@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <time.h>
+
+#include "fixed.h"
+#include "market.h"
+
+#define STRATEGY_MAX		16	/* instances per market */
+#define STRATEGY_PARAMSIZE	64
+#define STRATEGY_DEFAULT	"rsi"
+
+/* returned by callbacks */
+#define SIGNAL_NONE	0
+#define SIGNAL_BUY	1
+#define SIGNAL_SELL	2
+#define SIGNAL_CANCEL	3	/* pending buy order */
+
+#define POSITION_NONE		0
+#define POSITION_BUYING		1	/* buy order open */
+#define POSITION_HOLDING	2	/* bought, not sold yet */
+#define POSITION_SELLING	3	/* sell order open */
+
+/*
+ * Market data fetched once per market and given to every strategy.
+ * Candles are oldest first with RSI(14) (rsi_ema), read only.
+ */
+struct strategy_feed {
+	struct market *m;
+	struct tick **minute;
+	int nbminute;
+	struct tick **hour;
+	int nbhour;
+	fixed_t last;	/* last trade rate, 0 if unknown */
+	time_t now;	/* time of the data (candle time when backtesting) */
+};
+
+struct strategy_position {
+	int state;
+	fixed_t realqty;	/* coins bought */
+	fixed_t btcpaid;	/* fees included */
+	time_t since;		/* last state change */
+	int paper;		/* simulated, no order sent */
+};
+
+/*
+ * A strategy: callbacks deciding from the feed and the position.
+ * state is statesize bytes allocated (zeroed) once per market, set
+ * by init from params ("" for defaults). on_fill may be NULL.
+ */
+struct strategy {
+	const char *name;
+	const char *usage;	/* params, for help */
+	size_t statesize;
+	/* -1 if params are invalid */
+	int (*init)(void *state, const char *params);
+	/* new minute candle: buy or cancel a pending buy */
+	int (*on_candle)(void *state, const struct strategy_feed *feed,
+			 const struct strategy_position *pos);
+	/* new ticker: sell */
+	int (*on_ticker)(void *state, const struct strategy_feed *feed,
+			 const struct strategy_position *pos);
+	/* order filled (SIGNAL_BUY, SIGNAL_SELL) or cancelled */
+	void (*on_fill)(void *state, int signal, const struct strategy_position *pos);
+};
+
+struct strategy_instance {
+	const struct strategy *s;
+	char params[STRATEGY_PARAMSIZE];
+	void *state;
+	/* paper instances only */
+	struct strategy_position pos;
+	fixed_t gain;		/* BTC per BTC invested, fees included */
+	int trades;
+};
+
+/*
+ * Strategies run on one market: the first one trades, others are
+ * paper traded on the same feed to compare parameters.
+ */
+struct strategy_set {
+	struct strategy_instance inst[STRATEGY_MAX];
+	int nbinst;
+};
+
+/*
+ * Strategies compiled in, NULL terminated
+ */
+extern const struct strategy *strategies[];
+
+const struct strategy *strategy_find(const char *name);
+
+/*
+ * "name[:params]" is valid: 0, -1 otherwise (error printed)
+ */
+int strategy_check(const char *spec);
+
+/*
+ * Instances of specs (NULL terminated, NULL for STRATEGY_DEFAULT)
+ * return 0, -1 on invalid spec.
+ */
+int strategy_set_init(struct strategy_set *set, char **specs);
+void strategy_set_free(struct strategy_set *set);
+
+/*
+ * Feed the set, paper instances trade at feed->last.
+ * return the signal of the first instance for the live position.
+ */
+int strategy_candle(struct strategy_set *set, const struct strategy_feed *feed,
+		    const struct strategy_position *live);
+int strategy_ticker(struct strategy_set *set, const struct strategy_feed *feed,
+		    const struct strategy_position *live);
+void strategy_fill(struct strategy_set *set, int signal,
+		   const struct strategy_position *live);
+
+/*
+ * Paper order of inst at feed->last for signal, filled at once,
+ * 1 BTC per buy. Gains are added to inst->gain.
+ */
+void strategy_paper(struct strategy_instance *inst, const struct strategy_feed *feed,
+		    int signal);
+
+/*
+ * Paper results of the set on market
+ */
+void strategy_report(struct strategy_set *set, const char *marketname);
+
+/*
+ * Gain if pos was sold at rate, fees included
+ */
+fixed_t strategy_gain(const struct strategy_position *pos, fixed_t rate);
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tape.h"
+#include "format.h"
+
+static char *tape_path(char *dir, char *marketname) {
+	char *path;
+
+	path = malloc(strlen(dir) + strlen(marketname) + strlen("/.tape") + 1);
+	if (path)
+		sprintf(path, "%s/%s.tape", dir, marketname);
+	return path;
+}
+
+static int compare_fills(const void *a, const void *b) {
+	const struct tape_fill *fa = a, *fb = b;
+
+	if (fa->id < fb->id)
+		return -1;
+	return fa->id > fb->id;
+}
+
+int tape_merge(char *dir, struct market *m) {
+	struct tape_header h;
+	struct tape_fill *f, last;
+	struct market_history *fill;
+	struct stat st;
+	char *path;
+	off_t end;
+	int fd, i, nb, first, added = 0;
+
+	if (!dir || !m || !m->mh)
+		return -1;
+
+	if ((nb = m->mh->count) == 0)
+		return 0;
+	if (!(f = calloc(nb, sizeof(struct tape_fill))))
+		return -1;
+	for (i = 0; (fill = market_history_get(m->mh, i)); i++) {
+		f[i].id = fill->id;
+		f[i].timestamp = fill->timestamp;
+		f[i].price = fill->price;
+		f[i].quantity = fill->quantity;
+		f[i].buy = strcmp(fill->ordertype, "BUY") == 0;
+	}
+	/*
+	 * API replies newest fills first: sort by Id, oldest first, the
+	 * cumulative sums below and the tape are in that order.
+	 */
+	qsort(f, nb, sizeof(struct tape_fill), compare_fills);
+
+	path = tape_path(dir, m->marketname);
+	if (!path || (fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		fprintf(stderr, "tape: could not open %s\n", path ? path : dir);
+		free(path);
+		free(f);
+		return -1;
+	}
+	free(path);
+	flock(fd, LOCK_EX);
+
+	memset(&last, 0, sizeof(last));
+	if (fstat(fd, &st) < 0)
+		goto error;
+	if ((size_t)st.st_size < sizeof(h)) {
+		memset(&h, 0, sizeof(h));
+		h.magic = TAPE_MAGIC;
+		h.version = TAPE_VERSION;
+		strncpy(h.marketname, m->marketname, sizeof(h.marketname) - 1);
+		if (pwrite(fd, &h, sizeof(h), 0) != sizeof(h))
+			goto error;
+		end = sizeof(h);
+	} else {
+		if (pread(fd, &h, sizeof(h), 0) != sizeof(h) ||
+		    h.magic != TAPE_MAGIC || h.version != TAPE_VERSION)
+			goto error;
+		end = st.st_size - (st.st_size - sizeof(h)) % sizeof(last);
+		if (end > (off_t)sizeof(h) &&
+		    pread(fd, &last, sizeof(last), end - sizeof(last)) != sizeof(last))
+			goto error;
+	}
+
+	/* duplicates within the page are skipped too */
+	for (first = 0, i = 0; i < nb; i++) {
+		if (f[i].id <= last.id)
+			continue;
+		f[i].nbbuys = last.nbbuys + f[i].buy;
+		f[i].nbsells = last.nbsells + !f[i].buy;
+		f[i].buyvolume = last.buyvolume + (f[i].buy ? f[i].quantity : 0);
+		f[i].sellvolume = last.sellvolume + (f[i].buy ? 0 : f[i].quantity);
+		f[i].buytotal = last.buytotal + (f[i].buy ? f[i].quantity * f[i].price : 0);
+		f[i].selltotal = last.selltotal + (f[i].buy ? 0 : f[i].quantity * f[i].price);
+		last = f[i];
+		f[first++] = f[i];
+	}
+	if (first > 0) {
+		added = first;
+		if (pwrite(fd, f, added * sizeof(struct tape_fill), end) !=
+		    (ssize_t)(added * sizeof(struct tape_fill)))
+			goto error;
+		end += added * sizeof(struct tape_fill);
+	}
+	if (end != st.st_size && ftruncate(fd, end) < 0)
+		goto error;
+
+	flock(fd, LOCK_UN);
+	close(fd);
+	free(f);
+	return added;
+
+error:
+	fprintf(stderr, "tape: could not merge %s fills\n", m->marketname);
+	flock(fd, LOCK_UN);
+	close(fd);
+	free(f);
+	return -1;
+}
+
+/*
+ * index of first fill with timestamp >= ts
+ */
+static size_t tape_find(struct tape_fill *f, size_t n, int64_t ts) {
+	size_t lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (f[mid].timestamp < ts)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+long tape_volumeonrange(char *dir, char *marketname, int64_t start, int64_t end,
+			struct tape_volume *v) {
+	struct tape_header *h;
+	struct tape_fill *f, zero, *a, *b;
+	struct stat st;
+	size_t n, lo, hi;
+	char *path;
+	void *map;
+	int fd;
+
+	memset(v, 0, sizeof(struct tape_volume));
+	if (!dir || !marketname || !(path = tape_path(dir, marketname)))
+		return -1;
+	fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct tape_header)) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+	h = (struct tape_header *)map;
+	if (h->magic != TAPE_MAGIC || h->version != TAPE_VERSION) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	f = (struct tape_fill *)(h + 1);
+	n = (st.st_size - sizeof(struct tape_header)) / sizeof(struct tape_fill);
+
+	lo = tape_find(f, n, start);
+	hi = tape_find(f, n, end);
+	if (hi > lo) {
+		/* sums of (lo, hi] minus the fill before lo */
+		memset(&zero, 0, sizeof(zero));
+		a = lo > 0 ? &f[lo - 1] : &zero;
+		b = &f[hi - 1];
+		v->nbbuys = b->nbbuys - a->nbbuys;
+		v->nbsells = b->nbsells - a->nbsells;
+		v->buyvolume = b->buyvolume - a->buyvolume;
+		v->sellvolume = b->sellvolume - a->sellvolume;
+		v->buytotal = b->buytotal - a->buytotal;
+		v->selltotal = b->selltotal - a->selltotal;
+		if (v->buyvolume + v->sellvolume > 0)
+			v->vwap = (v->buytotal + v->selltotal) /
+				(v->buyvolume + v->sellvolume);
+	}
+	munmap(map, st.st_size);
+	return hi > lo ? (long)(hi - lo) : 0;
+}
+
+void printtapevolume(struct tape_volume *v) {
+	struct fmt out;
+
+	if (output_format != FORMAT_TEXT) {
+		fmt_init(&out);
+		fmt_begin(&out);
+		fmt_real(&out, "BuyVolume", v->buyvolume);
+		fmt_int(&out, "BuyFills", v->nbbuys);
+		fmt_real(&out, "BuyTotal", v->buytotal);
+		fmt_real(&out, "SellVolume", v->sellvolume);
+		fmt_int(&out, "SellFills", v->nbsells);
+		fmt_real(&out, "SellTotal", v->selltotal);
+		fmt_real(&out, "VWAP", v->vwap);
+		fmt_int(&out, "Fills", v->nbbuys + v->nbsells);
+		fmt_end(&out);
+		fmt_flush(&out);
+		return;
+	}
+	printf("Buy volume:\t%.8f (%lld fills, %.8f base)\n", v->buyvolume,
+	       (long long)v->nbbuys, v->buytotal);
+	printf("Sell volume:\t%.8f (%lld fills, %.8f base)\n", v->sellvolume,
+	       (long long)v->nbsells, v->selltotal);
+	printf("VWAP:\t\t%.8f\n", v->vwap);
+	printf("Fills:\t\t%lld\n", (long long)(v->nbbuys + v->nbsells));
+}
@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "market.h"
+
+#define TAPE_MAGIC	0x45504154 /* "TAPE" */
+#define TAPE_VERSION	1
+
+/*
+ * Trade tape of one market: <dir>/<market>.tape
+ * header followed by fills sorted by Id. Each record carries the
+ * cumulative volumes since the first fill, so that the volume between
+ * two records is a subtraction (range queries are two binary searches).
+ */
+struct tape_header {
+	uint32_t magic;
+	uint32_t version;
+	char marketname[32];
+};
+
+struct tape_fill {
+	int64_t id;
+	int64_t timestamp;	/* UTC epoch milliseconds */
+	double price;
+	double quantity;
+	int32_t buy;		/* 1 if OrderType is BUY */
+	int32_t reserved;
+	/* cumulative, this fill included */
+	int64_t nbbuys;
+	int64_t nbsells;
+	double buyvolume;	/* quantity */
+	double sellvolume;
+	double buytotal;	/* base currency */
+	double selltotal;
+};
+
+/*
+ * Aggregated volumes on a time range
+ */
+struct tape_volume {
+	int64_t nbbuys;
+	int64_t nbsells;
+	double buyvolume;
+	double sellvolume;
+	double buytotal;
+	double selltotal;
+	double vwap;
+};
+
+/*
+ * Merge fills of m (m->mh, see getmarkethistory) into the tape,
+ * fills already stored (by Id) are skipped.
+ * return number of fills added, -1 on error.
+ */
+int tape_merge(char *dir, struct market *m);
+
+/*
+ * Buy and sell volumes of fills with start <= timestamp < end (epoch ms)
+ * return number of fills in range, -1 if there is no tape for the market.
+ */
+long tape_volumeonrange(char *dir, char *marketname, int64_t start, int64_t end,
+			struct tape_volume *v);
+
+void printtapevolume(struct tape_volume *v);
+
+#endif
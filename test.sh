@@ -179,3 +179,152 @@ test_20() {
 
 run_test 20 "getorderbook with non existing marketname"
 
+
+#
+# archive and export tests (21 to 24)
+#
+
+test_21() {
+    local dir=$LOGDIR"bittrex_archive"
+    mkdir -p $dir
+    $BBIN --archive=$dir --market=$EXMARKET --getticks Hour  > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1 || return $?
+    [ -s $dir"/"$EXMARKET".Hour" ] || error "archive not written"
+    $BBIN --archive=$dir --market=$EXMARKET --export Hour,csv,$dir  >> $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1 || return $?
+    [ -s $dir"/"$EXMARKET".Hour.csv" ] || error "csv export not written"
+    return 0
+}
+
+run_test 21 "archive and export csv"
+
+test_22() {
+    $BBIN --market=$EXMARKET --export Hour,badformat,$LOGDIR  > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    (( $? != 0 )) || error "test expected to fail (export with bad format) but did not"
+}
+
+run_test 22 "export with bad format"
+
+test_23() {
+    local dir=$LOGDIR"bittrex_archive"
+    mkdir -p $dir
+    $BBIN --archive=$dir --market=$EXMARKET --volumeonrange 2018-01-01T00:00:00,2038-01-01T00:00:00  > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    return $?
+}
+
+run_test 23 "volumeonrange"
+
+test_24() {
+    $BBIN --market=$EXMARKET --volumeonrange 2018-01-01T00:00:00,2038-01-01T00:00:00  > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    (( $? != 0 )) || error "test expected to fail (volumeonrange without archive) but did not"
+}
+
+run_test 24 "volumeonrange without archive"
+
+
+#
+# daemon tests (25 to 26)
+#
+
+test_25() {
+    local sock=$LOGDIR"bittrex_test.sock"
+    local log=$LOGDIR"test_log.${FUNCNAME[0]}.log"
+    local i
+
+    rm -f $sock
+    $BBIN --daemon=$sock > $log 2>&1 &
+    trap "kill $! 2>/dev/null" EXIT
+    for i in $(seq 20); do
+	[ -S $sock ] && break
+	sleep 0.5
+    done
+    [ -S $sock ] || error "daemon did not listen on $sock"
+
+    $BBIN --socket=$sock --market=$EXMARKET --getticker >> $log 2>&1 || error "getticker through daemon failed"
+    $BBIN --socket=$sock --market=badmarket --getticker >> $log 2>&1
+    (( $? != 0 )) || error "exit status of a failing command not forwarded"
+
+    # clients connected but silent must not delay the next ones
+    # (--help needs no API call, it is served in a few milliseconds)
+    if command -v python3 > /dev/null; then
+	python3 -c "import socket, sys, time
+s = [socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET) for i in range(2)]
+[c.connect(sys.argv[1]) for c in s]
+time.sleep(30)" $sock &
+	sleep 0.5
+	local start=$(date +%s%N)
+	timeout 1 $BBIN --socket=$sock --help >> $log 2>&1 || error "daemon blocked by silent clients"
+	(( ($(date +%s%N) - start) / 1000000 < 500 )) || error "daemon delayed by silent clients"
+	kill $! 2>/dev/null
+    fi
+    return 0
+}
+
+run_test 25 "daemon and socket client"
+
+test_26() {
+    $BBIN --socket=$LOGDIR"bittrex_nodaemon.sock" --getmarkets > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    (( $? != 0 )) || error "test expected to fail (no daemon on socket) but did not"
+}
+
+run_test 26 "socket without daemon"
+
+
+#
+# output format tests (27 to 29)
+#
+
+test_27() {
+    local out=$LOGDIR"test_out.${FUNCNAME[0]}.csv"
+    $BBIN --format=csv --getmarkets > $out 2> $LOGDIR"test_log.${FUNCNAME[0]}.log" || return $?
+    head -1 $out | grep -q "^MarketCurrency,BaseCurrency,.*,MarketName,IsActive$" || error "csv header missing"
+    grep -q ",$EXMARKET," $out || error "$EXMARKET not in csv output"
+    # one record per line, IsActive last
+    (( $(tail -n +2 $out | grep -cv ',\(true\|false\)$') == 0 )) || error "csv records do not end with IsActive"
+}
+
+run_test 27 "format csv getmarkets"
+
+test_28() {
+    local out=$LOGDIR"test_out.${FUNCNAME[0]}.jsonl"
+    $BBIN --format=jsonl --market=$EXMARKET --getticker > $out 2> $LOGDIR"test_log.${FUNCNAME[0]}.log" || return $?
+    (( $(wc -l < $out) == 1 )) || error "jsonl getticker is not one line"
+    grep -q '^{"Bid":.*,"Ask":.*,"Last":.*}$' $out || error "jsonl getticker is not a ticker object"
+}
+
+run_test 28 "format jsonl getticker"
+
+test_29() {
+    $BBIN --format=xml --getmarkets > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    (( $? != 0 )) || error "test expected to fail (unknown output format) but did not"
+}
+
+run_test 29 "format with unknown format"
+
+
+#
+# batch tests (30 to 31)
+#
+
+test_30() {
+    local out=$LOGDIR"test_out.${FUNCNAME[0]}"
+    printf '%s\n' "--format=csv --market=$EXMARKET --getticker" \
+	   "# comments and empty lines are skipped" "" \
+	   "--format=csv --getmarkets" \
+	   "--format=jsonl --market=$EXMARKET --getticker" |
+	$BBIN --jobs=3 --batch=- > $out 2> $LOGDIR"test_log.${FUNCNAME[0]}.log" || return $?
+    # outputs in input order, whatever command completes first
+    local first=$(grep -n "^Bid,Ask,Last$" $out | head -1 | cut -d: -f1)
+    local second=$(grep -n "^MarketCurrency," $out | head -1 | cut -d: -f1)
+    local third=$(grep -n '^{"Bid":' $out | head -1 | cut -d: -f1)
+    [ -n "$first" ] && [ -n "$second" ] && [ -n "$third" ] || error "missing batch output"
+    (( first < second && second < third )) || error "batch outputs not in input order"
+}
+
+run_test 30 "batch from stdin, outputs in order"
+
+test_31() {
+    printf '%s\n' "--market=$EXMARKET --getticker" "--bot" |
+	$BBIN --batch=- > $LOGDIR"test_log.${FUNCNAME[0]}.log" 2>&1
+    (( $? != 0 )) || error "test expected to fail (--bot refused in batch) but did not"
+}
+
+run_test 31 "batch with a refused command"
@@ -0,0 +1,260 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "tracker.h"
+#include "account.h"
+
+static int tracker_find(struct order_tracker *t, char *uuid) {
+	int i;
+
+	for (i = 0; i < t->nborders; i++) {
+		if (strcmp(t->orders[i].uuid, uuid) == 0)
+			return i;
+	}
+	return -1;
+}
+
+static struct user_order *find_order(struct user_order **orders, char *uuid) {
+	for (; orders && *orders; orders++) {
+		if ((*orders)->orderuuid && strcmp((*orders)->orderuuid, uuid) == 0)
+			return *orders;
+	}
+	return NULL;
+}
+
+static void order_closed(struct tracked_order *o, struct user_order *u) {
+	o->quantity = u->quantity - u->quantityremaining;
+	o->commission = u->commission;
+	o->price = u->price;
+	o->state = o->quantity > 0 ? ORDER_FILLED : ORDER_CANCELLED;
+}
+
+/*
+ * One check of all open orders: those missing from getopenorders()
+ * are looked up in the order history, then asked to getorder() if
+ * still not found after TRACKER_MISSING checks.
+ */
+static void tracker_check(struct order_tracker *t) {
+	struct user_order **open, **history = NULL, *u;
+	struct tracked_order *o;
+	char ask[TRACKER_ORDERS][TRACKER_UUIDSIZE];
+	unsigned int cycle;
+	int i, j, nbask = 0, candidates = 0, closed = 0;
+
+	pthread_mutex_lock(&(t->lock));
+	cycle = ++t->cycle;
+	pthread_mutex_unlock(&(t->lock));
+
+	if (!(open = getopenorders(t->bi, NULL)))
+		return;
+	pthread_mutex_lock(&(t->lock));
+	for (i = 0; i < t->nborders; i++) {
+		o = &(t->orders[i]);
+		/* added after open orders were asked */
+		if (o->state != ORDER_OPEN || o->cycle >= cycle)
+			continue;
+		if (find_order(open, o->uuid)) {
+			o->missing = 0;
+		} else {
+			o->missing++;
+			candidates++;
+		}
+	}
+	pthread_mutex_unlock(&(t->lock));
+	free_user_orders(open);
+	if (!candidates)
+		return;
+
+	history = getorderhistory(t->bi, NULL);
+	pthread_mutex_lock(&(t->lock));
+	for (i = 0; i < t->nborders; i++) {
+		o = &(t->orders[i]);
+		if (o->state != ORDER_OPEN || !o->missing)
+			continue;
+		if ((u = find_order(history, o->uuid))) {
+			order_closed(o, u);
+			closed++;
+		} else if (o->missing >= TRACKER_MISSING) {
+			strcpy(ask[nbask++], o->uuid);
+		}
+	}
+	pthread_mutex_unlock(&(t->lock));
+	if (history)
+		free_user_orders(history);
+
+	for (i = 0; i < nbask; i++) {
+		if (!(u = getorder(t->bi, ask[i])))
+			continue;
+		pthread_mutex_lock(&(t->lock));
+		j = tracker_find(t, ask[i]);
+		o = j >= 0 ? &(t->orders[j]) : NULL;
+		if (o && o->state == ORDER_OPEN) {
+			if (!u->isopen) {
+				order_closed(o, u);
+				closed++;
+			} else {
+				o->missing = 0;
+			}
+		}
+		pthread_mutex_unlock(&(t->lock));
+		free_user_order(u);
+	}
+
+	if (closed) {
+		pthread_mutex_lock(&(t->lock));
+		pthread_cond_broadcast(&(t->closed));
+		pthread_mutex_unlock(&(t->lock));
+	}
+}
+
+static void *tracker_thread(void *a) {
+	struct order_tracker *t = (struct order_tracker *)a;
+	struct timespec ts;
+	int i, open;
+
+	pthread_mutex_lock(&(t->lock));
+	while (!t->stop) {
+		for (i = 0, open = 0; i < t->nborders; i++)
+			open += t->orders[i].state == ORDER_OPEN;
+		if (!open) {
+			pthread_cond_wait(&(t->wake), &(t->lock));
+			continue;
+		}
+		if (time(NULL) < t->due) {
+			ts.tv_sec = t->due;
+			ts.tv_nsec = 0;
+			pthread_cond_timedwait(&(t->wake), &(t->lock), &ts);
+			continue;
+		}
+		t->due = time(NULL) + TRACKER_INTERVAL;
+		pthread_mutex_unlock(&(t->lock));
+		tracker_check(t);
+		pthread_mutex_lock(&(t->lock));
+	}
+	pthread_mutex_unlock(&(t->lock));
+	return NULL;
+}
+
+int tracker_start(struct bittrex_info *bi, struct order_tracker *t) {
+	memset(t, 0, sizeof(struct order_tracker));
+	t->bi = bi;
+	pthread_mutex_init(&(t->lock), NULL);
+	pthread_cond_init(&(t->closed), NULL);
+	pthread_cond_init(&(t->wake), NULL);
+	return pthread_create(&(t->thread), NULL, tracker_thread, t);
+}
+
+void tracker_stop(struct order_tracker *t) {
+	pthread_mutex_lock(&(t->lock));
+	t->stop = 1;
+	pthread_cond_broadcast(&(t->wake));
+	pthread_cond_broadcast(&(t->closed));
+	pthread_mutex_unlock(&(t->lock));
+	pthread_join(t->thread, NULL);
+	pthread_cond_destroy(&(t->wake));
+	pthread_cond_destroy(&(t->closed));
+	pthread_mutex_destroy(&(t->lock));
+}
+
+int tracker_add(struct order_tracker *t, char *uuid) {
+	struct tracked_order *o;
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&(t->lock));
+	if (tracker_find(t, uuid) >= 0) {
+		pthread_mutex_unlock(&(t->lock));
+		return 0;
+	}
+	if (t->nborders >= TRACKER_ORDERS || strlen(uuid) >= TRACKER_UUIDSIZE) {
+		pthread_mutex_unlock(&(t->lock));
+		fprintf(stderr, "tracker: can't track order %s\n", uuid);
+		return -1;
+	}
+	o = &(t->orders[t->nborders++]);
+	memset(o, 0, sizeof(struct tracked_order));
+	strcpy(o->uuid, uuid);
+	o->state = ORDER_OPEN;
+	o->cycle = t->cycle;
+	/* new orders are checked soon, with the others */
+	if (t->due < now || t->due > now + TRACKER_SETTLE)
+		t->due = now + TRACKER_SETTLE;
+	pthread_cond_signal(&(t->wake));
+	pthread_mutex_unlock(&(t->lock));
+	return 0;
+}
+
+void tracker_forget(struct order_tracker *t, char *uuid) {
+	int i;
+
+	pthread_mutex_lock(&(t->lock));
+	if ((i = tracker_find(t, uuid)) >= 0)
+		t->orders[i] = t->orders[--t->nborders];
+	pthread_mutex_unlock(&(t->lock));
+}
+
+int tracker_wait(struct order_tracker *t, char *uuid, int timeout,
+		 struct tracked_order *o) {
+	struct user_order *u;
+	struct timespec ts;
+	int i, state;
+
+	pthread_mutex_lock(&(t->lock));
+	ts.tv_sec = time(NULL) + timeout;
+	ts.tv_nsec = 0;
+	while (timeout > 0 && !t->stop && (i = tracker_find(t, uuid)) >= 0 &&
+	       t->orders[i].state == ORDER_OPEN) {
+		if (pthread_cond_timedwait(&(t->closed), &(t->lock), &ts) == ETIMEDOUT)
+			break;
+	}
+
+	if ((i = tracker_find(t, uuid)) < 0) {
+		pthread_mutex_unlock(&(t->lock));
+		/* not tracked, ask this one */
+		if (!(u = getorder(t->bi, uuid)))
+			return ORDER_OPEN;
+		state = ORDER_OPEN;
+		if (!u->isopen) {
+			memset(o, 0, sizeof(struct tracked_order));
+			strncpy(o->uuid, uuid, TRACKER_UUIDSIZE - 1);
+			order_closed(o, u);
+			state = o->state;
+		}
+		free_user_order(u);
+		return state;
+	}
+
+	state = t->orders[i].state;
+	if (state != ORDER_OPEN) {
+		*o = t->orders[i];
+		t->orders[i] = t->orders[--t->nborders];
+	}
+	pthread_mutex_unlock(&(t->lock));
+	return state;
+}
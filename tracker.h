@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <pthread.h>
+
+#include "bittrex.h"
+#include "fixed.h"
+
+#define TRACKER_INTERVAL	5	/* seconds between two status checks */
+#define TRACKER_SETTLE		2	/* first check of a new order */
+#define TRACKER_MISSING		3	/* checks before asking getorder() */
+#define TRACKER_ORDERS		(2 * MAX_ACTIVE_MARKETS)
+#define TRACKER_UUIDSIZE	48
+
+/* order state */
+#define ORDER_OPEN		0
+#define ORDER_FILLED		1	/* closed, partially filled included */
+#define ORDER_CANCELLED		2	/* closed, nothing filled */
+
+struct tracked_order {
+	char uuid[TRACKER_UUIDSIZE];
+	int state;
+	unsigned int cycle;	/* check it was added in */
+	int missing;		/* closed but not in history yet */
+	fixed_t quantity;	/* filled */
+	fixed_t commission;
+	fixed_t price;		/* BTC total */
+};
+
+/*
+ * Status of all bot orders is checked at once every TRACKER_INTERVAL,
+ * from the open orders then the order history, by one thread. Bot
+ * threads wait for their orders to close instead of polling getorder().
+ */
+struct order_tracker {
+	struct bittrex_info *bi;
+	struct tracked_order orders[TRACKER_ORDERS];
+	int nborders;
+	unsigned int cycle;
+	time_t due;		/* next check */
+	int stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t closed;	/* an order closed */
+	pthread_cond_t wake;	/* order added or stop */
+};
+
+int tracker_start(struct bittrex_info *bi, struct order_tracker *t);
+void tracker_stop(struct order_tracker *t);
+
+/*
+ * Track order uuid until it closes, -1 if no slot left
+ */
+int tracker_add(struct order_tracker *t, char *uuid);
+
+/*
+ * Stop tracking order uuid (cancelled by the bot)
+ */
+void tracker_forget(struct order_tracker *t, char *uuid);
+
+/*
+ * Wait at most timeout seconds (0 does not wait) for order uuid to close.
+ * return its state; once closed, o is filled and the order is no longer
+ * tracked. Orders not tracked are asked to getorder().
+ */
+int tracker_wait(struct order_tracker *t, char *uuid, int timeout,
+		 struct tracked_order *o);
+
+#endif
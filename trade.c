@@ -27,8 +27,8 @@
 
 struct trade *new_trade(struct market *m,
 			order_type type,
-			double quantity,
-			double rate,
+			fixed_t quantity,
+			fixed_t rate,
 			time_type timeineffect,
 			condition_type condition,
 			int target,
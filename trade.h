@@ -23,6 +23,7 @@
  */
 
 #include "bittrex.h"
+#include "fixed.h"
 #include "market.h"
 
 #define BUY 1
@@ -40,11 +41,11 @@ enum condition_type { NONE, GREATER_THAN, LESS_THAN };
 struct trade {
 	struct market *m;
 	order_type type;
-	double quantity; // quantity without fee
-	double realqty; // real quantity baught (minus the fees, 0.25%)
-	double rate;
-	double fee;
-	double btcpaid;
+	fixed_t quantity; // quantity without fee
+	fixed_t realqty; // real quantity baught (minus the fees, 0.25%)
+	fixed_t rate;
+	fixed_t fee;
+	fixed_t btcpaid;
 	time_type timeineffect;
 	condition_type condition;
 	int target;
@@ -55,8 +56,8 @@ struct trade {
 
 struct trade *new_trade(struct market *m,
 			order_type type,
-			double quantity,
-			double rate,
+			fixed_t quantity,
+			fixed_t rate,
 			time_type timeineffect,
 			condition_type condition,
 			int target, int bos, char *uuid);
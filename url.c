@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "url.h"
+
+static void url_append(struct url *u, const char *s, size_t len) {
+	if (u->overflow || u->len + len >= URL_SIZE) {
+		u->overflow = 1;
+		return;
+	}
+	memcpy(u->buf + u->len, s, len);
+	u->len += len;
+	u->buf[u->len] = '\0';
+}
+
+static void url_escape(struct url *u, const char *s) {
+	static const char hex[] = "0123456789ABCDEF";
+	unsigned char c;
+
+	for (; s && *s && !u->overflow; s++) {
+		c = *s;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+		    (c >= '0' && c <= '9') || c == '-' || c == '.' ||
+		    c == '_' || c == '~') {
+			url_append(u, s, 1);
+		} else if (u->len + 3 < URL_SIZE) {
+			u->buf[u->len++] = '%';
+			u->buf[u->len++] = hex[c >> 4];
+			u->buf[u->len++] = hex[c & 0x0f];
+			u->buf[u->len] = '\0';
+		} else {
+			u->overflow = 1;
+		}
+	}
+}
+
+void url_init(struct url *u, const char *base) {
+	u->len = 0;
+	u->overflow = 0;
+	u->buf[0] = '\0';
+	url_append(u, base, strlen(base));
+}
+
+void url_value(struct url *u, const char *value) {
+	url_escape(u, value);
+}
+
+void url_param(struct url *u, const char *key, const char *value) {
+	url_append(u, "&", 1);
+	url_append(u, key, strlen(key));
+	url_append(u, "=", 1);
+	url_escape(u, value);
+}
+
+void url_param_fixed(struct url *u, const char *key, fixed_t value) {
+	char buf[FIXED_STRLEN];
+
+	url_append(u, "&", 1);
+	url_append(u, key, strlen(key));
+	url_append(u, "=", 1);
+	url_append(u, buf, fixed_fmt(value, buf));
+}
+
+char *url_str(struct url *u) {
+	if (u->overflow) {
+		fprintf(stderr, "url: longer than %d bytes (%.64s...)\n",
+			URL_SIZE, u->buf);
+		return NULL;
+	}
+	return u->buf;
+}
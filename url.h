@@ -0,0 +1,73 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef URL_H
+#define URL_H
+
+#include <stddef.h>
+
+#include "fixed.h"
+
+#define URL_SIZE	1024
+
+/*
+ * API request URL built in place, on the caller stack.
+ * Appends are linear in the appended length and nothing is allocated,
+ * parameter values are percent-encoded (RFC 3986 unreserved kept).
+ *
+ *	struct url u;
+ *	url_init(&u, GETBALANCE);
+ *	url_value(&u, api->key);
+ *	url_param(&u, "currency", c->coin);
+ *	url = url_str(&u);
+ */
+struct url {
+	char buf[URL_SIZE];
+	size_t len;
+	int overflow;
+};
+
+/*
+ * base is copied as is (endpoint define, "...?apikey=" for instance)
+ */
+void url_init(struct url *u, const char *base);
+
+/*
+ * append value of the parameter opened by base
+ */
+void url_value(struct url *u, const char *value);
+
+/*
+ * append "&key=value"
+ */
+void url_param(struct url *u, const char *key, const char *value);
+void url_param_fixed(struct url *u, const char *key, fixed_t value);
+
+/*
+ * built URL (valid as long as u), NULL if URL_SIZE was too small
+ */
+char *url_str(struct url *u);
+
+#endif
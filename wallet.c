@@ -0,0 +1,270 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wallet.h"
+#include "account.h"
+
+static struct wallet_balance *wallet_find(struct wallet *w, const char *coin) {
+	int i;
+
+	for (i = 0; i < w->nbbalances; i++) {
+		if (strcmp(w->balances[i].coin, coin) == 0)
+			return &(w->balances[i]);
+	}
+	return NULL;
+}
+
+/*
+ * Base currency entry, added if the account has none yet
+ */
+static struct wallet_balance *wallet_base(struct wallet *w) {
+	struct wallet_balance *b, *tmp;
+
+	if ((b = wallet_find(w, WALLET_BASE)))
+		return b;
+	tmp = realloc(w->balances, (w->nbbalances + 1) * sizeof(struct wallet_balance));
+	if (!tmp)
+		return NULL;
+	w->balances = tmp;
+	b = &(w->balances[w->nbbalances++]);
+	memset(b, 0, sizeof(struct wallet_balance));
+	strcpy(b->coin, WALLET_BASE);
+	return b;
+}
+
+/*
+ * Next reconcile within secs, under lock
+ */
+static void wallet_soon(struct wallet *w, int secs) {
+	time_t due = time(NULL) + secs;
+
+	if (w->due > due) {
+		w->due = due;
+		pthread_cond_signal(&(w->wake));
+	}
+}
+
+/*
+ * Replace balances by getbalances() ones, unless a buy was placed
+ * or filled meanwhile (it could be counted twice or missed).
+ * return 0 if done, 1 if skipped, -1 if the call failed.
+ */
+static int wallet_reconcile(struct wallet *w) {
+	struct balance **b;
+	struct wallet_balance *balances, *base;
+	unsigned int version;
+	int i, n = 0;
+
+	pthread_mutex_lock(&(w->lock));
+	version = w->version;
+	pthread_mutex_unlock(&(w->lock));
+
+	if (!(b = getbalances(w->bi, w->bi->api)))
+		return -1;
+	for (i = 0; b[i]; i++);
+	if (!(balances = calloc(i + 1, sizeof(struct wallet_balance)))) {
+		free_balances(b);
+		return -1;
+	}
+	for (i = 0; b[i]; i++) {
+		if (!b[i]->currency || !b[i]->currency->coin ||
+		    strlen(b[i]->currency->coin) >= WALLET_COINSIZE)
+			continue;
+		strcpy(balances[n].coin, b[i]->currency->coin);
+		balances[n].available = b[i]->available;
+		n++;
+	}
+	free_balances(b);
+
+	pthread_mutex_lock(&(w->lock));
+	if (w->version != version) {
+		pthread_mutex_unlock(&(w->lock));
+		free(balances);
+		return 1;
+	}
+	free(w->balances);
+	w->balances = balances;
+	w->nbbalances = n;
+	/* funds locked by placed buys are still ours until filled */
+	if ((base = wallet_base(w)))
+		base->available += w->placed;
+	pthread_mutex_unlock(&(w->lock));
+	return 0;
+}
+
+static void *wallet_thread(void *a) {
+	struct wallet *w = (struct wallet *)a;
+	struct timespec ts;
+	int rc;
+
+	pthread_mutex_lock(&(w->lock));
+	while (!w->stop) {
+		if (time(NULL) < w->due) {
+			ts.tv_sec = w->due;
+			ts.tv_nsec = 0;
+			pthread_cond_timedwait(&(w->wake), &(w->lock), &ts);
+			continue;
+		}
+		w->due = time(NULL) + WALLET_RECONCILE;
+		pthread_mutex_unlock(&(w->lock));
+		rc = wallet_reconcile(w);
+		pthread_mutex_lock(&(w->lock));
+		if (rc != 0)
+			wallet_soon(w, rc > 0 ? 1 : WALLET_SETTLE);
+	}
+	pthread_mutex_unlock(&(w->lock));
+	return NULL;
+}
+
+int wallet_start(struct bittrex_info *bi, struct wallet *w) {
+	int rc;
+
+	memset(w, 0, sizeof(struct wallet));
+	w->bi = bi;
+	pthread_mutex_init(&(w->lock), NULL);
+	pthread_cond_init(&(w->wake), NULL);
+	if ((rc = wallet_reconcile(w)) != 0)
+		fprintf(stderr, "wallet: could not get balances\n");
+	w->due = time(NULL) + (rc ? WALLET_SETTLE : WALLET_RECONCILE);
+	pthread_create(&(w->thread), NULL, wallet_thread, w);
+	return rc ? -1 : 0;
+}
+
+void wallet_stop(struct wallet *w) {
+	pthread_mutex_lock(&(w->lock));
+	w->stop = 1;
+	pthread_cond_signal(&(w->wake));
+	pthread_mutex_unlock(&(w->lock));
+	pthread_join(w->thread, NULL);
+	pthread_cond_destroy(&(w->wake));
+	pthread_mutex_destroy(&(w->lock));
+	free(w->balances);
+	w->balances = NULL;
+	w->nbbalances = 0;
+}
+
+fixed_t wallet_available(struct wallet *w, const char *coin) {
+	struct wallet_balance *b;
+	fixed_t available = 0;
+
+	pthread_mutex_lock(&(w->lock));
+	if ((b = wallet_find(w, coin))) {
+		available = b->available;
+		if (strcmp(coin, WALLET_BASE) == 0)
+			available -= w->reserved;
+	}
+	pthread_mutex_unlock(&(w->lock));
+	return available > 0 ? available : 0;
+}
+
+fixed_t wallet_reserve(struct wallet *w, int slots, struct wallet_reservation *r) {
+	struct wallet_balance *base;
+	fixed_t available;
+	int free_slots;
+
+	memset(r, 0, sizeof(struct wallet_reservation));
+	pthread_mutex_lock(&(w->lock));
+	free_slots = slots - w->used;
+	if ((base = wallet_find(w, WALLET_BASE)) && free_slots > 0) {
+		available = base->available - w->reserved;
+		if (available > 0) {
+			r->amount = available / free_slots;
+			w->reserved += r->amount;
+			w->used++;
+		}
+	}
+	pthread_mutex_unlock(&(w->lock));
+	return r->amount;
+}
+
+void wallet_placed(struct wallet *w, struct wallet_reservation *r, fixed_t amount) {
+	pthread_mutex_lock(&(w->lock));
+	w->reserved += amount - r->amount;
+	w->placed += amount;
+	w->version++;
+	r->amount = amount;
+	r->placed = 1;
+	pthread_mutex_unlock(&(w->lock));
+}
+
+void wallet_hold(struct wallet *w, struct wallet_reservation *r, fixed_t amount) {
+	struct wallet_balance *base;
+
+	memset(r, 0, sizeof(struct wallet_reservation));
+	pthread_mutex_lock(&(w->lock));
+	w->used++;
+	if (amount > 0 && (base = wallet_base(w))) {
+		/* not in the available balance of the exchange */
+		base->available += amount;
+		w->reserved += amount;
+		w->placed += amount;
+		w->version++;
+		r->amount = amount;
+		r->placed = 1;
+	}
+	pthread_mutex_unlock(&(w->lock));
+}
+
+void wallet_filled(struct wallet *w, struct wallet_reservation *r, fixed_t spent) {
+	struct wallet_balance *base;
+
+	pthread_mutex_lock(&(w->lock));
+	w->reserved -= r->amount;
+	if (r->placed)
+		w->placed -= r->amount;
+	if ((base = wallet_find(w, WALLET_BASE)))
+		base->available -= spent;
+	w->version++;
+	pthread_mutex_unlock(&(w->lock));
+	memset(r, 0, sizeof(struct wallet_reservation));
+}
+
+void wallet_release(struct wallet *w, struct wallet_reservation *r) {
+	pthread_mutex_lock(&(w->lock));
+	w->reserved -= r->amount;
+	if (r->placed) {
+		/* a cancelled buy may be partially filled */
+		w->placed -= r->amount;
+		w->version++;
+		wallet_soon(w, WALLET_SETTLE);
+	}
+	if (w->used > 0)
+		w->used--;
+	pthread_mutex_unlock(&(w->lock));
+	memset(r, 0, sizeof(struct wallet_reservation));
+}
+
+void wallet_sold(struct wallet *w) {
+	pthread_mutex_lock(&(w->lock));
+	if (w->used > 0)
+		w->used--;
+	wallet_soon(w, WALLET_SETTLE);
+	pthread_mutex_unlock(&(w->lock));
+}
@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Jean-Baptiste Riaux <jb.riaux@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef WALLET_H
+#define WALLET_H
+
+#include <pthread.h>
+
+#include "bittrex.h"
+#include "fixed.h"
+
+#define WALLET_BASE		"BTC"	/* currency the bot buys with */
+#define WALLET_RECONCILE	300	/* seconds between two getbalances() */
+#define WALLET_SETTLE		5	/* reconcile after a sell or a cancel */
+#define WALLET_COINSIZE		16
+
+struct wallet_balance {
+	char coin[WALLET_COINSIZE];
+	fixed_t available;
+};
+
+/*
+ * Base currency of one bot buy, reserved while the buy is sized and
+ * placed, then locked by the exchange until filled or cancelled.
+ */
+struct wallet_reservation {
+	fixed_t amount;
+	int placed;
+};
+
+/*
+ * Balances cached for the bot threads. Available balances come from
+ * getbalances(), reconciled every WALLET_RECONCILE. In between, base
+ * currency is accounted locally: buys reserve their share under the
+ * wallet lock and fills are applied at once, so buy sizing needs no
+ * API call and concurrent buys never share the same funds.
+ * The local base balance includes what placed buys lock (not in the
+ * exchange available balance).
+ */
+struct wallet {
+	struct bittrex_info *bi;
+	struct wallet_balance *balances;
+	int nbbalances;
+	fixed_t reserved;	/* by buys, placed or not */
+	fixed_t placed;		/* locked by the exchange */
+	int used;		/* buys and positions */
+	unsigned int version;	/* local changes, see wallet_reconcile() */
+	time_t due;		/* next reconcile */
+	int stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+};
+
+/*
+ * First reconcile then thread reconciling in background
+ * return -1 if balances could not be fetched (wallet is usable, empty).
+ */
+int wallet_start(struct bittrex_info *bi, struct wallet *w);
+void wallet_stop(struct wallet *w);
+
+/*
+ * Available balance of coin (not reserved for base currency)
+ */
+fixed_t wallet_available(struct wallet *w, const char *coin);
+
+/*
+ * Reserve for one buy an equal share of available base currency,
+ * between slots minus those used (buys and positions).
+ * return amount reserved, 0 if nothing available or no slot left.
+ */
+fixed_t wallet_reserve(struct wallet *w, int slots, struct wallet_reservation *r);
+
+/*
+ * Buy of r placed, locking amount, the rest of r is given back
+ */
+void wallet_placed(struct wallet *w, struct wallet_reservation *r, fixed_t amount);
+
+/*
+ * Order found when resuming: a placed buy locking amount, or
+ * a position (amount 0)
+ */
+void wallet_hold(struct wallet *w, struct wallet_reservation *r, fixed_t amount);
+
+/*
+ * Buy of r filled, spent is base currency paid fees included
+ */
+void wallet_filled(struct wallet *w, struct wallet_reservation *r, fixed_t spent);
+
+/*
+ * Buy of r failed or cancelled, slot is free again
+ */
+void wallet_release(struct wallet *w, struct wallet_reservation *r);
+
+/*
+ * Position sold, slot is free again. Proceeds are known at next
+ * reconcile (soon).
+ */
+void wallet_sold(struct wallet *w);
+
+#endif